@@ -0,0 +1,605 @@
+/*
+ *     bench_sudoku.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Measures how fast sudoku grids are read and checked. A
+ *              corpus of solved and nearly solved grids is generated from a
+ *              seed, so every run with the same options sees the same
+ *              grids, and then timed on one thread and on many
+ *
+ *     Usage: bench_sudoku [-n grids] [-r rounds] [-j threads] [-s seed]
+ *                         [-o dir]
+ *              -n: grids in the corpus (10000 unless given)
+ *              -r: times each grid is handled per measurement (10)
+ *              -j: threads for the multi-threaded runs (one per processor)
+ *              -s: seed for the corpus (1)
+ *              -o: also writes the corpus into dir, as one pgm per grid
+ *                  named after its kind (e.g. 00042-swapped.pgm) and as
+ *                  boards.bin, every grid as a packed Board one after
+ *                  another
+ *
+ *            Prints grids per second for parsing pgms into boards,
+ *            checking boards, and both (as sudoku does for each file),
+ *            then for answering boards from a cache (as sudoku -c does for
+ *            a board seen before): keyed on the exact board, and keyed on
+ *            its canonical form, which also answers the board's relabeled
+ *            and transposed variants. Comparing the last two with the
+ *            checks shows whether canonical forms pay.
+ *            Exits with EXIT_FAILURE if the checks do not find exactly the
+ *            solved grids of the corpus
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <pnmrdr.h>
+
+#include "board.h"
+#include "cache.h"
+
+/* "P2\n9 9\n9\n" and nine rows of "d d d d d d d d d\n" */
+#define PGM_HEADER 9
+#define PGM_LENGTH (PGM_HEADER + BOARD_SIDE * 2 * BOARD_SIDE)
+
+/* What is wrong with a grid of the corpus */
+enum kind { VALID, SWAPPED, DUPLICATE_BOX, OUT_OF_RANGE, NUM_KINDS };
+
+static const char *const KIND_NAMES[NUM_KINDS] = {
+        "valid", "swapped", "duplicate", "range"
+};
+
+/* 
+ * What is measured: reading pgms, checking boards, both, or answering 
+ * boards from a cache keyed on the board or on its canonical form
+ */
+enum phase { PARSE, VALIDATE, END_TO_END, CACHE_EXACT, CACHE_CANONICAL,
+             NUM_PHASES };
+
+static const char *const PHASE_NAMES[NUM_PHASES] = {
+        "parse", "validate", "end-to-end", "cache-exact", "cache-canon"
+};
+
+/* What the command line asked for */
+struct options {
+        int grids;              /* -n: grids in the corpus */
+        int rounds;             /* -r: passes over the corpus per run */
+        int threads;            /* -j: threads for the parallel runs */
+        uint64_t seed;          /* -s: seed for the corpus */
+        const char *dir;        /* -o: directory to write the corpus to */
+};
+
+/* The grids, each as a pgm and as a packed board */
+struct corpus {
+        int size;
+        enum kind *kinds;
+        char *pgms;             /* grid i at pgms + i * PGM_LENGTH */
+        Board *boards;
+        int num_valid;
+        Cache_T exact;          /* every board's answer, keyed on the board */
+        Cache_T canonical;      /* the same, keyed on its canonical form */
+};
+
+/* One thread's share of a run */
+struct job {
+        const struct corpus *corpus;
+        enum phase phase;
+        int first, last;        /* grids first to last - 1 */
+        int rounds;
+        long solved;            /* set to the grids found solved */
+};
+
+struct options parse_options(int argc, char *argv[]);
+struct corpus make_corpus(int size, uint64_t seed);
+void free_corpus(struct corpus *corpus);
+void write_corpus(const struct corpus *corpus, const char *dir);
+void make_grid(int grid[BOARD_CELLS], enum kind kind, uint64_t *state);
+void shuffle(int *items, int length, uint64_t *state);
+uint64_t next_random(uint64_t *state);
+void format_pgm(const int grid[BOARD_CELLS], char *pgm);
+void parse_pgm(const char *pgm, Board *board);
+void fill_caches(struct corpus *corpus);
+void *run_job(void *cl);
+double measure(const struct corpus *corpus, enum phase phase, int rounds,
+                                                        int threads);
+
+
+int main(int argc, char *argv[])
+{
+        struct options opts = parse_options(argc, argv);
+        struct corpus corpus = make_corpus(opts.grids, opts.seed);
+        if (opts.dir != NULL) {
+                write_corpus(&corpus, opts.dir);
+        }
+
+        printf("%d grids (%d solved), seed %llu, %d rounds\n", corpus.size,
+               corpus.num_valid, (unsigned long long)opts.seed,
+               opts.rounds);
+        printf("%-12s %16s %16s\n", "", "1 thread", "threads");
+        for (int phase = 0; phase < NUM_PHASES; phase++) {
+                double single = measure(&corpus, phase, opts.rounds, 1);
+                double parallel = measure(&corpus, phase, opts.rounds,
+                                          opts.threads);
+                printf("%-12s %14.0f/s %14.0f/s (%d)\n", PHASE_NAMES[phase],
+                       single, parallel, opts.threads);
+        }
+
+        free_corpus(&corpus);
+        exit(EXIT_SUCCESS);
+}
+
+/**********parse_options********
+ *
+ * Reads the command line into a struct options
+ * Inputs:
+ *              int argc: number of command line arguments
+ *              char *argv[]: the command line arguments
+ * Return: the options given, with defaults for those that were not
+ * Expects:
+ *      every option to be followed by a value
+ * Notes:
+ *      Checked runtime error if an option is unknown or missing its value,
+ *      or if a count is not positive
+ ************************/
+struct options parse_options(int argc, char *argv[])
+{
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        struct options opts = { 10000, 10, processors > 0 ? processors : 1,
+                                1, NULL };
+
+        for (int i = 1; i < argc; i++) {
+                assert(i + 1 < argc);
+                if (strcmp(argv[i], "-n") == 0) {
+                        opts.grids = atoi(argv[++i]);
+                } else if (strcmp(argv[i], "-r") == 0) {
+                        opts.rounds = atoi(argv[++i]);
+                } else if (strcmp(argv[i], "-j") == 0) {
+                        opts.threads = atoi(argv[++i]);
+                } else if (strcmp(argv[i], "-s") == 0) {
+                        opts.seed = strtoull(argv[++i], NULL, 10);
+                } else if (strcmp(argv[i], "-o") == 0) {
+                        opts.dir = argv[++i];
+                } else {
+                        assert(false);
+                }
+        }
+        assert(opts.grids > 0 && opts.rounds > 0 && opts.threads > 0);
+        return opts;
+}
+
+/**********make_corpus********
+ *
+ * Generates the grids to measure
+ * Inputs:
+ *              int size: the number of grids
+ *              uint64_t seed: picks the grids; the same seed always gives
+ *                             the same corpus
+ * Return: the corpus
+ * Expects:
+ *      size to be positive
+ * Notes:
+ *      * Kinds take turns, so a quarter of the grids are solved
+ *      * Every grid is answered in both caches, as in fill_caches
+ *      * Checked runtime error if memory cannot be allocated
+ *      * The client must use free_corpus when done
+ ************************/
+struct corpus make_corpus(int size, uint64_t seed)
+{
+        struct corpus corpus = { size, malloc(size * sizeof(enum kind)),
+                                 malloc((size_t)size * PGM_LENGTH),
+                                 malloc(size * sizeof(Board)), 0, NULL, 
+                                 NULL };
+        assert(corpus.kinds != NULL && corpus.pgms != NULL &&
+               corpus.boards != NULL);
+
+        /* xorshift must not start from 0 */
+        uint64_t state = seed * 0x9e3779b97f4a7c15u + 1;
+        for (int i = 0; i < size; i++) {
+                int grid[BOARD_CELLS];
+                corpus.kinds[i] = i % NUM_KINDS;
+                make_grid(grid, corpus.kinds[i], &state);
+
+                char *pgm = corpus.pgms + (size_t)i * PGM_LENGTH;
+                format_pgm(grid, pgm);
+                parse_pgm(pgm, &corpus.boards[i]);
+                corpus.num_valid += corpus.kinds[i] == VALID;
+        }
+        fill_caches(&corpus);
+        return corpus;
+}
+
+/**********free_corpus********
+ *
+ * Deallocates the grids of a corpus
+ * Inputs:
+ *              struct corpus *corpus: the corpus
+ * Return: N/A
+ * Expects:
+ *      corpus to be nonnull
+ * Notes:
+ *      N/A
+ ************************/
+void free_corpus(struct corpus *corpus)
+{
+        assert(corpus != NULL);
+        free(corpus->kinds);
+        free(corpus->pgms);
+        free(corpus->boards);
+        Cache_free(&corpus->exact);
+        Cache_free(&corpus->canonical);
+}
+
+/**********write_corpus********
+ *
+ * Writes every grid of a corpus into a directory
+ * Inputs:
+ *              const struct corpus *corpus: the corpus
+ *              const char *dir: an existing directory
+ * Return: N/A
+ * Expects:
+ *      corpus and dir to be nonnull
+ * Notes:
+ *      * Grid i goes to dir/iiiii-kind.pgm, and all of them to
+ *      dir/boards.bin as packed Boards
+ *      * Checked runtime error if a file cannot be written
+ ************************/
+void write_corpus(const struct corpus *corpus, const char *dir)
+{
+        assert(corpus != NULL && dir != NULL);
+        size_t length = strlen(dir) + 32;
+        char *path = malloc(length);
+        assert(path != NULL);
+
+        for (int i = 0; i < corpus->size; i++) {
+                snprintf(path, length, "%s/%05d-%s.pgm", dir, i,
+                         KIND_NAMES[corpus->kinds[i]]);
+                FILE *file = fopen(path, "w");
+                assert(file != NULL);
+                fwrite(corpus->pgms + (size_t)i * PGM_LENGTH, 1, PGM_LENGTH,
+                       file);
+                fclose(file);
+        }
+
+        snprintf(path, length, "%s/boards.bin", dir);
+        FILE *file = fopen(path, "wb");
+        assert(file != NULL);
+        size_t written = fwrite(corpus->boards, sizeof(Board), corpus->size,
+                                file);
+        assert(written == (size_t)corpus->size);
+        fclose(file);
+        free(path);
+}
+
+/**********make_grid********
+ *
+ * Generates one grid of a given kind
+ * Inputs:
+ *              int grid[BOARD_CELLS]: set to the grid, row by row
+ *              enum kind kind: what is to be wrong with it
+ *              uint64_t *state: the random number generator
+ * Return: N/A
+ * Expects:
+ *      grid and state to be nonnull
+ * Notes:
+ *      * Starts from a fixed solved grid and applies random changes that
+ *      keep it solved: relabeling the digits, reordering the rows of each
+ *      band, the bands, the columns of each stack and the stacks, and
+ *      perhaps transposing
+ *      * Then breaks it as kind says: SWAPPED swaps two cells of a row
+ *      (breaking two columns), DUPLICATE_BOX copies a box over another in
+ *      its band, and OUT_OF_RANGE blanks a cell (0 is the only value out of
+ *      range a pgm of denominator 9 can hold)
+ ************************/
+void make_grid(int grid[BOARD_CELLS], enum kind kind, uint64_t *state)
+{
+        int labels[BOARD_SIDE], rows[BOARD_SIDE], cols[BOARD_SIDE];
+        int bands[3] = { 0, 1, 2 }, stacks[3] = { 0, 1, 2 };
+        for (int i = 0; i < BOARD_SIDE; i++) {
+                labels[i] = i + 1;
+                rows[i] = cols[i] = i % 3;
+        }
+        shuffle(labels, BOARD_SIDE, state);
+        shuffle(bands, 3, state);
+        shuffle(stacks, 3, state);
+        for (int i = 0; i < 3; i++) {
+                shuffle(rows + 3 * i, 3, state);
+                shuffle(cols + 3 * i, 3, state);
+        }
+        bool transpose = next_random(state) & 1;
+
+        for (int row = 0; row < BOARD_SIDE; row++) {
+                for (int col = 0; col < BOARD_SIDE; col++) {
+                        int r = 3 * bands[row / 3] + rows[row];
+                        int c = 3 * stacks[col / 3] + cols[col];
+                        int base = (3 * (r % 3) + r / 3 + c) % BOARD_SIDE;
+                        int cell = transpose ? col * BOARD_SIDE + row
+                                             : row * BOARD_SIDE + col;
+                        grid[cell] = labels[base];
+                }
+        }
+
+        int row = next_random(state) % BOARD_SIDE;
+        int col = next_random(state) % BOARD_SIDE;
+        int *cell = &grid[row * BOARD_SIDE + col];
+        if (kind == SWAPPED) {
+                int other = (col + 1 + next_random(state) % 8) % BOARD_SIDE;
+                int *swap = &grid[row * BOARD_SIDE + other];
+                int digit = *cell;
+                *cell = *swap;
+                *swap = digit;
+        } else if (kind == DUPLICATE_BOX) {
+                int from = 3 * (row / 3) * BOARD_SIDE + 3 * (col / 3);
+                int to = 3 * (row / 3) * BOARD_SIDE + 3 * ((col / 3 + 1) % 3);
+                for (int i = 0; i < 3; i++) {
+                        memcpy(&grid[to + i * BOARD_SIDE],
+                               &grid[from + i * BOARD_SIDE], 3 * sizeof(int));
+                }
+        } else if (kind == OUT_OF_RANGE) {
+                *cell = 0;
+        }
+}
+
+/**********shuffle********
+ *
+ * Puts an array in a random order (Fisher-Yates)
+ * Inputs:
+ *              int *items: the array
+ *              int length: its length
+ *              uint64_t *state: the random number generator
+ * Return: N/A
+ * Expects:
+ *      items and state to be nonnull
+ * Notes:
+ *      N/A
+ ************************/
+void shuffle(int *items, int length, uint64_t *state)
+{
+        for (int i = length - 1; i > 0; i--) {
+                int j = next_random(state) % (i + 1);
+                int item = items[i];
+                items[i] = items[j];
+                items[j] = item;
+        }
+}
+
+/**********next_random********
+ *
+ * Returns the next number of an xorshift64* generator
+ * Inputs:
+ *              uint64_t *state: the generator's state, updated
+ * Return: a random 32-bit number
+ * Expects:
+ *      state to be nonnull and *state nonzero
+ * Notes:
+ *      Used instead of rand so the corpus is the same on every platform
+ ************************/
+uint64_t next_random(uint64_t *state)
+{
+        *state ^= *state >> 12;
+        *state ^= *state << 25;
+        *state ^= *state >> 27;
+        return (*state * 0x2545f4914f6cdd1du) >> 32;
+}
+
+/**********format_pgm********
+ *
+ * Writes a grid as a plain pgm
+ * Inputs:
+ *              const int grid[BOARD_CELLS]: the grid, each cell 0 to 9
+ *              char *pgm: set to the pgm, PGM_LENGTH characters with no
+ *                         terminating null
+ * Return: N/A
+ * Expects:
+ *      grid and pgm to be nonnull
+ * Notes:
+ *      N/A
+ ************************/
+void format_pgm(const int grid[BOARD_CELLS], char *pgm)
+{
+        memcpy(pgm, "P2\n9 9\n9\n", PGM_HEADER);
+        char *next = pgm + PGM_HEADER;
+        for (int cell = 0; cell < BOARD_CELLS; cell++) {
+                *next++ = '0' + grid[cell];
+                *next++ = cell % BOARD_SIDE == BOARD_SIDE - 1 ? '\n' : ' ';
+        }
+}
+
+/**********parse_pgm********
+ *
+ * Reads a pgm into a board the way sudoku does
+ * Inputs:
+ *              const char *pgm: the pgm, PGM_LENGTH characters
+ *              Board *board: set to the board it holds
+ * Return: N/A
+ * Expects:
+ *      pgm to be a 9 x 9 pgm of denominator 9; board to be nonnull
+ * Notes:
+ *      * Goes through Pnmrdr from an in-memory stream, so the time 
+ *      measured is that of sudoku_puzzle without the file system
+ *      * board is cleared first, so its unused bits are 0 and the boards 
+ *      written to boards.bin hold no stray bytes
+ ************************/
+void parse_pgm(const char *pgm, Board *board)
+{
+        FILE *stream = fmemopen((void *)pgm, PGM_LENGTH, "r");
+        assert(stream != NULL);
+        Pnmrdr_T input = Pnmrdr_new(stream);
+
+        Board_clear(board);
+        for (int row = 0; row < BOARD_SIDE; row++) {
+                for (int col = 0; col < BOARD_SIDE; col++) {
+                        unsigned sample = Pnmrdr_get(input);
+                        Board_set(board, col, row,
+                                  sample > 9 ? -1 : (int)sample);
+                }
+        }
+        Pnmrdr_free(&input);
+        fclose(stream);
+}
+
+/**********fill_caches********
+ *
+ * Makes the caches of a corpus and answers every grid in them
+ * Inputs:
+ *              struct corpus *corpus: the corpus, its boards made
+ * Return: N/A
+ * Expects:
+ *      corpus to be nonnull
+ * Notes:
+ *      * Each cache is kept in memory, with at least twice as many slots as
+ *      there are grids, so nearly every lookup made by the cache phases
+ *      hits. Those that miss are checked instead, as sudoku would
+ *      * A board's canonical form stands for the board here. A relabeled
+ *      or transposed variant of it would be looked up the same way, at the
+ *      same cost, so the cache-canon phase times what answering a variant
+ *      costs
+ ************************/
+void fill_caches(struct corpus *corpus)
+{
+        assert(corpus != NULL);
+        int log2_slots = 1;
+        while (((int64_t)1 << log2_slots) < 2 * (int64_t)corpus->size) {
+                log2_slots++;
+        }
+        corpus->exact = Cache_new(NULL, log2_slots);
+        corpus->canonical = Cache_new(NULL, log2_slots);
+
+        for (int i = 0; i < corpus->size; i++) {
+                const Board *board = &corpus->boards[i];
+                Cache_insert(corpus->exact, board, Board_hash(board),
+                             Board_solved(board));
+                Board canonical;
+                Board_canonical(board, &canonical);
+                Cache_insert(corpus->canonical, &canonical, 
+                             Board_hash(&canonical), Board_solved(board));
+        }
+}
+
+/**********run_job********
+ *
+ * Runs one thread's share of a measurement
+ * Inputs:
+ *              void *cl: the struct job
+ * Return: NULL
+ * Expects:
+ *      cl to be nonnull
+ * Notes:
+ *      Counts the grids found solved into job->solved, which also keeps
+ *      the compiler from dropping the work
+ ************************/
+void *run_job(void *cl)
+{
+        struct job *job = cl;
+        const struct corpus *corpus = job->corpus;
+        long solved = 0;
+
+        for (int round = 0; round < job->rounds; round++) {
+                for (int i = job->first; i < job->last; i++) {
+                        const char *pgm = corpus->pgms + (size_t)i *
+                                                                PGM_LENGTH;
+                        Board board;
+                        bool answer;
+                        switch (job->phase) {
+                        case PARSE:
+                                parse_pgm(pgm, &board);
+                                solved += Board_equal(&board, 
+                                                      &corpus->boards[i]) &&
+                                          corpus->kinds[i] == VALID;
+                                break;
+                        case VALIDATE:
+                                solved += Board_solved(&corpus->boards[i]);
+                                break;
+                        case CACHE_EXACT:
+                                board = corpus->boards[i];
+                                if (!Cache_lookup(corpus->exact, &board, 
+                                                  Board_hash(&board), 
+                                                  &answer)) {
+                                        answer = Board_solved(&board);
+                                }
+                                solved += answer;
+                                break;
+                        case CACHE_CANONICAL:
+                                Board_canonical(&corpus->boards[i], &board);
+                                if (!Cache_lookup(corpus->canonical, &board,
+                                                  Board_hash(&board),
+                                                  &answer)) {
+                                        answer = Board_solved(&board);
+                                }
+                                solved += answer;
+                                break;
+                        default:
+                                parse_pgm(pgm, &board);
+                                solved += Board_solved(&board);
+                                break;
+                        }
+                }
+        }
+        job->solved = solved;
+        return NULL;
+}
+
+/**********measure********
+ *
+ * Times one phase over the corpus
+ * Inputs:
+ *              const struct corpus *corpus: the corpus
+ *              enum phase phase: what to time
+ *              int rounds: passes over the corpus
+ *              int threads: threads to split the corpus between
+ * Return: grids handled per second, over all threads
+ * Expects:
+ *      corpus to be nonnull; rounds and threads positive
+ * Notes:
+ *      * Each thread takes a contiguous share of the grids
+ *      * Exits with EXIT_FAILURE if the grids found solved are not exactly
+ *      the solved grids of the corpus, so a wrong validator cannot post
+ *      a time
+ *      * Checked runtime error if a thread cannot be started
+ ************************/
+double measure(const struct corpus *corpus, enum phase phase, int rounds,
+                                                        int threads)
+{
+        struct job *jobs = malloc(threads * sizeof(struct job));
+        pthread_t *ids = malloc(threads * sizeof(pthread_t));
+        assert(jobs != NULL && ids != NULL);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < threads; i++) {
+                jobs[i] = (struct job){ corpus, phase,
+                                        (long)corpus->size * i / threads,
+                                        (long)corpus->size * (i + 1) /
+                                                                threads,
+                                        rounds, 0 };
+                int started = pthread_create(&ids[i], NULL, run_job,
+                                             &jobs[i]);
+                assert(started == 0);
+        }
+        long solved = 0;
+        for (int i = 0; i < threads; i++) {
+                pthread_join(ids[i], NULL);
+                solved += jobs[i].solved;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        free(jobs);
+        free(ids);
+        if (solved != (long)corpus->num_valid * rounds) {
+                fprintf(stderr, "%s: found %ld solved grids, expected %ld\n",
+                        PHASE_NAMES[phase], solved,
+                        (long)corpus->num_valid * rounds);
+                exit(EXIT_FAILURE);
+        }
+
+        double seconds = (end.tv_sec - start.tv_sec) +
+                         (end.tv_nsec - start.tv_nsec) / 1e9;
+        return (double)corpus->size * rounds / seconds;
+}
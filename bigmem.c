@@ -0,0 +1,161 @@
+/*
+ *     bigmem.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of large allocations. Blocks of 2 MiB or 
+ *              more with a policy other than the default are mapped 
+ *              straight from the kernel on a 2 MiB boundary: with 
+ *              huge_pages, explicit huge pages are tried first and 
+ *              transparent ones asked for otherwise. Such a block is never
+ *              written here: its zeros come from the kernel, so each page 
+ *              is placed (on Linux, on the NUMA node of the thread that 
+ *              first touches it) when the client first writes it. 
+ *              Everything else comes from calloc, which may hand back, and
+ *              clear, memory it already holds.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+#include "bigmem.h"
+
+#define HUGE_PAGE ((size_t)2 << 20)
+
+const Bigmem_policy Bigmem_default = { false, false };
+
+static bool is_mapped(size_t bytes, Bigmem_policy policy);
+static void *map_block(size_t length, bool huge_pages);
+
+/**********Bigmem_alloc********
+ *
+ * Allocates a block of memory, following a policy
+ * Inputs:
+ *              size_t bytes: the size of the block
+ *              Bigmem_policy policy: how to allocate it
+ * Return: the block, with every byte zero
+ * Expects:
+ *      None
+ * Notes:
+ *      * Huge pages are a request, not a promise: without them (no 
+ *      reserved pages, transparent huge pages off) the block is made of 
+ *      ordinary pages and works the same
+ *      * With first_touch, a block of 2 MiB or more is left untouched, so
+ *      a client that has each of its threads write its own band of the 
+ *      block first gets each band on that thread's node
+ *      * Checked runtime error if the memory cannot be allocated
+ *      * The block must be freed with Bigmem_free, with the same bytes and
+ *      policy
+ ************************/
+void *Bigmem_alloc(size_t bytes, Bigmem_policy policy)
+{
+        if (!is_mapped(bytes, policy)) {
+                void *block = calloc(bytes > 0 ? bytes : 1, 1);
+                assert(block != NULL);
+                return block;
+        }
+
+        size_t length = (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+        return map_block(length, policy.huge_pages);
+}
+
+/**********Bigmem_free********
+ *
+ * Frees a block from Bigmem_alloc
+ * Inputs:
+ *              void *memory: the block, or NULL
+ *              size_t bytes: the size it was allocated with
+ *              Bigmem_policy policy: the policy it was allocated with
+ * Return: N/A
+ * Expects:
+ *      bytes and policy to be those given to Bigmem_alloc
+ * Notes:
+ *      Does nothing when memory is NULL
+ ************************/
+void Bigmem_free(void *memory, size_t bytes, Bigmem_policy policy)
+{
+        if (memory == NULL) {
+                return;
+        }
+        if (is_mapped(bytes, policy)) {
+                munmap(memory, (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1));
+        } else {
+                free(memory);
+        }
+}
+
+/**********is_mapped********
+ *
+ * Decides whether a block is mapped from the kernel or calloc'd
+ * Inputs:
+ *              size_t bytes: the size of the block
+ *              Bigmem_policy policy: its policy
+ * Return: true if the block is mapped
+ * Expects:
+ *      None
+ * Notes:
+ *      Depends on nothing else, so Bigmem_free makes the same choice as 
+ *      Bigmem_alloc did
+ ************************/
+static bool is_mapped(size_t bytes, Bigmem_policy policy)
+{
+        return bytes >= HUGE_PAGE && 
+               (policy.huge_pages || policy.first_touch);
+}
+
+/**********map_block********
+ *
+ * Maps an untouched, zeroed block starting on a 2 MiB boundary
+ * Inputs:
+ *              size_t length: the size, a multiple of 2 MiB
+ *              bool huge_pages: whether to back it with huge pages
+ * Return: the block
+ * Expects:
+ *      length to be a positive multiple of HUGE_PAGE
+ * Notes:
+ *      * Explicit huge pages (MAP_HUGETLB) only work when some have been
+ *      reserved, so on failure an ordinary mapping is made instead, with 
+ *      transparent huge pages asked for
+ *      * The ordinary mapping is made 2 MiB too long and trimmed to the 
+ *      boundary, since only aligned 2 MiB ranges can become huge pages
+ *      * Checked runtime error if no mapping can be made
+ ************************/
+static void *map_block(size_t length, bool huge_pages)
+{
+#ifdef MAP_HUGETLB
+        if (huge_pages) {
+                void *block = mmap(NULL, length, PROT_READ | PROT_WRITE, 
+                                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                                   -1, 0);
+                if (block != MAP_FAILED) {
+                        return block;
+                }
+        }
+#endif
+
+        char *raw = mmap(NULL, length + HUGE_PAGE, PROT_READ | PROT_WRITE, 
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(raw != MAP_FAILED);
+        char *block = (char *)(((uintptr_t)raw + HUGE_PAGE - 1) & 
+                                                        ~(HUGE_PAGE - 1));
+        if (block > raw) {
+                munmap(raw, block - raw);
+        }
+        size_t tail = (raw + length + HUGE_PAGE) - (block + length);
+        if (tail > 0) {
+                munmap(block + length, tail);
+        }
+
+#ifdef MADV_HUGEPAGE
+        if (huge_pages) {
+                madvise(block, length, MADV_HUGEPAGE);
+        }
+#else
+        (void)huge_pages;
+#endif
+        return block;
+}
@@ -0,0 +1,32 @@
+/*
+ *     bigmem.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for allocating the storage of large arrays, with
+ *              a policy for backing it with huge pages and for leaving its
+ *              first touch (and so its placement) to the threads that 
+ *              write each part of it
+ */
+
+#ifndef BIGMEM_INCLUDED
+#define BIGMEM_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* How the memory behind a large array is allocated */
+typedef struct Bigmem_policy {
+        bool huge_pages;        /* back it with 2 MiB pages if possible */
+        bool first_touch;       /* leave every page untouched, for the 
+                                   threads that write each band of it to
+                                   place on their own NUMA nodes */
+} Bigmem_policy;
+
+/* plain calloc'd memory */
+extern const Bigmem_policy Bigmem_default;
+
+extern void *Bigmem_alloc(size_t bytes, Bigmem_policy policy);
+extern void Bigmem_free(void *memory, size_t bytes, Bigmem_policy policy);
+
+#endif
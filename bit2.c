@@ -8,19 +8,71 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #include "bit2.h"
-#include "bit.h"
+#include "bitwords.h"
 
 #define T Bit2_T
 
+#define WORD_BITS 64
+
+/* 
+ * Bits are packed into 64-bit words, with every row starting on a fresh word
+ * so that whole rows can be scanned a word at a time. Column col of a row 
+ * lives in bit (col % 64) of word (col / 64). Padding bits past the width
+ * are always zero. Since no two rows share a word, different threads may 
+ * write different rows at the same time.
+ */
 struct T {
-        Bit_T bit_array;
+        uint64_t *words;
+        size_t capacity;        /* words allocated, at least those in use */
+        Bigmem_policy policy;   /* how words is allocated */
+        int words_per_row;
         int width;
         int height;
+        int mapping;            /* column-major maps running on the array */
+        unsigned long writes;   /* writes made while mapping */
 };
 
+static inline uint64_t *row_words(T bit2_array, int row)
+{
+        return bit2_array->words + (size_t)row * bit2_array->words_per_row;
+}
+
+/* Word w of a row, or 0 past the end of the row */
+static inline uint64_t load_word(T bit2_array, int row, int w)
+{
+        return w < bit2_array->words_per_row ? row_words(bit2_array, row)[w]
+                                             : 0;
+}
+
+/* Counts a write that may change bits, if a column-major map is running */
+static inline void wrote(T bit2_array)
+{
+        if (bit2_array->mapping != 0) {
+                bit2_array->writes++;
+        }
+}
+
+/* Sets the bits of mask in word w of a row to those of value */
+static inline void store_word(T bit2_array, int row, int w, uint64_t value,
+                                                        uint64_t mask)
+{
+        uint64_t *word = &row_words(bit2_array, row)[w];
+        uint64_t old = *word;
+        *word = (old & ~mask) | (value & mask);
+        if (*word != old) {
+                wrote(bit2_array);
+        }
+}
+
+static uint64_t view_word(Bit2_view view, int row, int i);
+static void load_tile(T bit2_array, int w, int tr, uint64_t tile[WORD_BITS]);
+
 /**********Bit2_new********
  *
  * Creates a new vector of width x height bits and sets all the bits to zero 
@@ -38,6 +90,30 @@ struct T {
  *      requested
  ************************/
 T Bit2_new(int width, int height) 
+{
+        return Bit2_new_policy(width, height, Bigmem_default);
+}
+
+/**********Bit2_new_policy********
+ *
+ * Creates a new width x height bit2 array of zeros, allocating its bits as
+ * a policy says
+ * Inputs:
+ *              int width, int height: the size of the array
+ *              Bigmem_policy policy: how to allocate the bits, here and
+ *                                    whenever Bit2_resize reallocates them
+ * Return: A new bit2 array
+ * Expects:
+ *      width and height to be nonnegative
+ * Notes:
+ *      * Checked runtime error if width or height is negative, or memory 
+ *      cannot be allocated
+ *      * For images of many megabytes, huge pages cut TLB misses on scans,
+ *      and first_touch leaves each band of rows to be placed on the NUMA
+ *      node of the thread that first writes it, with Bit2_put_row_words.
+ *      Bit2_resize clears memory it reuses, which does not move it
+ ************************/
+T Bit2_new_policy(int width, int height, Bigmem_policy policy)
 {
         T bit2_array = malloc(sizeof(*bit2_array));
         assert(bit2_array != NULL);
@@ -47,8 +123,15 @@ T Bit2_new(int width, int height)
 
         bit2_array->width = width;
         bit2_array->height = height;
+        bit2_array->words_per_row = (width + WORD_BITS - 1) / WORD_BITS;
+        bit2_array->mapping = 0;
+        bit2_array->writes = 0;
 
-        bit2_array->bit_array = Bit_new(width * height);
+        size_t num_words = (size_t)bit2_array->words_per_row * height;
+        bit2_array->capacity = num_words > 0 ? num_words : 1;
+        bit2_array->policy = policy;
+        bit2_array->words = Bigmem_alloc(bit2_array->capacity * 
+                                         sizeof(uint64_t), policy);
 
         return bit2_array;
 }
@@ -67,8 +150,53 @@ T Bit2_new(int width, int height)
  ************************/
 void Bit2_free(T *bit2_array)
 {
-        Bit_free(&((*bit2_array)->bit_array));
+        assert(bit2_array != NULL && *bit2_array != NULL);
+        Bigmem_free((*bit2_array)->words, 
+                    (*bit2_array)->capacity * sizeof(uint64_t), 
+                    (*bit2_array)->policy);
         free(*bit2_array);
+        *bit2_array = NULL;
+}
+
+/**********Bit2_resize********
+ *
+ * Changes the size of bit2_array and sets all of its bits to zero, reusing
+ * its memory when there is enough of it
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to resize
+ *              int width: the new number of columns
+ *              int height: the new number of rows
+ * Return: N/A
+ * Expects:
+ *      bit2_array to be nonnull; width and height to be nonnegative
+ * Notes:
+ *      * Checked runtime error if bit2_array is null, width or height is 
+ *      negative, or memory cannot be allocated
+ *      * Memory is only reallocated when the array grows past the largest
+ *      size it has had, so a run of images of mixed sizes settles on one 
+ *      allocation
+ ************************/
+void Bit2_resize(T bit2_array, int width, int height)
+{
+        assert(bit2_array != NULL);
+        assert(width >= 0 && height >= 0);
+
+        int words_per_row = (width + WORD_BITS - 1) / WORD_BITS;
+        size_t num_words = (size_t)words_per_row * height;
+        if (num_words > bit2_array->capacity) {
+                Bigmem_free(bit2_array->words, 
+                            bit2_array->capacity * sizeof(uint64_t), 
+                            bit2_array->policy);
+                bit2_array->words = Bigmem_alloc(num_words * 
+                                sizeof(uint64_t), bit2_array->policy);
+                bit2_array->capacity = num_words;
+        } else {
+                memset(bit2_array->words, 0, num_words * sizeof(uint64_t));
+        }
+
+        bit2_array->width = width;
+        bit2_array->height = height;
+        bit2_array->words_per_row = words_per_row;
 }
 
 /**********Bit2_width********
@@ -86,7 +214,7 @@ void Bit2_free(T *bit2_array)
 int Bit2_width(T bit2_array) 
 {
         assert(bit2_array != NULL);
-        assert(bit2_array->bit_array != NULL);
+        assert(bit2_array->words != NULL);
         return bit2_array->width;
 }
 
@@ -105,7 +233,7 @@ int Bit2_width(T bit2_array)
 int Bit2_height(T bit2_array)
 {
         assert(bit2_array != NULL);
-        assert(bit2_array->bit_array != NULL);
+        assert(bit2_array->words != NULL);
         return bit2_array->height;
 }
 
@@ -131,7 +259,8 @@ int Bit2_get(T bit2_array, int col, int row)
         assert(bit2_array != NULL);
         assert(col >= 0 && col < bit2_array->width);
         assert(row >= 0 && row < bit2_array->height);
-        return Bit_get(bit2_array->bit_array, row * bit2_array->width + col);
+        return (row_words(bit2_array, row)[col / WORD_BITS] 
+                                        >> (col % WORD_BITS)) & 1;
 }
 
 /**********Bit2_put********
@@ -163,8 +292,82 @@ int Bit2_put(T bit2_array, int col, int row, int bit)
         assert(col >= 0 && col < bit2_array->width);
         assert(row >= 0 && row < bit2_array->height);
         assert(bit == 0 || bit == 1);
-        return Bit_put(bit2_array->bit_array, row * bit2_array->width + col, 
-                                                                        bit);
+
+        uint64_t *word = &row_words(bit2_array, row)[col / WORD_BITS];
+        uint64_t mask = (uint64_t)1 << (col % WORD_BITS);
+        int prev_bit = (*word & mask) != 0;
+
+        if (bit == 1) {
+                *word |= mask;
+        } else {
+                *word &= ~mask;
+        }
+        if (prev_bit != bit) {
+                wrote(bit2_array);
+        }
+        return prev_bit;
+}
+
+/**********Bit2_get_row_words********
+ *
+ * Copies one row of bit2_array out as packed 64-bit words
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be read
+ *              int row: the row to copy
+ *              uint64_t *words: set to the row, (width + 63) / 64 words, 
+ *                               with column col in bit (col % 64) of word
+ *                               (col / 64)
+ * Return: N/A
+ * Expects:
+ *      * bit2_array and words to be nonnull
+ *      * row to be positive and less than the height of bit2_array
+ * Notes:
+ *      * Checked runtime error if bit2_array or words is null, or row is out
+ *      of range
+ *      * Bits past the width of bit2_array are zero
+ ************************/
+void Bit2_get_row_words(T bit2_array, int row, uint64_t *words)
+{
+        assert(bit2_array != NULL && words != NULL);
+        assert(row >= 0 && row < bit2_array->height);
+        memcpy(words, row_words(bit2_array, row), 
+                        bit2_array->words_per_row * sizeof(uint64_t));
+}
+
+/**********Bit2_put_row_words********
+ *
+ * Sets one row of bit2_array from packed 64-bit words
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be changed
+ *              int row: the row to set
+ *              const uint64_t *words: the new row, laid out as for 
+ *                                     Bit2_get_row_words
+ * Return: N/A
+ * Expects:
+ *      * bit2_array and words to be nonnull
+ *      * row to be positive and less than the height of bit2_array
+ * Notes:
+ *      * Checked runtime error if bit2_array or words is null, or row is out
+ *      of range
+ *      * Bits past the width of bit2_array are ignored
+ ************************/
+void Bit2_put_row_words(T bit2_array, int row, const uint64_t *words)
+{
+        assert(bit2_array != NULL && words != NULL);
+        assert(row >= 0 && row < bit2_array->height);
+        int wpr = bit2_array->words_per_row;
+        if (wpr == 0) {
+                return;
+        }
+
+        uint64_t *dest = row_words(bit2_array, row);
+        memcpy(dest, words, wpr * sizeof(uint64_t));
+        wrote(bit2_array);
+
+        int tail_bits = bit2_array->width - (wpr - 1) * WORD_BITS;
+        if (tail_bits < WORD_BITS) {
+                dest[wpr - 1] &= ((uint64_t)1 << tail_bits) - 1;
+        }
 }
 
 /**********Bit2_map_row_major********
@@ -240,25 +443,648 @@ void Bit2_map_row_major(T bit2_array, void apply(int col, int row,
  * Return: N/A
  * Expects: 
  *      * bit2_array to be nonnull
- *      * The row value is positive and < the height of the bit2_array 
- *      * The col value is positive and < the width of the bit2_array
- *      * bit to be zero or one
  * Notes:
- *      * Checked runtime error if:
- *              * bit2_array is null 
- *              * row value >= height
- *              * col value >= width
- *              * bit is not zero or one
- *      Updates the bit2_array entered in as the first parameter 
+ *      * Checked runtime error if bit2_array is null 
+ *      * Works through the array in strips of 64 columns. Each strip is 
+ *      transposed a 64 x 64 tile at a time, so that each column can be read
+ *      from consecutive words instead of one word per row
+ *      * apply sees every change made before it is called, its own 
+ *      included, as if each bit were read with Bit2_get. The array counts
+ *      its writes while it is being mapped, and once apply changes it the
+ *      rest of the strip is read a bit at a time with Bit2_get; the next
+ *      strip is read afresh
+ *      * apply must not resize bit2_array
  ************************/
 void Bit2_map_col_major(T bit2_array, void apply(int col, int row, 
                                 T bit2_array, int bit, void *cl), void *cl)
 {
         assert(bit2_array != NULL);
-        for (int c = 0; c < bit2_array->width; c++) {
-                for (int r = 0; r < bit2_array->height; r++) {
-                        apply(c, r, bit2_array, Bit2_get(bit2_array, c, r), 
-                                                                        cl);
+        int tile_rows = (bit2_array->height + WORD_BITS - 1) / WORD_BITS;
+        uint64_t tile[WORD_BITS];
+
+        /* column j of the current strip is words [j * tile_rows, ...) */
+        uint64_t *strip = malloc((tile_rows > 0 ? tile_rows : 1) * 
+                                        WORD_BITS * sizeof(uint64_t));
+        assert(strip != NULL);
+
+        bit2_array->mapping++;
+        for (int w = 0; w < bit2_array->words_per_row; w++) {
+                for (int tr = 0; tr < tile_rows; tr++) {
+                        load_tile(bit2_array, w, tr, tile);
+                        transpose64(tile);
+                        for (int j = 0; j < WORD_BITS; j++) {
+                                strip[j * tile_rows + tr] = tile[j];
+                        }
+                }
+
+                bool fresh = true;      /* no write since the strip */
+                for (int j = 0; j < WORD_BITS; j++) {
+                        int c = w * WORD_BITS + j;
+                        if (c >= bit2_array->width) {
+                                break;
+                        }
+                        uint64_t *column = &strip[j * tile_rows];
+                        for (int r = 0; r < bit2_array->height; r++) {
+                                int bit = fresh ? (int)(column[r / WORD_BITS] 
+                                                        >> (r % WORD_BITS) & 1)
+                                                : Bit2_get(bit2_array, c, r);
+                                unsigned long writes = bit2_array->writes;
+                                apply(c, r, bit2_array, bit, cl);
+                                fresh = fresh && 
+                                        bit2_array->writes == writes;
+                        }
+                }
+        }
+        bit2_array->mapping--;
+        free(strip);
+}
+
+/**********Bit2_transpose********
+ *
+ * Creates a new bit2 array holding the transpose of bit2_array
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be transposed
+ * Return: A new height x width bit2 array whose bit at (row, col) is the bit
+ *         at (col, row) in bit2_array
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * Transposes a 64 x 64 tile at a time with a word-level kernel
+ *      * The client must use Bit2_free once the memory is no longer needed
+ ************************/
+T Bit2_transpose(T bit2_array)
+{
+        assert(bit2_array != NULL);
+        T transposed = Bit2_new(bit2_array->height, bit2_array->width);
+        uint64_t tile[WORD_BITS];
+
+        /* tile rows of bit2_array are word columns of transposed */
+        for (int tr = 0; tr < transposed->words_per_row; tr++) {
+                for (int w = 0; w < bit2_array->words_per_row; w++) {
+                        load_tile(bit2_array, w, tr, tile);
+                        transpose64(tile);
+                        for (int j = 0; j < WORD_BITS; j++) {
+                                int c = w * WORD_BITS + j;
+                                if (c >= bit2_array->width) {
+                                        break;
+                                }
+                                row_words(transposed, c)[tr] = tile[j];
+                        }
+                }
+        }
+        return transposed;
+}
+
+/**********Bit2_count********
+ *
+ * Returns the number of bits in bit2_array that are set to one
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be counted
+ * Return: the number of one bits in bit2_array
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * Counts a whole word at a time using popcount, so the cost is one
+ *      step per 64 bits rather than one per bit
+ ************************/
+long Bit2_count(T bit2_array)
+{
+        assert(bit2_array != NULL);
+        size_t num_words = (size_t)bit2_array->words_per_row * 
+                                                bit2_array->height;
+        long count = 0;
+
+        for (size_t i = 0; i < num_words; i++) {
+                count += __builtin_popcountll(bit2_array->words[i]);
+        }
+        return count;
+}
+
+/**********Bit2_bounding_box********
+ *
+ * Finds the smallest rectangle that contains every one bit in bit2_array
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be scanned
+ *              int *left, int *top: set to the column and row of the top left
+ *                                   corner of the rectangle
+ *              int *right, int *bottom: set to the column and row of the 
+ *                                       bottom right corner (inclusive)
+ * Return: 1 if bit2_array contains a one bit, 0 if it does not
+ * Expects:
+ *      bit2_array, left, top, right and bottom to be nonnull
+ * Notes:
+ *      * Checked runtime error if any of the pointers are null
+ *      * The corners are left untouched when 0 is returned
+ *      * Rows are scanned a word at a time, and the outermost bits of a row
+ *      are found with count-leading/trailing-zeros
+ ************************/
+int Bit2_bounding_box(T bit2_array, int *left, int *top, int *right, 
+                                                                int *bottom)
+{
+        assert(bit2_array != NULL);
+        assert(left != NULL && top != NULL);
+        assert(right != NULL && bottom != NULL);
+
+        int wpr = bit2_array->words_per_row;
+        int min_col = bit2_array->width;
+        int max_col = -1;
+        int min_row = -1;
+        int max_row = -1;
+
+        for (int r = 0; r < bit2_array->height; r++) {
+                uint64_t *words = row_words(bit2_array, r);
+                int first = 0;
+                int last = wpr - 1;
+
+                while (first < wpr && words[first] == 0) {
+                        first++;
+                }
+                if (first == wpr) {
+                        continue;
+                }
+                while (words[last] == 0) {
+                        last--;
+                }
+
+                int row_left = first * WORD_BITS + 
+                                        __builtin_ctzll(words[first]);
+                int row_right = last * WORD_BITS + (WORD_BITS - 1) - 
+                                        __builtin_clzll(words[last]);
+                if (row_left < min_col) {
+                        min_col = row_left;
+                }
+                if (row_right > max_col) {
+                        max_col = row_right;
                 }
+                if (min_row == -1) {
+                        min_row = r;
+                }
+                max_row = r;
+        }
+
+        if (min_row == -1) {
+                return 0;
         }
-}
\ No newline at end of file
+        *left = min_col;
+        *top = min_row;
+        *right = max_col;
+        *bottom = max_row;
+        return 1;
+}
+
+/**********Bit2_map_chunks********
+ *
+ * Calls an apply function once for each 64 x 64 tile of bit2_array, in row
+ * major order of the tiles, telling it whether the tile is all one value
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be mapped over
+ *              void apply: The function called for each tile
+ *                                              * parameters detailed below *
+ *                  int col, int row: the top left corner of the tile
+ *                  int width, int height: the size of the tile, which is 
+ *                                         smaller than 64 at the right and
+ *                                         bottom edges
+ *                  int uniform: 0 or 1 if every bit of the tile is that 
+ *                               value, -1 if the tile is mixed
+ *                  T bit2_array: the same bit2_array passed in
+ *                  void *cl: the closure passed in by the client
+ *              void *cl: A closure passed in by the client to be used in the
+ *                        apply function
+ * Return: N/A
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * Lets clients skip whole tiles that are all white or all black. In
+ *      this dense implementation, a tile is checked one word per row
+ ************************/
+void Bit2_map_chunks(T bit2_array, void apply(int col, int row, int width, 
+                        int height, int uniform, T bit2_array, void *cl), 
+                                                                void *cl)
+{
+        assert(bit2_array != NULL);
+
+        for (int r = 0; r < bit2_array->height; r += WORD_BITS) {
+                int tile_height = bit2_array->height - r;
+                if (tile_height > WORD_BITS) {
+                        tile_height = WORD_BITS;
+                }
+                for (int w = 0; w < bit2_array->words_per_row; w++) {
+                        int c = w * WORD_BITS;
+                        int tile_width = bit2_array->width - c;
+                        if (tile_width > WORD_BITS) {
+                                tile_width = WORD_BITS;
+                        }
+                        uint64_t full = tile_width == WORD_BITS ? ~(uint64_t)0
+                                : ((uint64_t)1 << tile_width) - 1;
+
+                        bool zeros = true;
+                        bool ones = true;
+                        for (int i = r; i < r + tile_height; i++) {
+                                uint64_t word = row_words(bit2_array, i)[w];
+                                zeros = zeros && word == 0;
+                                ones = ones && word == full;
+                        }
+
+                        int uniform = zeros ? 0 : (ones ? 1 : -1);
+                        apply(c, r, tile_width, tile_height, uniform, 
+                                                        bit2_array, cl);
+                }
+        }
+}
+
+/**********Bit2_map_set_bits********
+ *
+ * Calls an apply function for each bit in bit2_array that is one, in row
+ * major order
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be mapped over
+ *              void apply: The function called for each one bit, with the
+ *                          same parameters as for Bit2_map_row_major (bit is
+ *                          always 1)
+ *              void *cl: A closure passed in by the client to be used in the
+ *                        apply function
+ * Return: N/A
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * Skips zero words, and jumps straight to each one bit of a word with
+ *      count-trailing-zeros, so the cost follows the number of one bits
+ *      rather than the size of the array
+ *      * Each word is read once before its bits are visited, so changes
+ *      that apply makes to the rest of the current word are not seen
+ ************************/
+void Bit2_map_set_bits(T bit2_array, void apply(int col, int row, 
+                                T bit2_array, int bit, void *cl), void *cl)
+{
+        assert(bit2_array != NULL);
+        for (int r = 0; r < bit2_array->height; r++) {
+                uint64_t *words = row_words(bit2_array, r);
+                for (int w = 0; w < bit2_array->words_per_row; w++) {
+                        map_word_bits(words[w], w * WORD_BITS, r, 1, 
+                                                bit2_array, apply, cl);
+                }
+        }
+}
+
+/**********Bit2_map_clear_bits********
+ *
+ * Calls an apply function for each bit in bit2_array that is zero, in row
+ * major order
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be mapped over
+ *              void apply: The function called for each zero bit, with the
+ *                          same parameters as for Bit2_map_row_major (bit is
+ *                          always 0)
+ *              void *cl: A closure passed in by the client to be used in the
+ *                        apply function
+ * Return: N/A
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * The counterpart of Bit2_map_set_bits, working on the complement of
+ *      each word
+ ************************/
+void Bit2_map_clear_bits(T bit2_array, void apply(int col, int row, 
+                                T bit2_array, int bit, void *cl), void *cl)
+{
+        assert(bit2_array != NULL);
+        int wpr = bit2_array->words_per_row;
+        int tail_bits = bit2_array->width - (wpr - 1) * WORD_BITS;
+        uint64_t tail_mask = tail_bits == WORD_BITS ? ~(uint64_t)0 
+                                : ((uint64_t)1 << tail_bits) - 1;
+
+        for (int r = 0; r < bit2_array->height; r++) {
+                uint64_t *words = row_words(bit2_array, r);
+                for (int w = 0; w < wpr; w++) {
+                        uint64_t mask = w == wpr - 1 ? tail_mask 
+                                                     : ~(uint64_t)0;
+                        map_word_bits(~words[w] & mask, w * WORD_BITS, r, 0,
+                                                bit2_array, apply, cl);
+                }
+        }
+}
+
+/**********Bit2_view_of********
+ *
+ * Makes a view of a rectangle of bit2_array, without copying it
+ * Inputs:
+ *              T bit2_array: the array
+ *              int col, int row: the top left bit of the rectangle
+ *              int width, int height: the size of the rectangle
+ * Return: the view, whose bit (0, 0) is bit2_array's bit (col, row)
+ * Expects:
+ *      bit2_array to be nonnull; the rectangle to lie inside it
+ * Notes:
+ *      * Checked runtime error if bit2_array is null or the rectangle does
+ *      not fit
+ *      * Writing through the view writes to bit2_array
+ ************************/
+Bit2_view Bit2_view_of(T bit2_array, int col, int row, int width, 
+                                                                int height)
+{
+        assert(bit2_array != NULL);
+        assert(col >= 0 && row >= 0 && width >= 0 && height >= 0);
+        assert(col + width <= bit2_array->width && 
+               row + height <= bit2_array->height);
+        Bit2_view view = { bit2_array, col, row, width, height };
+        return view;
+}
+
+/**********Bit2_view_width********
+ *
+ * Returns the width of a view
+ * Inputs:
+ *              Bit2_view view: the view
+ * Return: the number of columns in the view
+ * Expects:
+ *      None
+ * Notes:
+ *      None
+ ************************/
+int Bit2_view_width(Bit2_view view)
+{
+        return view.width;
+}
+
+/**********Bit2_view_height********
+ *
+ * Returns the height of a view
+ * Inputs:
+ *              Bit2_view view: the view
+ * Return: the number of rows in the view
+ * Expects:
+ *      None
+ * Notes:
+ *      None
+ ************************/
+int Bit2_view_height(Bit2_view view)
+{
+        return view.height;
+}
+
+/**********Bit2_view_get********
+ *
+ * Returns the bit at (col, row) of a view
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int col, int row: the bit, in view's coordinates
+ * Return: the bit
+ * Expects:
+ *      col and row in range
+ * Notes:
+ *      Checked runtime error if the bit is out of range
+ ************************/
+int Bit2_view_get(Bit2_view view, int col, int row)
+{
+        assert(col >= 0 && col < view.width);
+        assert(row >= 0 && row < view.height);
+        return Bit2_get(view.array, view.col + col, view.row + row);
+}
+
+/**********Bit2_view_put********
+ *
+ * Sets the bit at (col, row) of a view
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int col, int row: the bit, in view's coordinates
+ *              int bit: its new value, 0 or 1
+ * Return: the bit's previous value
+ * Expects:
+ *      col and row in range; bit to be 0 or 1
+ * Notes:
+ *      Checked runtime error if the bit is out of range or not 0 or 1
+ ************************/
+int Bit2_view_put(Bit2_view view, int col, int row, int bit)
+{
+        assert(col >= 0 && col < view.width);
+        assert(row >= 0 && row < view.height);
+        return Bit2_put(view.array, view.col + col, view.row + row, bit);
+}
+
+/**********Bit2_view_get_row_words********
+ *
+ * Copies one row of a view out as packed 64-bit words
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int row: the row, in view's coordinates
+ *              uint64_t *words: set to the row, (width + 63) / 64 words
+ *                               laid out as for Bit2_get_row_words
+ * Return: N/A
+ * Expects:
+ *      words to be nonnull; row in range
+ * Notes:
+ *      * Checked runtime error if words is null or row is out of range
+ *      * Each word is put together from two shifted words of the array, so
+ *      a view that does not start on a multiple of 64 columns costs little
+ *      more than one that does. Bits past the view's width are zero
+ ************************/
+void Bit2_view_get_row_words(Bit2_view view, int row, uint64_t *words)
+{
+        assert(words != NULL);
+        assert(row >= 0 && row < view.height);
+        int num_words = (view.width + WORD_BITS - 1) / WORD_BITS;
+        for (int i = 0; i < num_words; i++) {
+                words[i] = view_word(view, view.row + row, i);
+        }
+}
+
+/**********Bit2_view_put_row_words********
+ *
+ * Sets one row of a view from packed 64-bit words
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int row: the row, in view's coordinates
+ *              const uint64_t *words: the new row, laid out as for
+ *                                     Bit2_view_get_row_words
+ * Return: N/A
+ * Expects:
+ *      words to be nonnull; row in range
+ * Notes:
+ *      * Checked runtime error if words is null or row is out of range
+ *      * Only the view's bits change: bits past its width are ignored, and
+ *      the array's bits on either side of it are kept
+ ************************/
+void Bit2_view_put_row_words(Bit2_view view, int row, const uint64_t *words)
+{
+        assert(words != NULL);
+        assert(row >= 0 && row < view.height);
+        int shift = view.col % WORD_BITS;
+        int first = view.col / WORD_BITS;
+        int num_words = (view.width + WORD_BITS - 1) / WORD_BITS;
+
+        for (int i = 0; i < num_words; i++) {
+                int bits = view.width - i * WORD_BITS;
+                uint64_t mask = bits >= WORD_BITS ? ~(uint64_t)0 
+                                        : ((uint64_t)1 << bits) - 1;
+                store_word(view.array, view.row + row, first + i, 
+                           words[i] << shift, mask << shift);
+                if (shift != 0 && (mask >> (WORD_BITS - shift)) != 0) {
+                        store_word(view.array, view.row + row, first + i + 1,
+                                   words[i] >> (WORD_BITS - shift), 
+                                   mask >> (WORD_BITS - shift));
+                }
+        }
+}
+
+/**********Bit2_view_map_row_major********
+ *
+ * Calls apply on every bit of a view, row by row
+ * Inputs:
+ *              Bit2_view view: the view
+ *              void apply: called with each bit's column and row in view's
+ *                          coordinates, the view, the bit and cl
+ *              void *cl: closure passed on to apply
+ * Return: N/A
+ * Expects:
+ *      apply to be nonnull
+ * Notes:
+ *      * Checked runtime error if apply is null
+ *      * Reads each row a word at a time, as Bit2_view_get_row_words does
+ ************************/
+void Bit2_view_map_row_major(Bit2_view view, void apply(int col, int row, 
+                        Bit2_view view, int bit, void *cl), void *cl)
+{
+        assert(apply != NULL);
+        for (int r = 0; r < view.height; r++) {
+                for (int c = 0; c < view.width; c += WORD_BITS) {
+                        uint64_t word = view_word(view, view.row + r, 
+                                                  c / WORD_BITS);
+                        int end = c + WORD_BITS < view.width ? 
+                                                c + WORD_BITS : view.width;
+                        for (int j = c; j < end; j++) {
+                                apply(j, r, view, (word >> (j - c)) & 1, cl);
+                        }
+                }
+        }
+}
+
+/**********Bit2_view_map_col_major********
+ *
+ * Calls apply on every bit of a view, column by column
+ * Inputs:
+ *              Bit2_view view: the view
+ *              void apply: called with each bit's column and row in view's
+ *                          coordinates, the view, the bit and cl
+ *              void *cl: closure passed on to apply
+ * Return: N/A
+ * Expects:
+ *      apply to be nonnull
+ * Notes:
+ *      * Checked runtime error if apply is null, or if the strip cannot be
+ *      allocated
+ *      * Works through the view in strips of 64 columns, as 
+ *      Bit2_map_col_major does through an array. Each strip is read a word
+ *      per row as Bit2_view_get_row_words reads it, and transposed a 64 x 
+ *      64 tile at a time, so that each column can be read from consecutive
+ *      words instead of one bit per row
+ *      * apply sees every change made before it is called, as in 
+ *      Bit2_map_col_major: once the array changes, the rest of the strip 
+ *      is read a bit at a time with Bit2_view_get
+ *      * apply must not resize the array
+ ************************/
+void Bit2_view_map_col_major(Bit2_view view, void apply(int col, int row, 
+                        Bit2_view view, int bit, void *cl), void *cl)
+{
+        assert(apply != NULL);
+        int tile_rows = (view.height + WORD_BITS - 1) / WORD_BITS;
+        int num_words = (view.width + WORD_BITS - 1) / WORD_BITS;
+        uint64_t tile[WORD_BITS];
+
+        /* column j of the current strip is words [j * tile_rows, ...) */
+        uint64_t *strip = malloc((tile_rows > 0 ? tile_rows : 1) * 
+                                        WORD_BITS * sizeof(uint64_t));
+        assert(strip != NULL);
+
+        view.array->mapping++;
+        for (int i = 0; i < num_words; i++) {
+                for (int tr = 0; tr < tile_rows; tr++) {
+                        for (int k = 0; k < WORD_BITS; k++) {
+                                int r = tr * WORD_BITS + k;
+                                tile[k] = r < view.height 
+                                        ? view_word(view, view.row + r, i) 
+                                        : 0;
+                        }
+                        transpose64(tile);
+                        for (int j = 0; j < WORD_BITS; j++) {
+                                strip[j * tile_rows + tr] = tile[j];
+                        }
+                }
+
+                bool fresh = true;      /* no write since the strip */
+                for (int j = 0; j < WORD_BITS; j++) {
+                        int c = i * WORD_BITS + j;
+                        if (c >= view.width) {
+                                break;
+                        }
+                        uint64_t *column = &strip[j * tile_rows];
+                        for (int r = 0; r < view.height; r++) {
+                                int bit = fresh ? (int)(column[r / WORD_BITS] 
+                                                        >> (r % WORD_BITS) & 1)
+                                                : Bit2_view_get(view, c, r);
+                                unsigned long writes = view.array->writes;
+                                apply(c, r, view, bit, cl);
+                                fresh = fresh && 
+                                        view.array->writes == writes;
+                        }
+                }
+        }
+        view.array->mapping--;
+        free(strip);
+}
+
+/**********view_word********
+ *
+ * Reads word i of one of a view's rows
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int row: the row, in the array's coordinates
+ *              int i: the word, covering the view's columns 64 i onwards
+ * Return: the word, with bits past the view's width zero
+ * Expects:
+ *      row and i to be in range
+ * Notes:
+ *      None
+ ************************/
+static uint64_t view_word(Bit2_view view, int row, int i)
+{
+        int shift = view.col % WORD_BITS;
+        int w = view.col / WORD_BITS + i;
+        uint64_t word = load_word(view.array, row, w) >> shift;
+        if (shift != 0) {
+                word |= load_word(view.array, row, w + 1) 
+                                                << (WORD_BITS - shift);
+        }
+
+        int bits = view.width - i * WORD_BITS;
+        return bits >= WORD_BITS ? word 
+                                 : word & (((uint64_t)1 << bits) - 1);
+}
+
+/**********load_tile********
+ *
+ * Copies the 64 x 64 tile in word column w and tile row tr of bit2_array
+ * into tile
+ * Inputs:
+ *              T bit2_array: the array the tile is copied from
+ *              int w: which word of each row the tile covers
+ *              int tr: which band of 64 rows the tile covers
+ *              uint64_t tile[64]: set to the tile, one word per row
+ * Return: N/A
+ * Expects:
+ *      w and tr to name a tile of bit2_array
+ * Notes:
+ *      Rows past the bottom of bit2_array are filled with zeros
+ ************************/
+static void load_tile(T bit2_array, int w, int tr, uint64_t tile[WORD_BITS])
+{
+        for (int i = 0; i < WORD_BITS; i++) {
+                int r = tr * WORD_BITS + i;
+                tile[i] = r < bit2_array->height ? row_words(bit2_array, r)[w]
+                                                 : 0;
+        }
+}
@@ -8,20 +8,71 @@
 
 #ifndef BIT2_INCLUDED
 #define BIT2_INCLUDED
+
+#include <stdint.h>
+#include "bigmem.h"
+
 #define T Bit2_T
 typedef struct T *T;
 
+/* 
+ * A width x height window onto a bit2 array, from its bit (col, row), 
+ * sharing its bits. A view is a plain value: making, copying and dropping
+ * one allocates nothing, and it stays valid while the array keeps its size.
+ *
+ * The fields are only declared here so a view can be passed by value; they
+ * are private to the implementation, and clients go through the Bit2_view
+ * functions below
+ */
+typedef struct Bit2_view {
+        T array;
+        int col;
+        int row;
+        int width;
+        int height;
+} Bit2_view;
+
 
 extern T Bit2_new(int width, int height);
+extern T Bit2_new_policy(int width, int height, Bigmem_policy policy);
 extern void Bit2_free(T *bit2_array);
+extern void Bit2_resize(T bit2_array, int width, int height);
 extern int Bit2_width(T bit2_array);
 extern int Bit2_height(T bit2_array);
 extern int Bit2_get(T bit2_array, int col, int row);
 extern int Bit2_put(T bit2_array, int col, int row, int bit);
+extern void Bit2_get_row_words(T bit2_array, int row, uint64_t *words);
+extern void Bit2_put_row_words(T bit2_array, int row, const uint64_t *words);
 extern void Bit2_map_row_major(T bit2_array, void apply(int col, int row, 
                             T bit2_array, int bit, void *cl), void *cl);
 extern void Bit2_map_col_major(T bit2_array, void apply(int col, int row, 
                             T bit2_array, int bit, void *cl), void *cl);
+extern void Bit2_map_set_bits(T bit2_array, void apply(int col, int row, 
+                            T bit2_array, int bit, void *cl), void *cl);
+extern void Bit2_map_clear_bits(T bit2_array, void apply(int col, int row, 
+                            T bit2_array, int bit, void *cl), void *cl);
+extern T Bit2_transpose(T bit2_array);
+extern long Bit2_count(T bit2_array);
+extern int Bit2_bounding_box(T bit2_array, int *left, int *top, int *right,
+                                                                int *bottom);
+extern void Bit2_map_chunks(T bit2_array, void apply(int col, int row, 
+                            int width, int height, int uniform, 
+                            T bit2_array, void *cl), void *cl);
+
+extern Bit2_view Bit2_view_of(T bit2_array, int col, int row, int width, 
+                                                                int height);
+extern int Bit2_view_width(Bit2_view view);
+extern int Bit2_view_height(Bit2_view view);
+extern int Bit2_view_get(Bit2_view view, int col, int row);
+extern int Bit2_view_put(Bit2_view view, int col, int row, int bit);
+extern void Bit2_view_get_row_words(Bit2_view view, int row, 
+                                                        uint64_t *words);
+extern void Bit2_view_put_row_words(Bit2_view view, int row, 
+                                                const uint64_t *words);
+extern void Bit2_view_map_row_major(Bit2_view view, void apply(int col, 
+                        int row, Bit2_view view, int bit, void *cl), void *cl);
+extern void Bit2_view_map_col_major(Bit2_view view, void apply(int col, 
+                        int row, Bit2_view view, int bit, void *cl), void *cl);
 
 
 #undef T
@@ -0,0 +1,1248 @@
+/*
+ *     bit2_chunked.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Chunked implementation of 2D Bit Arrays, for images that are
+ *              mostly one color. Links in place of bit2.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bit2.h"
+#include "bitwords.h"
+
+#define T Bit2_T
+
+#define CHUNK_BITS 64
+
+/*
+ * The array is cut into 64 x 64 chunks, stored in row major order. A chunk
+ * is 64 words, one per row, with column col of the chunk in bit col of its
+ * word. Chunks that are all zeros or all ones point at the shared, read-only
+ * sentinels below, and only mixed chunks have memory of their own. A chunk
+ * is put back to a sentinel as soon as it becomes uniform again.
+ *
+ * Chunks that hang over the right or bottom edge keep their padding bits 
+ * at zero, so they can collapse to ZEROS but never to ONES.
+ *
+ * Rows in the same chunk row share memory, so two threads must not write to
+ * the same band of 64 rows at once.
+ */
+struct T {
+        uint64_t **chunks;
+        size_t capacity;        /* chunk slots allocated */
+        int chunk_cols;
+        int chunk_rows;
+        int width;
+        int height;
+        int mapping;            /* column-major maps running on the array */
+        unsigned long writes;   /* writes made while mapping */
+};
+
+#define ONES_8 ~(uint64_t)0, ~(uint64_t)0, ~(uint64_t)0, ~(uint64_t)0, \
+               ~(uint64_t)0, ~(uint64_t)0, ~(uint64_t)0, ~(uint64_t)0
+static const uint64_t all_zeros[CHUNK_BITS];
+static const uint64_t all_ones[CHUNK_BITS] = { ONES_8, ONES_8, ONES_8, 
+                                ONES_8, ONES_8, ONES_8, ONES_8, ONES_8 };
+#undef ONES_8
+
+#define ZEROS ((uint64_t *)all_zeros)
+#define ONES ((uint64_t *)all_ones)
+
+static inline uint64_t **chunk_at(T bit2_array, int col, int row)
+{
+        return &bit2_array->chunks[(row / CHUNK_BITS) * 
+                                bit2_array->chunk_cols + col / CHUNK_BITS];
+}
+
+static inline bool is_sentinel(uint64_t *chunk)
+{
+        return chunk == ZEROS || chunk == ONES;
+}
+
+/* Counts a write that may change bits, if a column-major map is running */
+static inline void wrote(T bit2_array)
+{
+        if (bit2_array->mapping != 0) {
+                bit2_array->writes++;
+        }
+}
+
+/* Word w of a row (the row's part of chunk w), or 0 past the end */
+static inline uint64_t load_word(T bit2_array, int row, int w)
+{
+        return w < bit2_array->chunk_cols 
+                        ? (*chunk_at(bit2_array, w * CHUNK_BITS, row))
+                                                        [row % CHUNK_BITS]
+                        : 0;
+}
+
+static uint64_t view_word(Bit2_view view, int row, int i);
+static void store_word(T bit2_array, int row, int w, uint64_t value,
+                                                        uint64_t mask);
+static bool is_full_chunk(T bit2_array, int col, int row);
+static void collapse(uint64_t **slot, uint64_t *sentinel);
+static int chunk_uniform(uint64_t *chunk, int width, int height);
+
+/**********Bit2_new********
+ *
+ * Creates a new vector of width x height bits and sets all the bits to zero 
+ * Inputs:
+ *              int width: integer storing the number of columns contained in 
+ *                         the bit2 array
+ *              int height: integer storing the number of rows contained in the
+                            bit2 array
+ * Return: A new bit2 array with width x height number of elements
+ * Expects:
+ *      width and height to be nonnegative
+ * Notes:
+ *      * Checked runtime error if width or height is negative, or if memory
+ *      cannot be allocated
+ *      * Only the table of chunks is allocated; every chunk starts out as
+ *      the shared all-zeros sentinel
+ ************************/
+T Bit2_new(int width, int height) 
+{
+        assert(width >= 0); 
+        assert(height >= 0);
+
+        T bit2_array = malloc(sizeof(*bit2_array));
+        assert(bit2_array != NULL);
+
+        bit2_array->width = width;
+        bit2_array->height = height;
+        bit2_array->chunk_cols = (width + CHUNK_BITS - 1) / CHUNK_BITS;
+        bit2_array->chunk_rows = (height + CHUNK_BITS - 1) / CHUNK_BITS;
+        bit2_array->mapping = 0;
+        bit2_array->writes = 0;
+
+        size_t num_chunks = (size_t)bit2_array->chunk_cols * 
+                                                bit2_array->chunk_rows;
+        bit2_array->capacity = num_chunks > 0 ? num_chunks : 1;
+        bit2_array->chunks = malloc(bit2_array->capacity * 
+                                                        sizeof(uint64_t *));
+        assert(bit2_array->chunks != NULL);
+        for (size_t i = 0; i < num_chunks; i++) {
+                bit2_array->chunks[i] = ZEROS;
+        }
+
+        return bit2_array;
+}
+
+/**********Bit2_new_policy********
+ *
+ * Creates a new width x height bit2 array of zeros
+ * Inputs:
+ *              int width, int height: the size of the array
+ *              Bigmem_policy policy: not used
+ * Return: A new bit2 array
+ * Expects:
+ *      width and height to be nonnegative
+ * Notes:
+ *      * The same as Bit2_new: a chunked array has no large block for the
+ *      policy to place, only 512-byte chunks allocated as they turn mixed
+ *      by whichever thread writes them, which already puts them near it
+ *      * Checked runtime error if width or height is negative, or if memory
+ *      cannot be allocated
+ ************************/
+T Bit2_new_policy(int width, int height, Bigmem_policy policy)
+{
+        (void)policy;
+        return Bit2_new(width, height);
+}
+
+/**********Bit2_free********
+ *
+ * Deallocates and clears the *bit2_array
+ * Inputs:
+ *              T *bit2_array: A pointer to a pointer to the bit2_array that 
+ *                             will be deallocated and cleared
+ * Return: N/A
+ * Expects:
+ *      bit2_array or *bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array / *bit2_array to be null 
+ *      * Frees every mixed chunk; the sentinels are shared and never freed
+ ************************/
+void Bit2_free(T *bit2_array)
+{
+        assert(bit2_array != NULL && *bit2_array != NULL);
+        size_t num_chunks = (size_t)(*bit2_array)->chunk_cols * 
+                                                (*bit2_array)->chunk_rows;
+        for (size_t i = 0; i < num_chunks; i++) {
+                if (!is_sentinel((*bit2_array)->chunks[i])) {
+                        free((*bit2_array)->chunks[i]);
+                }
+        }
+        free((*bit2_array)->chunks);
+        free(*bit2_array);
+        *bit2_array = NULL;
+}
+
+/**********Bit2_resize********
+ *
+ * Changes the size of bit2_array and sets all of its bits to zero, reusing
+ * its chunk table when it is big enough
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to resize
+ *              int width: the new number of columns
+ *              int height: the new number of rows
+ * Return: N/A
+ * Expects:
+ *      bit2_array to be nonnull; width and height to be nonnegative
+ * Notes:
+ *      * Checked runtime error if bit2_array is null, width or height is 
+ *      negative, or memory cannot be allocated
+ *      * Every mixed chunk is freed, as all chunks become ZEROS
+ ************************/
+void Bit2_resize(T bit2_array, int width, int height)
+{
+        assert(bit2_array != NULL);
+        assert(width >= 0 && height >= 0);
+
+        size_t old_chunks = (size_t)bit2_array->chunk_cols * 
+                                                bit2_array->chunk_rows;
+        for (size_t i = 0; i < old_chunks; i++) {
+                if (!is_sentinel(bit2_array->chunks[i])) {
+                        free(bit2_array->chunks[i]);
+                }
+        }
+
+        bit2_array->width = width;
+        bit2_array->height = height;
+        bit2_array->chunk_cols = (width + CHUNK_BITS - 1) / CHUNK_BITS;
+        bit2_array->chunk_rows = (height + CHUNK_BITS - 1) / CHUNK_BITS;
+
+        size_t num_chunks = (size_t)bit2_array->chunk_cols * 
+                                                bit2_array->chunk_rows;
+        if (num_chunks > bit2_array->capacity) {
+                free(bit2_array->chunks);
+                bit2_array->chunks = malloc(num_chunks * sizeof(uint64_t *));
+                assert(bit2_array->chunks != NULL);
+                bit2_array->capacity = num_chunks;
+        }
+        for (size_t i = 0; i < num_chunks; i++) {
+                bit2_array->chunks[i] = ZEROS;
+        }
+}
+
+/**********Bit2_width********
+ *
+ * Returns the number of columns in the bit2_array
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array in which the width is
+ *                            to be retrieved
+ * Return: the number of columns in the bit2_array (width of the bit2_array)
+ * Expects:
+ *       bit2_array to be nonnull
+ * Notes:
+ *      Checked runtime error if bit2_array is null
+ ************************/
+int Bit2_width(T bit2_array) 
+{
+        assert(bit2_array != NULL);
+        return bit2_array->width;
+}
+
+/**********Bit2_height********
+ *
+ * Returns the number of rows in the bit2_array
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array in which the height 
+ *                            is to be retrieved
+ * Return: the number of rows in the bit2_array (the height of the bit2_array)
+ * Expects:
+ *       bit2_array to be nonnull
+ * Notes:
+ *      Checked runtime error if bit2_array is null
+ ************************/
+int Bit2_height(T bit2_array)
+{
+        assert(bit2_array != NULL);
+        return bit2_array->height;
+}
+
+/**********Bit2_get********
+ *
+ * Returns the bit at (row, col) in bit2_array
+ * Inputs:
+ *              T bit2_array: A pointer to a bit2 array in which the bit is to 
+ *                            be returned
+ *              int col: The column index of the bit
+ *              int row: The row index of the bit
+ * Return: the bit at (row, col) in bit2_array
+ * Expects:
+ *      * bit2_array to be nonnull
+ *      * The row value is positive and less than the height of the bit2_array 
+ *      * The col value is positive and less than the width of the bit2_array
+ * Notes:
+ *      * Checked runtime error if:
+ *              * bit2_array is null 
+ *              * row value >= height
+ *              * col value >= width
+ ************************/
+int Bit2_get(T bit2_array, int col, int row)
+{
+        assert(bit2_array != NULL);
+        assert(col >= 0 && col < bit2_array->width);
+        assert(row >= 0 && row < bit2_array->height);
+        uint64_t *chunk = *chunk_at(bit2_array, col, row);
+        return (chunk[row % CHUNK_BITS] >> (col % CHUNK_BITS)) & 1;
+}
+
+/**********Bit2_put********
+ *
+ * Sets the bit at (row, col) in the bit2_array to the value of bit
+ * Inputs:
+ *              T bit2_array: A pointer to a bit2 array in which the bit is to 
+ *                            be set
+ *              int col: The column index of the element to be set within the 
+ *                       bit2_array
+ *              int row: The row index of the element to be set within 
+ *                       the bit2_array
+ *              int bit: the new value of the element
+ * Return: the previous bit value at (row, col) in bit2_array before it is set
+ * Expects:
+ *      * bit2_array to be nonnull
+ *      * The row value is positive and less than the height of the bit2_array 
+ *      * The col value is positive and less than the width of the bit2_array
+ *      * bit to be zero or one
+ * Notes:
+ *      * Checked runtime error if:
+ *              * bit2_array is null 
+ *              * row value >= height
+ *              * col value >= width
+ *              * bit is not zero or one
+ *      * Writing into a uniform chunk gives it memory of its own. A chunk is
+ *      only scanned to see if it has become uniform when the word written 
+ *      becomes all zeros or all ones, which keeps puts cheap on average
+ ************************/
+int Bit2_put(T bit2_array, int col, int row, int bit)
+{
+        assert(bit2_array != NULL);
+        assert(col >= 0 && col < bit2_array->width);
+        assert(row >= 0 && row < bit2_array->height);
+        assert(bit == 0 || bit == 1);
+
+        uint64_t **slot = chunk_at(bit2_array, col, row);
+        uint64_t mask = (uint64_t)1 << (col % CHUNK_BITS);
+        int prev_bit = ((*slot)[row % CHUNK_BITS] & mask) != 0;
+
+        if (prev_bit == bit) {
+                return prev_bit;
+        }
+        wrote(bit2_array);
+        if (is_sentinel(*slot)) {
+                uint64_t *chunk = malloc(CHUNK_BITS * sizeof(uint64_t));
+                assert(chunk != NULL);
+                for (int i = 0; i < CHUNK_BITS; i++) {
+                        chunk[i] = (*slot)[i];
+                }
+                *slot = chunk;
+        }
+
+        uint64_t *word = &(*slot)[row % CHUNK_BITS];
+        if (bit == 1) {
+                *word |= mask;
+                if (*word == ~(uint64_t)0 && 
+                    is_full_chunk(bit2_array, col, row)) {
+                        collapse(slot, ONES);
+                }
+        } else {
+                *word &= ~mask;
+                if (*word == 0) {
+                        collapse(slot, ZEROS);
+                }
+        }
+        return prev_bit;
+}
+
+/**********Bit2_get_row_words********
+ *
+ * Copies one row of bit2_array out as packed 64-bit words
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be read
+ *              int row: the row to copy
+ *              uint64_t *words: set to the row, (width + 63) / 64 words, 
+ *                               with column col in bit (col % 64) of word
+ *                               (col / 64)
+ * Return: N/A
+ * Expects:
+ *      * bit2_array and words to be nonnull
+ *      * row to be positive and less than the height of bit2_array
+ * Notes:
+ *      * Checked runtime error if bit2_array or words is null, or row is out
+ *      of range
+ *      * Bits past the width of bit2_array are zero
+ ************************/
+void Bit2_get_row_words(T bit2_array, int row, uint64_t *words)
+{
+        assert(bit2_array != NULL && words != NULL);
+        assert(row >= 0 && row < bit2_array->height);
+        uint64_t **chunks = chunk_at(bit2_array, 0, row);
+        for (int cc = 0; cc < bit2_array->chunk_cols; cc++) {
+                words[cc] = chunks[cc][row % CHUNK_BITS];
+        }
+}
+
+/**********Bit2_put_row_words********
+ *
+ * Sets one row of bit2_array from packed 64-bit words
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be changed
+ *              int row: the row to set
+ *              const uint64_t *words: the new row, laid out as for 
+ *                                     Bit2_get_row_words
+ * Return: N/A
+ * Expects:
+ *      * bit2_array and words to be nonnull
+ *      * row to be positive and less than the height of bit2_array
+ * Notes:
+ *      * Checked runtime error if bit2_array or words is null, or row is out
+ *      of range
+ *      * Bits past the width of bit2_array are ignored
+ *      * Words that do not change a chunk leave it as it is, so writing
+ *      zeros over an all-zero chunk does not give it memory
+ ************************/
+void Bit2_put_row_words(T bit2_array, int row, const uint64_t *words)
+{
+        assert(bit2_array != NULL && words != NULL);
+        assert(row >= 0 && row < bit2_array->height);
+        int last = bit2_array->chunk_cols - 1;
+        int tail_bits = bit2_array->width - last * CHUNK_BITS;
+        uint64_t tail_mask = tail_bits == CHUNK_BITS ? ~(uint64_t)0 
+                                : ((uint64_t)1 << tail_bits) - 1;
+
+        for (int cc = 0; cc <= last; cc++) {
+                store_word(bit2_array, row, cc, words[cc], 
+                           cc == last ? tail_mask : ~(uint64_t)0);
+        }
+}
+
+/**********Bit2_map_row_major********
+ *
+ * Calls an apply function for each element in bit2_array, in order from low to
+ * high indices, with column indices varying more rapidly than row indices
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array that the apply 
+ *                            function will be called on 
+ *              void apply: The function that will be applied to each element 
+ *                          in bit2_array      * parameters detailed below *
+ *                  int col: the current column index
+ *                  int row: the current row index
+ *                  T bit2_array: A pointer to the same bit2_array passed into 
+ *                                the outside function
+ *                  int bit: the bit value at (row, col)
+ *                  void *cl: A closure passed in by the client to be used in 
+ *                            the apply function  
+ *              void *cl: A closure passed in by the client to be used in the
+ *                        apply function               
+ * Return: N/A
+ * Expects: 
+ *      bit2_array to be nonnull
+ * Notes:
+ *      Checked runtime error if bit2_array is null 
+ ************************/
+void Bit2_map_row_major(T bit2_array, void apply(int col, int row, 
+                                T bit2_array, int bit, void *cl), void *cl)
+{
+        assert(bit2_array != NULL);
+        for (int r = 0; r < bit2_array->height; r++) {
+                for (int c = 0; c < bit2_array->width; c++) {
+                        apply(c, r, bit2_array, Bit2_get(bit2_array, c, r), 
+                                                                        cl);
+                }
+        }
+}
+
+/**********Bit2_map_col_major********
+ *
+ * Calls an apply function for each element in bit2_array, in order from low to
+ * high indices, with row indices varying more rapidly than column indices
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array that the apply 
+ *                            function will be called on 
+ *                         
+ *              void apply: The function that will be applied to each element 
+ *                          in bit2_array      * parameters detailed below *
+ *                  int row: the current row index
+ *                  int col: the current column index
+ *                  T bit2_array: A pointer to the same bit2_array passed into 
+ *                                the outside function
+ *                  int bit: the bit value at (row, col)
+ *                  void *cl: A closure passed in by the client to be used in 
+ *                            the apply function  
+ *
+ *              void *cl: A closure passed in by the client to be used in the
+ *                        apply function               
+ *                        
+ *          
+ * Return: N/A
+ * Expects: 
+ *      * bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null 
+ *      * Works through the array in strips of 64 columns. Each strip is 
+ *      transposed a chunk at a time, so that each column can be read
+ *      from consecutive words instead of one word per row
+ *      * apply sees every change made before it is called, its own 
+ *      included, as if each bit were read with Bit2_get. The array counts
+ *      its writes while it is being mapped, and once apply changes it the
+ *      rest of the strip is read a bit at a time with Bit2_get; the next
+ *      strip is read afresh
+ *      * apply must not resize bit2_array
+ ************************/
+void Bit2_map_col_major(T bit2_array, void apply(int col, int row, 
+                                T bit2_array, int bit, void *cl), void *cl)
+{
+        assert(bit2_array != NULL);
+        int chunk_rows = bit2_array->chunk_rows;
+        uint64_t tile[CHUNK_BITS];
+
+        /* column j of the current strip is words [j * chunk_rows, ...) */
+        uint64_t *strip = malloc((chunk_rows > 0 ? chunk_rows : 1) * 
+                                        CHUNK_BITS * sizeof(uint64_t));
+        assert(strip != NULL);
+
+        bit2_array->mapping++;
+        for (int cc = 0; cc < bit2_array->chunk_cols; cc++) {
+                for (int cr = 0; cr < chunk_rows; cr++) {
+                        uint64_t *chunk = bit2_array->chunks[cr * 
+                                                bit2_array->chunk_cols + cc];
+                        for (int i = 0; i < CHUNK_BITS; i++) {
+                                tile[i] = chunk[i];
+                        }
+                        if (!is_sentinel(chunk)) {
+                                transpose64(tile);
+                        }
+                        for (int j = 0; j < CHUNK_BITS; j++) {
+                                strip[j * chunk_rows + cr] = tile[j];
+                        }
+                }
+
+                bool fresh = true;      /* no write since the strip */
+                for (int j = 0; j < CHUNK_BITS; j++) {
+                        int c = cc * CHUNK_BITS + j;
+                        if (c >= bit2_array->width) {
+                                break;
+                        }
+                        uint64_t *column = &strip[j * chunk_rows];
+                        for (int r = 0; r < bit2_array->height; r++) {
+                                int bit = fresh ? (int)(column[r / CHUNK_BITS] 
+                                                        >> (r % CHUNK_BITS) & 1)
+                                                : Bit2_get(bit2_array, c, r);
+                                unsigned long writes = bit2_array->writes;
+                                apply(c, r, bit2_array, bit, cl);
+                                fresh = fresh && 
+                                        bit2_array->writes == writes;
+                        }
+                }
+        }
+        bit2_array->mapping--;
+        free(strip);
+}
+
+/**********Bit2_transpose********
+ *
+ * Creates a new bit2 array holding the transpose of bit2_array
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be transposed
+ * Return: A new height x width bit2 array whose bit at (row, col) is the bit
+ *         at (col, row) in bit2_array
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * Uniform chunks stay shared sentinels in the transpose; mixed chunks
+ *      are copied and transposed with a word-level kernel
+ *      * The client must use Bit2_free once the memory is no longer needed
+ ************************/
+T Bit2_transpose(T bit2_array)
+{
+        assert(bit2_array != NULL);
+        T transposed = Bit2_new(bit2_array->height, bit2_array->width);
+
+        for (int cr = 0; cr < bit2_array->chunk_rows; cr++) {
+                for (int cc = 0; cc < bit2_array->chunk_cols; cc++) {
+                        uint64_t *chunk = bit2_array->chunks[cr * 
+                                                bit2_array->chunk_cols + cc];
+                        uint64_t **slot = &transposed->chunks[cc * 
+                                                transposed->chunk_cols + cr];
+                        if (is_sentinel(chunk)) {
+                                *slot = chunk;
+                                continue;
+                        }
+                        *slot = malloc(CHUNK_BITS * sizeof(uint64_t));
+                        assert(*slot != NULL);
+                        for (int i = 0; i < CHUNK_BITS; i++) {
+                                (*slot)[i] = chunk[i];
+                        }
+                        transpose64(*slot);
+                }
+        }
+        return transposed;
+}
+
+/**********Bit2_count********
+ *
+ * Returns the number of bits in bit2_array that are set to one
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be counted
+ * Return: the number of one bits in bit2_array
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * Uniform chunks are counted without being read; mixed chunks are
+ *      counted a word at a time with popcount
+ ************************/
+long Bit2_count(T bit2_array)
+{
+        assert(bit2_array != NULL);
+        size_t num_chunks = (size_t)bit2_array->chunk_cols * 
+                                                bit2_array->chunk_rows;
+        long count = 0;
+
+        for (size_t i = 0; i < num_chunks; i++) {
+                uint64_t *chunk = bit2_array->chunks[i];
+                if (chunk == ZEROS) {
+                        continue;
+                } else if (chunk == ONES) {
+                        count += CHUNK_BITS * CHUNK_BITS;
+                        continue;
+                }
+                for (int w = 0; w < CHUNK_BITS; w++) {
+                        count += __builtin_popcountll(chunk[w]);
+                }
+        }
+        return count;
+}
+
+/**********Bit2_bounding_box********
+ *
+ * Finds the smallest rectangle that contains every one bit in bit2_array
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be scanned
+ *              int *left, int *top: set to the column and row of the top left
+ *                                   corner of the rectangle
+ *              int *right, int *bottom: set to the column and row of the 
+ *                                       bottom right corner (inclusive)
+ * Return: 1 if bit2_array contains a one bit, 0 if it does not
+ * Expects:
+ *      bit2_array, left, top, right and bottom to be nonnull
+ * Notes:
+ *      * Checked runtime error if any of the pointers are null
+ *      * The corners are left untouched when 0 is returned
+ *      * All-zero chunks are skipped without being read
+ ************************/
+int Bit2_bounding_box(T bit2_array, int *left, int *top, int *right, 
+                                                                int *bottom)
+{
+        assert(bit2_array != NULL);
+        assert(left != NULL && top != NULL);
+        assert(right != NULL && bottom != NULL);
+
+        int min_col = bit2_array->width;
+        int max_col = -1;
+        int min_row = -1;
+        int max_row = -1;
+
+        for (int r = 0; r < bit2_array->height; r++) {
+                uint64_t **chunks = chunk_at(bit2_array, 0, r);
+                int row_left = -1;
+                int row_right = -1;
+
+                for (int cc = 0; cc < bit2_array->chunk_cols; cc++) {
+                        if (chunks[cc] == ZEROS) {
+                                continue;
+                        }
+                        uint64_t word = chunks[cc][r % CHUNK_BITS];
+                        if (word == 0) {
+                                continue;
+                        }
+                        if (row_left == -1) {
+                                row_left = cc * CHUNK_BITS + 
+                                                __builtin_ctzll(word);
+                        }
+                        row_right = cc * CHUNK_BITS + (CHUNK_BITS - 1) - 
+                                                __builtin_clzll(word);
+                }
+
+                if (row_left == -1) {
+                        continue;
+                }
+                if (row_left < min_col) {
+                        min_col = row_left;
+                }
+                if (row_right > max_col) {
+                        max_col = row_right;
+                }
+                if (min_row == -1) {
+                        min_row = r;
+                }
+                max_row = r;
+        }
+
+        if (min_row == -1) {
+                return 0;
+        }
+        *left = min_col;
+        *top = min_row;
+        *right = max_col;
+        *bottom = max_row;
+        return 1;
+}
+
+/**********Bit2_map_chunks********
+ *
+ * Calls an apply function once for each 64 x 64 chunk of bit2_array, in row
+ * major order of the chunks, telling it whether the chunk is all one value
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be mapped over
+ *              void apply: The function called for each chunk
+ *                                              * parameters detailed below *
+ *                  int col, int row: the top left corner of the chunk
+ *                  int width, int height: the size of the chunk, which is 
+ *                                         smaller than 64 at the right and
+ *                                         bottom edges
+ *                  int uniform: 0 or 1 if every bit of the chunk is that 
+ *                               value, -1 if the chunk is mixed
+ *                  T bit2_array: the same bit2_array passed in
+ *                  void *cl: the closure passed in by the client
+ *              void *cl: A closure passed in by the client to be used in the
+ *                        apply function
+ * Return: N/A
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * Sentinel chunks are reported without being read
+ ************************/
+void Bit2_map_chunks(T bit2_array, void apply(int col, int row, int width, 
+                        int height, int uniform, T bit2_array, void *cl), 
+                                                                void *cl)
+{
+        assert(bit2_array != NULL);
+
+        for (int cr = 0; cr < bit2_array->chunk_rows; cr++) {
+                int r = cr * CHUNK_BITS;
+                int chunk_height = bit2_array->height - r;
+                if (chunk_height > CHUNK_BITS) {
+                        chunk_height = CHUNK_BITS;
+                }
+                for (int cc = 0; cc < bit2_array->chunk_cols; cc++) {
+                        int c = cc * CHUNK_BITS;
+                        int chunk_width = bit2_array->width - c;
+                        if (chunk_width > CHUNK_BITS) {
+                                chunk_width = CHUNK_BITS;
+                        }
+                        uint64_t *chunk = *chunk_at(bit2_array, c, r);
+                        apply(c, r, chunk_width, chunk_height, 
+                              chunk_uniform(chunk, chunk_width, chunk_height),
+                                                        bit2_array, cl);
+                }
+        }
+}
+
+/**********Bit2_map_set_bits********
+ *
+ * Calls an apply function for each bit in bit2_array that is one, in row
+ * major order
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be mapped over
+ *              void apply: The function called for each one bit, with the
+ *                          same parameters as for Bit2_map_row_major (bit is
+ *                          always 1)
+ *              void *cl: A closure passed in by the client to be used in the
+ *                        apply function
+ * Return: N/A
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * All-zero chunks are skipped without being read, and each one bit of
+ *      a word is found with count-trailing-zeros
+ *      * Each word is read once before its bits are visited, so changes
+ *      that apply makes to the rest of the current word are not seen
+ ************************/
+void Bit2_map_set_bits(T bit2_array, void apply(int col, int row, 
+                                T bit2_array, int bit, void *cl), void *cl)
+{
+        assert(bit2_array != NULL);
+        for (int r = 0; r < bit2_array->height; r++) {
+                uint64_t **chunks = chunk_at(bit2_array, 0, r);
+                for (int cc = 0; cc < bit2_array->chunk_cols; cc++) {
+                        if (chunks[cc] == ZEROS) {
+                                continue;
+                        }
+                        map_word_bits(chunks[cc][r % CHUNK_BITS], 
+                                      cc * CHUNK_BITS, r, 1, bit2_array, 
+                                                                apply, cl);
+                }
+        }
+}
+
+/**********Bit2_map_clear_bits********
+ *
+ * Calls an apply function for each bit in bit2_array that is zero, in row
+ * major order
+ * Inputs:
+ *              T bit2_array: A pointer to the bit2_array to be mapped over
+ *              void apply: The function called for each zero bit, with the
+ *                          same parameters as for Bit2_map_row_major (bit is
+ *                          always 0)
+ *              void *cl: A closure passed in by the client to be used in the
+ *                        apply function
+ * Return: N/A
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if bit2_array is null
+ *      * The counterpart of Bit2_map_set_bits, working on the complement of
+ *      each word. All-one chunks are skipped without being read
+ ************************/
+void Bit2_map_clear_bits(T bit2_array, void apply(int col, int row, 
+                                T bit2_array, int bit, void *cl), void *cl)
+{
+        assert(bit2_array != NULL);
+        int last = bit2_array->chunk_cols - 1;
+        int tail_bits = bit2_array->width - last * CHUNK_BITS;
+        uint64_t tail_mask = tail_bits == CHUNK_BITS ? ~(uint64_t)0 
+                                : ((uint64_t)1 << tail_bits) - 1;
+
+        for (int r = 0; r < bit2_array->height; r++) {
+                uint64_t **chunks = chunk_at(bit2_array, 0, r);
+                for (int cc = 0; cc <= last; cc++) {
+                        if (chunks[cc] == ONES) {
+                                continue;
+                        }
+                        uint64_t mask = cc == last ? tail_mask 
+                                                   : ~(uint64_t)0;
+                        map_word_bits(~chunks[cc][r % CHUNK_BITS] & mask, 
+                                      cc * CHUNK_BITS, r, 0, bit2_array, 
+                                                                apply, cl);
+                }
+        }
+}
+
+/**********store_word********
+ *
+ * Sets some bits of word w of a row, which is the row's part of chunk w
+ * Inputs:
+ *              T bit2_array: the array
+ *              int row: the row
+ *              int w: the chunk column
+ *              uint64_t value: the new bits
+ *              uint64_t mask: which bits of the word to set to value's
+ * Return: N/A
+ * Expects:
+ *      row and w in range; mask to have no bits past the array's width
+ * Notes:
+ *      * A word that does not change leaves its chunk as it is, so writing
+ *      zeros over an all-zero chunk does not give it memory
+ *      * A uniform chunk gets memory of its own when it is written, and a 
+ *      mixed one goes back to a sentinel when the word written leaves it 
+ *      uniform
+ ************************/
+static void store_word(T bit2_array, int row, int w, uint64_t value,
+                                                        uint64_t mask)
+{
+        uint64_t **slot = chunk_at(bit2_array, w * CHUNK_BITS, row);
+        uint64_t old = (*slot)[row % CHUNK_BITS];
+        uint64_t word = (old & ~mask) | (value & mask);
+        if (word == old) {
+                return;
+        }
+        wrote(bit2_array);
+        if (is_sentinel(*slot)) {
+                uint64_t *chunk = malloc(CHUNK_BITS * sizeof(uint64_t));
+                assert(chunk != NULL);
+                for (int i = 0; i < CHUNK_BITS; i++) {
+                        chunk[i] = (*slot)[i];
+                }
+                *slot = chunk;
+        }
+        (*slot)[row % CHUNK_BITS] = word;
+        if (word == 0) {
+                collapse(slot, ZEROS);
+        } else if (word == ~(uint64_t)0 && 
+                   is_full_chunk(bit2_array, w * CHUNK_BITS, row)) {
+                collapse(slot, ONES);
+        }
+}
+
+/**********is_full_chunk********
+ *
+ * Checks whether the chunk holding (col, row) lies wholly inside bit2_array
+ * Inputs:
+ *              T bit2_array: the bit2_array the chunk belongs to
+ *              int col, int row: any position in the chunk
+ * Return: true if the chunk has no padding, false if it hangs over an edge
+ * Expects:
+ *      bit2_array to be nonnull
+ * Notes:
+ *      None
+ ************************/
+static bool is_full_chunk(T bit2_array, int col, int row)
+{
+        return (col / CHUNK_BITS + 1) * CHUNK_BITS <= bit2_array->width &&
+               (row / CHUNK_BITS + 1) * CHUNK_BITS <= bit2_array->height;
+}
+
+/**********collapse********
+ *
+ * Replaces the mixed chunk in *slot with sentinel if they hold the same bits
+ * Inputs:
+ *              uint64_t **slot: the chunk table entry of the chunk
+ *              uint64_t *sentinel: ZEROS or ONES
+ * Return: N/A
+ * Expects:
+ *      *slot to be a mixed chunk
+ * Notes:
+ *      The chunk's memory is freed when it is replaced
+ ************************/
+static void collapse(uint64_t **slot, uint64_t *sentinel)
+{
+        for (int i = 0; i < CHUNK_BITS; i++) {
+                if ((*slot)[i] != sentinel[i]) {
+                        return;
+                }
+        }
+        free(*slot);
+        *slot = sentinel;
+}
+
+/**********chunk_uniform********
+ *
+ * Works out whether the part of a chunk inside the array is all one value
+ * Inputs:
+ *              uint64_t *chunk: the chunk, which may be a sentinel
+ *              int width, int height: how much of the chunk is inside the 
+ *                                     array
+ * Return: 0 or 1 if every bit inside the array is that value, otherwise -1
+ * Expects:
+ *      width and height to be between 1 and 64
+ * Notes:
+ *      Mixed chunks on the edges are the only ones that need to be read,
+ *      since full mixed chunks are collapsed as soon as they become uniform
+ ************************/
+static int chunk_uniform(uint64_t *chunk, int width, int height)
+{
+        if (chunk == ZEROS) {
+                return 0;
+        } else if (chunk == ONES) {
+                return 1;
+        } else if (width == CHUNK_BITS && height == CHUNK_BITS) {
+                return -1;
+        }
+
+        uint64_t full = width == CHUNK_BITS ? ~(uint64_t)0 
+                                : ((uint64_t)1 << width) - 1;
+        for (int i = 0; i < height; i++) {
+                if (chunk[i] != full) {
+                        return -1;
+                }
+        }
+        return 1;
+}
+
+/**********Bit2_view_of********
+ *
+ * Makes a view of a rectangle of bit2_array, without copying it
+ * Inputs:
+ *              T bit2_array: the array
+ *              int col, int row: the top left bit of the rectangle
+ *              int width, int height: the size of the rectangle
+ * Return: the view, whose bit (0, 0) is bit2_array's bit (col, row)
+ * Expects:
+ *      bit2_array to be nonnull; the rectangle to lie inside it
+ * Notes:
+ *      * Checked runtime error if bit2_array is null or the rectangle does
+ *      not fit
+ *      * Writing through the view writes to bit2_array
+ ************************/
+Bit2_view Bit2_view_of(T bit2_array, int col, int row, int width, 
+                                                                int height)
+{
+        assert(bit2_array != NULL);
+        assert(col >= 0 && row >= 0 && width >= 0 && height >= 0);
+        assert(col + width <= bit2_array->width && 
+               row + height <= bit2_array->height);
+        Bit2_view view = { bit2_array, col, row, width, height };
+        return view;
+}
+
+/**********Bit2_view_width********
+ *
+ * Returns the width of a view
+ * Inputs:
+ *              Bit2_view view: the view
+ * Return: the number of columns in the view
+ * Expects:
+ *      None
+ * Notes:
+ *      None
+ ************************/
+int Bit2_view_width(Bit2_view view)
+{
+        return view.width;
+}
+
+/**********Bit2_view_height********
+ *
+ * Returns the height of a view
+ * Inputs:
+ *              Bit2_view view: the view
+ * Return: the number of rows in the view
+ * Expects:
+ *      None
+ * Notes:
+ *      None
+ ************************/
+int Bit2_view_height(Bit2_view view)
+{
+        return view.height;
+}
+
+/**********Bit2_view_get********
+ *
+ * Returns the bit at (col, row) of a view
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int col, int row: the bit, in view's coordinates
+ * Return: the bit
+ * Expects:
+ *      col and row in range
+ * Notes:
+ *      Checked runtime error if the bit is out of range
+ ************************/
+int Bit2_view_get(Bit2_view view, int col, int row)
+{
+        assert(col >= 0 && col < view.width);
+        assert(row >= 0 && row < view.height);
+        return Bit2_get(view.array, view.col + col, view.row + row);
+}
+
+/**********Bit2_view_put********
+ *
+ * Sets the bit at (col, row) of a view
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int col, int row: the bit, in view's coordinates
+ *              int bit: its new value, 0 or 1
+ * Return: the bit's previous value
+ * Expects:
+ *      col and row in range; bit to be 0 or 1
+ * Notes:
+ *      Checked runtime error if the bit is out of range or not 0 or 1
+ ************************/
+int Bit2_view_put(Bit2_view view, int col, int row, int bit)
+{
+        assert(col >= 0 && col < view.width);
+        assert(row >= 0 && row < view.height);
+        return Bit2_put(view.array, view.col + col, view.row + row, bit);
+}
+
+/**********Bit2_view_get_row_words********
+ *
+ * Copies one row of a view out as packed 64-bit words
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int row: the row, in view's coordinates
+ *              uint64_t *words: set to the row, (width + 63) / 64 words
+ *                               laid out as for Bit2_get_row_words
+ * Return: N/A
+ * Expects:
+ *      words to be nonnull; row in range
+ * Notes:
+ *      * Checked runtime error if words is null or row is out of range
+ *      * Each word is put together from two shifted words of the array, so
+ *      a view that does not start on a multiple of 64 columns costs little
+ *      more than one that does. Bits past the view's width are zero
+ ************************/
+void Bit2_view_get_row_words(Bit2_view view, int row, uint64_t *words)
+{
+        assert(words != NULL);
+        assert(row >= 0 && row < view.height);
+        int num_words = (view.width + CHUNK_BITS - 1) / CHUNK_BITS;
+        for (int i = 0; i < num_words; i++) {
+                words[i] = view_word(view, view.row + row, i);
+        }
+}
+
+/**********Bit2_view_put_row_words********
+ *
+ * Sets one row of a view from packed 64-bit words
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int row: the row, in view's coordinates
+ *              const uint64_t *words: the new row, laid out as for
+ *                                     Bit2_view_get_row_words
+ * Return: N/A
+ * Expects:
+ *      words to be nonnull; row in range
+ * Notes:
+ *      * Checked runtime error if words is null or row is out of range
+ *      * Only the view's bits change: bits past its width are ignored, and
+ *      the array's bits on either side of it are kept
+ ************************/
+void Bit2_view_put_row_words(Bit2_view view, int row, const uint64_t *words)
+{
+        assert(words != NULL);
+        assert(row >= 0 && row < view.height);
+        int shift = view.col % CHUNK_BITS;
+        int first = view.col / CHUNK_BITS;
+        int num_words = (view.width + CHUNK_BITS - 1) / CHUNK_BITS;
+
+        for (int i = 0; i < num_words; i++) {
+                int bits = view.width - i * CHUNK_BITS;
+                uint64_t mask = bits >= CHUNK_BITS ? ~(uint64_t)0 
+                                        : ((uint64_t)1 << bits) - 1;
+                store_word(view.array, view.row + row, first + i, 
+                           words[i] << shift, mask << shift);
+                if (shift != 0 && (mask >> (CHUNK_BITS - shift)) != 0) {
+                        store_word(view.array, view.row + row, first + i + 1,
+                                   words[i] >> (CHUNK_BITS - shift), 
+                                   mask >> (CHUNK_BITS - shift));
+                }
+        }
+}
+
+/**********Bit2_view_map_row_major********
+ *
+ * Calls apply on every bit of a view, row by row
+ * Inputs:
+ *              Bit2_view view: the view
+ *              void apply: called with each bit's column and row in view's
+ *                          coordinates, the view, the bit and cl
+ *              void *cl: closure passed on to apply
+ * Return: N/A
+ * Expects:
+ *      apply to be nonnull
+ * Notes:
+ *      * Checked runtime error if apply is null
+ *      * Reads each row a word at a time, as Bit2_view_get_row_words does
+ ************************/
+void Bit2_view_map_row_major(Bit2_view view, void apply(int col, int row, 
+                        Bit2_view view, int bit, void *cl), void *cl)
+{
+        assert(apply != NULL);
+        for (int r = 0; r < view.height; r++) {
+                for (int c = 0; c < view.width; c += CHUNK_BITS) {
+                        uint64_t word = view_word(view, view.row + r, 
+                                                  c / CHUNK_BITS);
+                        int end = c + CHUNK_BITS < view.width ? 
+                                                c + CHUNK_BITS : view.width;
+                        for (int j = c; j < end; j++) {
+                                apply(j, r, view, (word >> (j - c)) & 1, cl);
+                        }
+                }
+        }
+}
+
+/**********Bit2_view_map_col_major********
+ *
+ * Calls apply on every bit of a view, column by column
+ * Inputs:
+ *              Bit2_view view: the view
+ *              void apply: called with each bit's column and row in view's
+ *                          coordinates, the view, the bit and cl
+ *              void *cl: closure passed on to apply
+ * Return: N/A
+ * Expects:
+ *      apply to be nonnull
+ * Notes:
+ *      * Checked runtime error if apply is null, or if the strip cannot be
+ *      allocated
+ *      * Works through the view in strips of 64 columns, as 
+ *      Bit2_map_col_major does through an array. Each strip is read a word
+ *      per row as Bit2_view_get_row_words reads it, and transposed a 64 x 
+ *      64 tile at a time, so that each column can be read from consecutive
+ *      words instead of one bit per row
+ *      * apply sees every change made before it is called, as in 
+ *      Bit2_map_col_major: once the array changes, the rest of the strip 
+ *      is read a bit at a time with Bit2_view_get
+ *      * apply must not resize the array
+ ************************/
+void Bit2_view_map_col_major(Bit2_view view, void apply(int col, int row, 
+                        Bit2_view view, int bit, void *cl), void *cl)
+{
+        assert(apply != NULL);
+        int tile_rows = (view.height + CHUNK_BITS - 1) / CHUNK_BITS;
+        int num_words = (view.width + CHUNK_BITS - 1) / CHUNK_BITS;
+        uint64_t tile[CHUNK_BITS];
+
+        /* column j of the current strip is words [j * tile_rows, ...) */
+        uint64_t *strip = malloc((tile_rows > 0 ? tile_rows : 1) * 
+                                        CHUNK_BITS * sizeof(uint64_t));
+        assert(strip != NULL);
+
+        view.array->mapping++;
+        for (int i = 0; i < num_words; i++) {
+                for (int tr = 0; tr < tile_rows; tr++) {
+                        for (int k = 0; k < CHUNK_BITS; k++) {
+                                int r = tr * CHUNK_BITS + k;
+                                tile[k] = r < view.height 
+                                        ? view_word(view, view.row + r, i) 
+                                        : 0;
+                        }
+                        transpose64(tile);
+                        for (int j = 0; j < CHUNK_BITS; j++) {
+                                strip[j * tile_rows + tr] = tile[j];
+                        }
+                }
+
+                bool fresh = true;      /* no write since the strip */
+                for (int j = 0; j < CHUNK_BITS; j++) {
+                        int c = i * CHUNK_BITS + j;
+                        if (c >= view.width) {
+                                break;
+                        }
+                        uint64_t *column = &strip[j * tile_rows];
+                        for (int r = 0; r < view.height; r++) {
+                                int bit = fresh ? (int)(column[r / CHUNK_BITS] 
+                                                        >> (r % CHUNK_BITS) & 1)
+                                                : Bit2_view_get(view, c, r);
+                                unsigned long writes = view.array->writes;
+                                apply(c, r, view, bit, cl);
+                                fresh = fresh && 
+                                        view.array->writes == writes;
+                        }
+                }
+        }
+        view.array->mapping--;
+        free(strip);
+}
+
+/**********view_word********
+ *
+ * Reads word i of one of a view's rows
+ * Inputs:
+ *              Bit2_view view: the view
+ *              int row: the row, in the array's coordinates
+ *              int i: the word, covering the view's columns 64 i onwards
+ * Return: the word, with bits past the view's width zero
+ * Expects:
+ *      row and i to be in range
+ * Notes:
+ *      None
+ ************************/
+static uint64_t view_word(Bit2_view view, int row, int i)
+{
+        int shift = view.col % CHUNK_BITS;
+        int w = view.col / CHUNK_BITS + i;
+        uint64_t word = load_word(view.array, row, w) >> shift;
+        if (shift != 0) {
+                word |= load_word(view.array, row, w + 1) 
+                                                << (CHUNK_BITS - shift);
+        }
+
+        int bits = view.width - i * CHUNK_BITS;
+        return bits >= CHUNK_BITS ? word 
+                                 : word & (((uint64_t)1 << bits) - 1);
+}
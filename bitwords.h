@@ -0,0 +1,72 @@
+/*
+ *     bitwords.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Word-at-a-time bit helpers shared by the two Bit2 
+ *              implementations (bit2.c and bit2_chunked.c), which both 
+ *              keep rows as 64-bit words. Internal: not part of the Bit2 
+ *              interface
+ */
+
+#ifndef BITWORDS_INCLUDED
+#define BITWORDS_INCLUDED
+
+#include <stdint.h>
+#include "bit2.h"
+
+/**********map_word_bits********
+ *
+ * Calls apply for each one bit of word, lowest bit first
+ * Inputs:
+ *              uint64_t word: the bits to visit, with bit i standing for 
+ *                             column col + i
+ *              int col: the column of bit 0 of word
+ *              int row: the row the word belongs to
+ *              int bit: the value passed on to apply
+ *              Bit2_T bit2_array, apply, cl: passed on to apply
+ * Return: N/A
+ * Expects:
+ *      None
+ * Notes:
+ *      Jumps from one bit to the next with count-trailing-zeros, then 
+ *      clears the lowest set bit, so zero bits cost nothing
+ ************************/
+static inline void map_word_bits(uint64_t word, int col, int row, int bit,
+                                 Bit2_T bit2_array, void apply(int col, 
+                                 int row, Bit2_T bit2_array, int bit, 
+                                 void *cl), void *cl)
+{
+        while (word != 0) {
+                apply(col + __builtin_ctzll(word), row, bit2_array, bit, cl);
+                word &= word - 1;
+        }
+}
+
+/**********transpose64********
+ *
+ * Transposes a 64 x 64 bit matrix in place, so that bit j of word i ends up
+ * as bit i of word j
+ * Inputs:
+ *              uint64_t tile[64]: the matrix, one word per row
+ * Return: N/A
+ * Expects:
+ *      tile to be nonnull
+ * Notes:
+ *      Swaps ever smaller blocks (32 x 32 down to 1 x 1) across the 
+ *      diagonal using shifts and masks on whole words, 6 rounds of 32 word
+ *      pairs in all, rather than moving bits one at a time
+ ************************/
+static inline void transpose64(uint64_t tile[64])
+{
+        uint64_t mask = 0x00000000FFFFFFFFULL;
+        for (int j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+                for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+                        uint64_t t = ((tile[k] >> j) ^ tile[k | j]) & mask;
+                        tile[k] ^= t << j;
+                        tile[k | j] ^= t;
+                }
+        }
+}
+
+#endif
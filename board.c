@@ -0,0 +1,352 @@
+/*
+ *     board.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of packed sudoku boards. Reading a cell is a
+ *              shift and a mask with no branches, and a unit (row, column
+ *              or box) is checked by ORing one bit per digit into a mask.
+ *              Which cells make up each unit comes from the tables of 
+ *              units.h
+ */
+
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+
+#include "board.h"
+#include "units.h"
+
+#define OUT_OF_RANGE 15
+
+/* the bits of the last byte that hold a cell */
+#define PAD_MASK 0x0f
+
+static inline int nibble(const Board *board, int cell)
+{
+        return (board->nibbles[cell >> 1] >> ((cell & 1) << 2)) & 0xf;
+}
+
+static void relabel(unsigned char cells[BOARD_CELLS]);
+static void unit_digits(const Board *board, int unit, 
+                                        unsigned char digits[BOARD_SIDE]);
+
+/**********Board_clear********
+ *
+ * Blanks every cell of a board
+ * Inputs:
+ *              Board *board: the board to clear
+ * Return: N/A
+ * Expects:
+ *      board to be nonnull
+ * Notes:
+ *      A Board of all zero bytes is blank, so static and calloc'd boards
+ *      need no clearing
+ ************************/
+void Board_clear(Board *board)
+{
+        assert(board != NULL);
+        memset(board, 0, sizeof(*board));
+}
+
+/**********Board_get********
+ *
+ * Returns one cell of a board
+ * Inputs:
+ *              const Board *board: the board
+ *              int col, int row: the cell, each from 0 to 8
+ * Return: 0 for a blank cell, 1 to 9 for a digit, 15 for a value that was
+ *         out of range
+ * Expects:
+ *      board to be nonnull; col and row in range
+ * Notes:
+ *      Checked runtime error if board is null or the cell is out of range
+ ************************/
+int Board_get(const Board *board, int col, int row)
+{
+        assert(board != NULL);
+        assert(col >= 0 && col < BOARD_SIDE && row >= 0 && row < BOARD_SIDE);
+        return nibble(board, row * BOARD_SIDE + col);
+}
+
+/**********Board_set********
+ *
+ * Sets one cell of a board
+ * Inputs:
+ *              Board *board: the board
+ *              int col, int row: the cell, each from 0 to 8
+ *              int digit: the value for the cell
+ * Return: N/A
+ * Expects:
+ *      board to be nonnull; col and row in range
+ * Notes:
+ *      * Checked runtime error if board is null or the cell is out of range
+ *      * A digit below 0 or over 9 is stored as 15, which no check accepts
+ *      * Leaves the unused bits of the last byte as they are, so board must
+ *      have been zeroed (see Board_clear) for memcmp to compare it
+ ************************/
+void Board_set(Board *board, int col, int row, int digit)
+{
+        assert(board != NULL);
+        assert(col >= 0 && col < BOARD_SIDE && row >= 0 && row < BOARD_SIDE);
+        if (digit < 0 || digit > BOARD_SIDE) {
+                digit = OUT_OF_RANGE;
+        }
+
+        int cell = row * BOARD_SIDE + col;
+        int shift = (cell & 1) << 2;
+        unsigned char *byte = &board->nibbles[cell >> 1];
+        *byte = (*byte & ~(0xf << shift)) | (digit << shift);
+}
+
+/**********Board_row********
+ *
+ * Copies out the cells of one row
+ * Inputs:
+ *              const Board *board: the board
+ *              int row: the row, from 0 to 8
+ *              unsigned char digits[9]: set to the row, left to right
+ * Return: N/A
+ * Expects:
+ *      board and digits to be nonnull; row in range
+ * Notes:
+ *      None
+ ************************/
+void Board_row(const Board *board, int row, unsigned char digits[BOARD_SIDE])
+{
+        assert(board != NULL && digits != NULL);
+        assert(row >= 0 && row < BOARD_SIDE);
+        unit_digits(board, row, digits);
+}
+
+/**********Board_col********
+ *
+ * Copies out the cells of one column
+ * Inputs:
+ *              const Board *board: the board
+ *              int col: the column, from 0 to 8
+ *              unsigned char digits[9]: set to the column, top to bottom
+ * Return: N/A
+ * Expects:
+ *      board and digits to be nonnull; col in range
+ * Notes:
+ *      None
+ ************************/
+void Board_col(const Board *board, int col, unsigned char digits[BOARD_SIDE])
+{
+        assert(board != NULL && digits != NULL);
+        assert(col >= 0 && col < BOARD_SIDE);
+        unit_digits(board, BOARD_SIDE + col, digits);
+}
+
+/**********Board_box********
+ *
+ * Copies out the cells of one 3x3 box
+ * Inputs:
+ *              const Board *board: the board
+ *              int box: the box, from 0 (top left) to 8 (bottom right), in
+ *                       row-major order
+ *              unsigned char digits[9]: set to the box, in row-major order
+ * Return: N/A
+ * Expects:
+ *      board and digits to be nonnull; box in range
+ * Notes:
+ *      None
+ ************************/
+void Board_box(const Board *board, int box, unsigned char digits[BOARD_SIDE])
+{
+        assert(board != NULL && digits != NULL);
+        assert(box >= 0 && box < BOARD_SIDE);
+        unit_digits(board, 2 * BOARD_SIDE + box, digits);
+}
+
+/**********Board_equal********
+ *
+ * Checks whether two boards hold the same value in every cell
+ * Inputs:
+ *              const Board *board1, const Board *board2: the boards
+ * Return: true if every cell of board1 equals the same cell of board2
+ * Expects:
+ *      board1 and board2 to be nonnull
+ * Notes:
+ *      The unused high 4 bits of the last byte are not compared, so a board
+ *      that was not zeroed before it was filled still compares correctly
+ ************************/
+bool Board_equal(const Board *board1, const Board *board2)
+{
+        assert(board1 != NULL && board2 != NULL);
+        return memcmp(board1->nibbles, board2->nibbles, BOARD_BYTES - 1) == 0
+               && ((board1->nibbles[BOARD_BYTES - 1] ^ 
+                    board2->nibbles[BOARD_BYTES - 1]) & PAD_MASK) == 0;
+}
+
+/**********Board_solved********
+ *
+ * Checks whether a board is a solved puzzle
+ * Inputs:
+ *              const Board *board: the board
+ * Return: true if every row, column and box holds each digit 1 to 9 once
+ * Expects:
+ *      board to be nonnull
+ * Notes:
+ *      * A blank or out of range cell sets bit 0 or 15 of its unit's mask, 
+ *      so it fails the check like a repeated digit does
+ *      * Every unit is checked, without stopping early, so the time taken
+ *      is the same for every board
+ *      * The cells are unpacked once, then the 27 units are checked as 
+ *      straight-line code: each lookup is at an index fixed at compile 
+ *      time, so there are no loops, divisions or branches
+ ************************/
+bool Board_solved(const Board *board)
+{
+        assert(board != NULL);
+        unsigned char cells[2 * BOARD_BYTES];
+        for (int i = 0; i < BOARD_BYTES; i++) {
+                cells[2 * i] = board->nibbles[i] & 0xf;
+                cells[2 * i + 1] = board->nibbles[i] >> 4;
+        }
+
+#define UNITS_COMPLETE3(u) (UNIT_COMPLETE(cells, u) & \
+                            UNIT_COMPLETE(cells, (u) + 1) & \
+                            UNIT_COMPLETE(cells, (u) + 2))
+        return UNITS_COMPLETE3(0) & UNITS_COMPLETE3(3) & UNITS_COMPLETE3(6) &
+               UNITS_COMPLETE3(9) & UNITS_COMPLETE3(12) & 
+               UNITS_COMPLETE3(15) & UNITS_COMPLETE3(18) & 
+               UNITS_COMPLETE3(21) & UNITS_COMPLETE3(24);
+#undef UNITS_COMPLETE3
+}
+
+/**********Board_canonical********
+ *
+ * Finds the canonical form of a board: one board shared by all of its 
+ * variants under relabeling of the digits and transposition
+ * Inputs:
+ *              const Board *board: the board
+ *              Board *canonical: set to its canonical form
+ * Return: N/A
+ * Expects:
+ *      board and canonical to be nonnull
+ * Notes:
+ *      * The board and its transpose are each relabeled so digits are 
+ *      numbered 1, 2, ... in the order they first appear, and the smaller 
+ *      of the two (by memcmp of their cells) is the canonical form
+ *      * The cells are unpacked once, into the board and its transpose,
+ *      relabeled a byte at a time and packed again at the end
+ *      * Blank and out of range cells are left as they are, so a board is
+ *      solved exactly when its canonical form is
+ *      * Row and column permutations within bands and stacks are not 
+ *      folded in: finding the least of the millions of such variants costs
+ *      far more than checking the board
+ *      * bench_sudoku measures whether a cache keyed on this form pays
+ ************************/
+void Board_canonical(const Board *board, Board *canonical)
+{
+        assert(board != NULL && canonical != NULL);
+        unsigned char rows[BOARD_CELLS + 1], cols[BOARD_CELLS + 1];
+        for (int row = 0; row < BOARD_SIDE; row++) {
+                for (int col = 0; col < BOARD_SIDE; col++) {
+                        int digit = nibble(board, row * BOARD_SIDE + col);
+                        rows[row * BOARD_SIDE + col] = digit;
+                        cols[col * BOARD_SIDE + row] = digit;
+                }
+        }
+        relabel(rows);
+        relabel(cols);
+        const unsigned char *least = memcmp(cols, rows, BOARD_CELLS) < 0 
+                                                ? cols : rows;
+
+        /* the padding cell makes the last byte's high bits 0 */
+        rows[BOARD_CELLS] = cols[BOARD_CELLS] = 0;
+        for (int i = 0; i < BOARD_BYTES; i++) {
+                canonical->nibbles[i] = least[2 * i] | least[2 * i + 1] << 4;
+        }
+}
+
+/**********Board_hash********
+ *
+ * Hashes a board to 64 bits
+ * Inputs:
+ *              const Board *board: the board
+ * Return: the hash
+ * Expects:
+ *      board to be nonnull
+ * Notes:
+ *      * Mixes the board eight bytes at a time with the splitmix64 
+ *      finalizer, so boards differing in any cell hash far apart
+ *      * Hash the canonical form to have variants share a hash
+ *      * As in Board_equal, the unused bits of the last byte are ignored
+ ************************/
+uint64_t Board_hash(const Board *board)
+{
+        assert(board != NULL);
+        uint64_t hash = 0x9e3779b97f4a7c15u;
+        for (int i = 0; i < BOARD_BYTES; i += 8) {
+                uint64_t word = 0;
+                int length = BOARD_BYTES - i < 8 ? BOARD_BYTES - i : 8;
+                memcpy(&word, board->nibbles + i, length);
+                if (i + length == BOARD_BYTES) {
+                        /* leave out the unused high bits of the last byte */
+                        word &= ~((uint64_t)(0xff & ~PAD_MASK) << 
+                                                        8 * (length - 1));
+                }
+
+                hash ^= word;
+                hash ^= hash >> 30;
+                hash *= 0xbf58476d1ce4e5b9u;
+                hash ^= hash >> 27;
+                hash *= 0x94d049bb133111ebu;
+                hash ^= hash >> 31;
+        }
+        return hash;
+}
+
+/**********relabel********
+ *
+ * Renumbers the digits of a board's cells in the order they first appear
+ * Inputs:
+ *              unsigned char cells[BOARD_CELLS]: a board's cells, one per
+ *                                                byte in reading order;
+ *                                                renumbered in place
+ * Return: N/A
+ * Expects:
+ *      cells to be nonnull
+ * Notes:
+ *      Cells of 0 and 15 keep their values
+ ************************/
+static void relabel(unsigned char cells[BOARD_CELLS])
+{
+        unsigned char label[16] = { 0 };
+        label[OUT_OF_RANGE] = OUT_OF_RANGE;
+        int next = 1;
+
+        for (int i = 0; i < BOARD_CELLS; i++) {
+                int digit = cells[i];
+                if (digit != 0 && label[digit] == 0) {
+                        label[digit] = next++;
+                }
+                cells[i] = label[digit];
+        }
+}
+
+/**********unit_digits********
+ *
+ * Copies out the cells of one unit
+ * Inputs:
+ *              const Board *board: the board
+ *              int unit: the unit, numbered as in units.h
+ *              unsigned char digits[9]: set to the unit's cells, in 
+ *                                       row-major order
+ * Return: N/A
+ * Expects:
+ *      board and digits to be nonnull; unit from 0 to 26
+ * Notes:
+ *      None
+ ************************/
+static void unit_digits(const Board *board, int unit, 
+                                        unsigned char digits[BOARD_SIDE])
+{
+        const unsigned char *cells = UNIT_CELLS[unit];
+        for (int i = 0; i < BOARD_SIDE; i++) {
+                digits[i] = nibble(board, cells[i]);
+        }
+}
@@ -0,0 +1,50 @@
+/*
+ *     board.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for packed 9 x 9 sudoku boards. A board is a plain
+ *              41-byte value holding each cell in 4 bits, so boards can be
+ *              kept in arrays, copied and compared without any allocation
+ */
+
+#ifndef BOARD_INCLUDED
+#define BOARD_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BOARD_SIDE 9
+#define BOARD_CELLS (BOARD_SIDE * BOARD_SIDE)
+#define BOARD_BYTES ((BOARD_CELLS + 1) / 2)
+
+/* 
+ * Cell (col, row) is cell i = row * 9 + col, held in the low 4 bits of 
+ * byte i / 2 when i is even and the high 4 bits when it is odd. A cell is 0
+ * when blank, 1 to 9 for a digit, and 15 for anything out of range.
+ *
+ * The high 4 bits of the last byte hold no cell. A board must start out 
+ * zeroed, by Board_clear or as a static or calloc'd board, before it is 
+ * filled with Board_set; those bits are then 0 and stay 0, and two boards
+ * can be compared with memcmp. Board_equal compares boards without relying
+ * on that
+ */
+typedef struct Board {
+        unsigned char nibbles[BOARD_BYTES];
+} Board;
+
+extern void Board_clear(Board *board);
+extern int Board_get(const Board *board, int col, int row);
+extern void Board_set(Board *board, int col, int row, int digit);
+extern void Board_row(const Board *board, int row, 
+                                        unsigned char digits[BOARD_SIDE]);
+extern void Board_col(const Board *board, int col, 
+                                        unsigned char digits[BOARD_SIDE]);
+extern void Board_box(const Board *board, int box, 
+                                        unsigned char digits[BOARD_SIDE]);
+extern bool Board_equal(const Board *board1, const Board *board2);
+extern bool Board_solved(const Board *board);
+extern void Board_canonical(const Board *board, Board *canonical);
+extern uint64_t Board_hash(const Board *board);
+
+#endif
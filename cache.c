@@ -0,0 +1,338 @@
+/*
+ *     cache.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of the result cache. The slots live in a 
+ *              shared mapping, either anonymous (shared with processes 
+ *              forked later, such as server workers) or of a file (shared 
+ *              with later runs). Each slot holds a whole board, so a hit 
+ *              is never trusted on its hash alone, and a tag word that 
+ *              makes the slot safe to use from many processes at once 
+ *              without a lock.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+#define T Cache_T
+
+/* how many slots past its home a board may be stored in */
+#define PROBES 8
+
+/* words of a slot holding the board */
+#define BOARD_WORDS ((sizeof(Board) + 7) / 8)
+
+static const char MAGIC[8] = "SUDCACH2";
+
+/* 
+ * The start of the mapping, followed by the slots
+ */
+struct header {
+        char magic[8];
+        uint64_t num_slots;
+};
+
+/* 
+ * A tag is EMPTY, BUSY while a process writes the slot, or else the high 
+ * 62 bits of the board's hash, then 1, then the result. The slot is one 
+ * cache line
+ */
+enum { EMPTY = 0, BUSY = 1, FULL = 2 };
+
+struct slot {
+        uint64_t tag;
+        uint64_t board[BOARD_WORDS];
+        uint64_t unused[7 - BOARD_WORDS];
+};
+
+struct T {
+        struct header *header;
+        struct slot *slots;
+        uint64_t mask;          /* num_slots - 1 */
+        size_t size;            /* of the mapping */
+};
+
+static int open_file(const char *path, size_t size, uint64_t num_slots);
+static bool holds_cache(int fd, size_t *size);
+
+static inline uint64_t tag_of(uint64_t hash, bool result)
+{
+        return (hash & ~(uint64_t)3) | FULL | result;
+}
+
+/**********Cache_new********
+ *
+ * Creates an empty cache, or opens one kept in a file
+ * Inputs:
+ *              const char *path: the file to keep the cache in, or NULL to
+ *                                keep it in memory only
+ *              int log2_slots: the cache holds 2^log2_slots results
+ * Return: the cache
+ * Expects:
+ *      log2_slots to be from 1 to 36
+ * Notes:
+ *      * A file that already holds a cache is used as it is, whatever its
+ *      size. Anything else at path is replaced by a new, empty cache
+ *      * An existing file is never resized, so processes that have it 
+ *      mapped are not disturbed
+ *      * The memory is shared: a process forked after Cache_new uses the
+ *      same slots as its parent
+ *      * Checked runtime error if the file cannot be opened or mapped
+ *      * The client must use Cache_free when done
+ ************************/
+T Cache_new(const char *path, int log2_slots)
+{
+        assert(log2_slots > 0 && log2_slots <= 36);
+        T cache = malloc(sizeof(*cache));
+        assert(cache != NULL);
+
+        uint64_t num_slots = (uint64_t)1 << log2_slots;
+        cache->size = sizeof(struct header) + 
+                                        num_slots * sizeof(struct slot);
+
+        if (path == NULL) {
+                cache->header = mmap(NULL, cache->size, 
+                                     PROT_READ | PROT_WRITE, 
+                                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+                assert(cache->header != MAP_FAILED);
+                memcpy(cache->header->magic, MAGIC, 8);
+                cache->header->num_slots = num_slots;
+        } else {
+                int fd = open_file(path, cache->size, num_slots);
+                bool valid = holds_cache(fd, &cache->size);
+                assert(valid);
+                cache->header = mmap(NULL, cache->size, 
+                                     PROT_READ | PROT_WRITE, MAP_SHARED, 
+                                     fd, 0);
+                assert(cache->header != MAP_FAILED);
+                close(fd);
+        }
+
+        cache->slots = (struct slot *)(cache->header + 1);
+        cache->mask = cache->header->num_slots - 1;
+        return cache;
+}
+
+/**********open_file********
+ *
+ * Opens the file holding a cache, first making a new one if there is none
+ * Inputs:
+ *              const char *path: the file
+ *              size_t size: the size of a new cache's file
+ *              uint64_t num_slots: how many slots a new cache has
+ * Return: a read/write descriptor for the file
+ * Expects:
+ *      path to be nonnull
+ * Notes:
+ *      * A new cache is sized and given its header in a temporary file 
+ *      beside path, then linked to path (or renamed over a file that is 
+ *      not a cache), so no process ever sees a cache half made
+ *      * When another process makes the cache first, its cache is used
+ *      * Checked runtime error if a file cannot be made or opened
+ ************************/
+static int open_file(const char *path, size_t size, uint64_t num_slots)
+{
+        int fd = open(path, O_RDWR);
+        size_t existing_size;
+        if (fd >= 0 && holds_cache(fd, &existing_size)) {
+                return fd;
+        }
+        bool missing = fd < 0;
+        assert(missing ? errno == ENOENT : true);
+        if (!missing) {
+                close(fd);
+        }
+
+        size_t length = strlen(path);
+        char *temp = malloc(length + sizeof(".XXXXXX"));
+        assert(temp != NULL);
+        memcpy(temp, path, length);
+        memcpy(temp + length, ".XXXXXX", sizeof(".XXXXXX"));
+        fd = mkstemp(temp);
+        assert(fd >= 0);
+
+        struct header header;
+        memcpy(header.magic, MAGIC, 8);
+        header.num_slots = num_slots;
+        int status = fchmod(fd, 0644);
+        status |= ftruncate(fd, size);
+        assert(status == 0);
+        ssize_t written = pwrite(fd, &header, sizeof(header), 0);
+        assert(written == (ssize_t)sizeof(header));
+
+        if (missing && link(temp, path) != 0) {
+                /* another process made the cache first */
+                assert(errno == EEXIST);
+                close(fd);
+                fd = open(path, O_RDWR);
+                assert(fd >= 0);
+        } else if (!missing) {
+                status = rename(temp, path);
+                assert(status == 0);
+        }
+        unlink(temp);
+        free(temp);
+        return fd;
+}
+
+/**********holds_cache********
+ *
+ * Checks whether an open file holds a cache
+ * Inputs:
+ *              int fd: the file
+ *              size_t *size: set to the size of the file, if it does
+ * Return: true if the file starts with a cache header and is exactly as 
+ *         long as the header says
+ * Expects:
+ *      size to be nonnull
+ ************************/
+static bool holds_cache(int fd, size_t *size)
+{
+        struct header header;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || 
+            pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+            memcmp(header.magic, MAGIC, 8) != 0 || header.num_slots < 2 || 
+            (header.num_slots & (header.num_slots - 1)) != 0 ||
+            (uint64_t)info.st_size != sizeof(header) + 
+                                header.num_slots * sizeof(struct slot)) {
+                return false;
+        }
+        *size = info.st_size;
+        return true;
+}
+
+/**********Cache_free********
+ *
+ * Unmaps a cache, leaving its file (if any) holding what was stored
+ * Inputs:
+ *              T *cache: pointer to the cache to free
+ * Return: N/A
+ * Expects:
+ *      cache and *cache to be nonnull
+ * Notes:
+ *      Sets *cache to NULL
+ ************************/
+void Cache_free(T *cache)
+{
+        assert(cache != NULL && *cache != NULL);
+        munmap((*cache)->header, (*cache)->size);
+        free(*cache);
+        *cache = NULL;
+}
+
+/**********Cache_lookup********
+ *
+ * Finds the result stored for a board
+ * Inputs:
+ *              T cache: the cache
+ *              const Board *board: the board to look for
+ *              uint64_t hash: its Board_hash
+ *              bool *result: set to the result, if one is found
+ * Return: true if the board was found
+ * Expects:
+ *      cache, board and result to be nonnull
+ * Notes:
+ *      * Looks at no more than PROBES slots, from the one the low bits of
+ *      hash pick
+ *      * A slot whose tag matches is copied out and its tag read again; 
+ *      the copy is used only if the tag has not changed and the board in 
+ *      it equals the one looked for
+ ************************/
+bool Cache_lookup(T cache, const Board *board, uint64_t hash, bool *result)
+{
+        assert(cache != NULL && board != NULL && result != NULL);
+        uint64_t key = tag_of(hash, false);
+        for (uint64_t i = 0; i < PROBES; i++) {
+                struct slot *slot = &cache->slots[(hash + i) & cache->mask];
+                uint64_t tag = __atomic_load_n(&slot->tag, __ATOMIC_ACQUIRE);
+                if (tag == EMPTY) {
+                        return false;
+                }
+                if ((tag & ~(uint64_t)1) != key) {
+                        continue;
+                }
+
+                uint64_t words[BOARD_WORDS];
+                for (size_t j = 0; j < BOARD_WORDS; j++) {
+                        words[j] = __atomic_load_n(&slot->board[j], 
+                                                   __ATOMIC_RELAXED);
+                }
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&slot->tag, __ATOMIC_RELAXED) != tag) {
+                        continue;
+                }
+
+                Board stored;
+                memcpy(&stored, words, sizeof(stored));
+                if (Board_equal(&stored, board)) {
+                        *result = tag & 1;
+                        return true;
+                }
+        }
+        return false;
+}
+
+/**********Cache_insert********
+ *
+ * Stores the result for a board
+ * Inputs:
+ *              T cache: the cache
+ *              const Board *board: the board
+ *              uint64_t hash: its Board_hash
+ *              bool result: its result
+ * Return: N/A
+ * Expects:
+ *      cache and board to be nonnull
+ * Notes:
+ *      * Goes in the first empty slot, or slot with the same hash, of the
+ *      PROBES after the board's home. When they are all taken by other 
+ *      boards, the home slot is overwritten, so the cache never grows
+ *      * The slot's tag is set to BUSY while the board is written. If 
+ *      another process is writing the slot, nothing is stored: the cache 
+ *      may forget a result, but never gives a wrong one. A slot left 
+ *      BUSY by a process that died mid-write is never used again
+ ************************/
+void Cache_insert(T cache, const Board *board, uint64_t hash, bool result)
+{
+        assert(cache != NULL && board != NULL);
+        uint64_t key = tag_of(hash, false);
+        struct slot *target = &cache->slots[hash & cache->mask];
+        for (uint64_t i = 0; i < PROBES; i++) {
+                struct slot *slot = &cache->slots[(hash + i) & cache->mask];
+                uint64_t tag = __atomic_load_n(&slot->tag, __ATOMIC_RELAXED);
+                if (tag == EMPTY || (tag & ~(uint64_t)1) == key) {
+                        target = slot;
+                        break;
+                }
+        }
+
+        uint64_t words[BOARD_WORDS] = { 0 };
+        memcpy(words, board, sizeof(*board));
+
+        uint64_t tag = __atomic_load_n(&target->tag, __ATOMIC_RELAXED);
+        if (tag == BUSY || 
+            !__atomic_compare_exchange_n(&target->tag, &tag, BUSY, false, 
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                return;
+        }
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        for (size_t j = 0; j < BOARD_WORDS; j++) {
+                __atomic_store_n(&target->board[j], words[j], 
+                                 __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&target->tag, tag_of(hash, result), 
+                         __ATOMIC_RELEASE);
+}
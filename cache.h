@@ -0,0 +1,30 @@
+/*
+ *     cache.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for a fixed-size cache of yes/no results for 
+ *              sudoku boards, kept in memory shared with child processes 
+ *              or in a file that outlasts the program
+ */
+
+#ifndef CACHE_INCLUDED
+#define CACHE_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "board.h"
+
+#define T Cache_T
+typedef struct T *T;
+
+extern T Cache_new(const char *path, int log2_slots);
+extern void Cache_free(T *cache);
+extern bool Cache_lookup(T cache, const Board *board, uint64_t hash, 
+                                                        bool *result);
+extern void Cache_insert(T cache, const Board *board, uint64_t hash, 
+                                                        bool result);
+
+#undef T
+#endif
@@ -0,0 +1,190 @@
+/*
+ *     grid.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of the incrementally checked sudoku grid
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "grid.h"
+#include "units.h"
+
+#define T Grid_T
+
+#define SIDE 9
+#define CELLS (SIDE * SIDE)
+
+/*
+ * Every cell belongs to three units, its row, column and box, numbered as
+ * in units.h. counts[unit][digit] is how many cells of the unit hold the 
+ * digit, and conflicts is the sum, over every unit and digit, of the copies
+ * past the first. A move only changes the counts of 
+ * the three units of its cell, so it updates conflicts and filled in 
+ * constant time, and the grid is consistent exactly when conflicts is 0.
+ */
+struct T {
+        unsigned char cells[CELLS];
+        unsigned char counts[NUM_UNITS][SIDE + 1];
+        int conflicts;
+        int filled;             /* cells holding a digit */
+};
+
+/**********Grid_new********
+ *
+ * Creates an empty grid
+ * Inputs:
+ *              None
+ * Return: A new grid with every cell blank
+ * Expects:
+ *      None
+ * Notes:
+ *      * Checked runtime error if memory cannot be allocated
+ *      * The client must use Grid_free once the grid is no longer needed
+ ************************/
+T Grid_new(void)
+{
+        T grid = malloc(sizeof(*grid));
+        assert(grid != NULL);
+        Grid_clear(grid);
+        return grid;
+}
+
+/**********Grid_free********
+ *
+ * Deallocates a grid and sets *grid to NULL
+ * Inputs:
+ *              T *grid: pointer to the grid to free
+ * Return: N/A
+ * Expects:
+ *      grid and *grid to be nonnull
+ * Notes:
+ *      Checked runtime error if grid or *grid is null
+ ************************/
+void Grid_free(T *grid)
+{
+        assert(grid != NULL && *grid != NULL);
+        free(*grid);
+        *grid = NULL;
+}
+
+/**********Grid_clear********
+ *
+ * Blanks every cell of a grid
+ * Inputs:
+ *              T grid: the grid to clear
+ * Return: N/A
+ * Expects:
+ *      grid to be nonnull
+ * Notes:
+ *      Lets one grid be used for one board after another
+ ************************/
+void Grid_clear(T grid)
+{
+        assert(grid != NULL);
+        memset(grid, 0, sizeof(*grid));
+}
+
+/**********Grid_get********
+ *
+ * Returns the digit in one cell
+ * Inputs:
+ *              T grid: the grid
+ *              int col, int row: the cell, each from 0 to 8
+ * Return: the digit in the cell, or 0 if it is blank
+ * Expects:
+ *      grid to be nonnull; col and row in range
+ * Notes:
+ *      Checked runtime error if grid is null or the cell is out of range
+ ************************/
+int Grid_get(T grid, int col, int row)
+{
+        assert(grid != NULL);
+        assert(col >= 0 && col < SIDE && row >= 0 && row < SIDE);
+        return grid->cells[row * SIDE + col];
+}
+
+/**********Grid_place********
+ *
+ * Puts a digit in one cell, or clears it, keeping the checks up to date
+ * Inputs:
+ *              T grid: the grid
+ *              int col, int row: the cell, each from 0 to 8
+ *              int digit: 1 to 9, or 0 to clear the cell
+ * Return: the digit the cell held before, or 0 if it was blank
+ * Expects:
+ *      grid to be nonnull; col, row and digit in range
+ * Notes:
+ *      * Checked runtime error if grid is null, or the cell or digit is out
+ *      of range
+ *      * Takes constant time: only the three units of the cell change
+ ************************/
+int Grid_place(T grid, int col, int row, int digit)
+{
+        assert(grid != NULL);
+        assert(col >= 0 && col < SIDE && row >= 0 && row < SIDE);
+        assert(digit >= 0 && digit <= SIDE);
+
+        int index = row * SIDE + col;
+        const unsigned char *units = CELL_UNITS[index];
+        unsigned char *cell = &grid->cells[index];
+        int old = *cell;
+
+        if (old != 0) {
+                for (int i = 0; i < 3; i++) {
+                        if (--grid->counts[units[i]][old] > 0) {
+                                grid->conflicts--;
+                        }
+                }
+                grid->filled--;
+        }
+        if (digit != 0) {
+                for (int i = 0; i < 3; i++) {
+                        if (grid->counts[units[i]][digit]++ > 0) {
+                                grid->conflicts++;
+                        }
+                }
+                grid->filled++;
+        }
+        *cell = digit;
+        return old;
+}
+
+/**********Grid_consistent********
+ *
+ * Checks that no digit is repeated in any row, column or box
+ * Inputs:
+ *              T grid: the grid
+ * Return: true if the digits placed so far break no rule, even if some
+ *         cells are still blank
+ * Expects:
+ *      grid to be nonnull
+ * Notes:
+ *      Takes constant time
+ ************************/
+bool Grid_consistent(T grid)
+{
+        assert(grid != NULL);
+        return grid->conflicts == 0;
+}
+
+/**********Grid_solved********
+ *
+ * Checks whether a grid is a solved puzzle
+ * Inputs:
+ *              T grid: the grid
+ * Return: true if every cell holds a digit and no digit is repeated in any
+ *         row, column or box
+ * Expects:
+ *      grid to be nonnull
+ * Notes:
+ *      Takes constant time
+ ************************/
+bool Grid_solved(T grid)
+{
+        assert(grid != NULL);
+        return grid->filled == CELLS && grid->conflicts == 0;
+}
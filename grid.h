@@ -0,0 +1,29 @@
+/*
+ *     grid.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for an incrementally checked 9 x 9 sudoku grid.
+ *              Digits are placed and cleared one at a time, and whether the
+ *              grid is consistent (no digit repeated in a row, column or 
+ *              box) or solved is known after every move
+ */
+
+#ifndef GRID_INCLUDED
+#define GRID_INCLUDED
+
+#include <stdbool.h>
+
+#define T Grid_T
+typedef struct T *T;
+
+extern T Grid_new(void);
+extern void Grid_free(T *grid);
+extern void Grid_clear(T grid);
+extern int Grid_get(T grid, int col, int row);
+extern int Grid_place(T grid, int col, int row, int digit);
+extern bool Grid_consistent(T grid);
+extern bool Grid_solved(T grid);
+
+#undef T
+#endif
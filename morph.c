@@ -0,0 +1,576 @@
+/*
+ *     morph.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of binary morphology on 2D Bit Arrays. The
+ *              image is worked on as packed rows of 64-bit words. Each 
+ *              operation is split into a horizontal pass of shifts and ORs 
+ *              (about log2 of the element width of them) and a vertical 
+ *              pass of running ORs whose cost does not depend on the 
+ *              element height.
+ *              Erosion is the complement of the dilation of the complement.
+ *
+ *              The structuring element is se_width x se_height with its 
+ *              anchor at the center (rounding up and to the left). Pixels 
+ *              outside the image count as white when dilating and as black
+ *              when eroding, so neither operation is affected by the border.
+ */
+
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "morph.h"
+#include "uarray2.h"
+
+#define WORD_BITS 64
+
+/* 
+ * The rows of an image, packed and held in one block of words. The block 
+ * and all other scratch space come from the caller's pool and go back to it
+ */
+struct rows {
+        uint64_t *words;        /* height rows of words_per_row words */
+        UArray2_T block;        /* the array holding words */
+        Pool_T pool;
+        int words_per_row;
+        int width;
+        int height;
+};
+
+/* How far a window reaches from its anchor in each direction */
+struct reach {
+        int left;
+        int right;
+        int up;
+        int down;
+};
+
+static struct rows load_rows(Bit2_T image, Pool_T pool);
+static void store_rows(struct rows *rows, Bit2_T image);
+static uint64_t *scratch_words(Pool_T pool, int n, int count, 
+                                                UArray2_T *block);
+static struct reach centered(int se_width, int se_height, bool reflected);
+static void erode_rows(struct rows *rows, struct reach reach);
+static void dilate_rows(struct rows *rows, struct reach reach);
+typedef void (*shift_fn)(const uint64_t *src, uint64_t *dest, int n, 
+                                                                int shift);
+
+static void dilate_horizontal(struct rows *rows, int left, int right);
+static void or_run(uint64_t *row, uint64_t *scratch, int n, int reach, 
+                                                        shift_fn shift);
+static void dilate_vertical(struct rows *rows, int up, int down);
+static void shift_toward_left(const uint64_t *src, uint64_t *dest, int n, 
+                                                                int shift);
+static void shift_toward_right(const uint64_t *src, uint64_t *dest, int n, 
+                                                                int shift);
+static void complement_rows(struct rows *rows);
+static void clear_padding(struct rows *rows);
+
+/**********Morph_erode********
+ *
+ * Erodes image by a rectangular structuring element, leaving a pixel black
+ * only when every pixel under the element anchored there was black
+ * Inputs:
+ *              Bit2_T image: the image to erode, changed in place
+ *              int se_width: width of the structuring element
+ *              int se_height: height of the structuring element
+ *              Pool_T pool: where working space is taken from
+ * Return: N/A
+ * Expects:
+ *      image and pool to be nonnull; se_width and se_height to be 
+ *      positive
+ * Notes:
+ *      * Checked runtime error if image or pool is null, the element is 
+ *      empty, or memory cannot be allocated
+ *      * Allocates nothing once pool holds arrays large enough for image
+ ************************/
+void Morph_erode(Bit2_T image, int se_width, int se_height, Pool_T pool)
+{
+        assert(se_width > 0 && se_height > 0);
+        struct rows rows = load_rows(image, pool);
+        erode_rows(&rows, centered(se_width, se_height, false));
+        store_rows(&rows, image);
+}
+
+/**********Morph_dilate********
+ *
+ * Dilates image by a rectangular structuring element, making a pixel black
+ * when any pixel under the element anchored there was black
+ * Inputs:
+ *              Bit2_T image: the image to dilate, changed in place
+ *              int se_width: width of the structuring element
+ *              int se_height: height of the structuring element
+ *              Pool_T pool: where working space is taken from
+ * Return: N/A
+ * Expects:
+ *      image and pool to be nonnull; se_width and se_height to be 
+ *      positive
+ * Notes:
+ *      * Checked runtime error if image or pool is null, the element is 
+ *      empty, or memory cannot be allocated
+ *      * Allocates nothing once pool holds arrays large enough for image
+ ************************/
+void Morph_dilate(Bit2_T image, int se_width, int se_height, Pool_T pool)
+{
+        assert(se_width > 0 && se_height > 0);
+        struct rows rows = load_rows(image, pool);
+        dilate_rows(&rows, centered(se_width, se_height, false));
+        store_rows(&rows, image);
+}
+
+/**********Morph_open********
+ *
+ * Opens image (erodes, then dilates) by a rectangular structuring element,
+ * removing black specks smaller than the element
+ * Inputs:
+ *              Bit2_T image: the image to open, changed in place
+ *              int se_width: width of the structuring element
+ *              int se_height: height of the structuring element
+ *              Pool_T pool: where working space is taken from
+ * Return: N/A
+ * Expects:
+ *      image and pool to be nonnull; se_width and se_height to be 
+ *      positive
+ * Notes:
+ *      * Checked runtime error if image or pool is null, the element is 
+ *      empty, or memory cannot be allocated
+ *      * The dilation uses the reflected element, so no white pixel of 
+ *      image turns black
+ *      * Allocates nothing once pool holds arrays large enough for image
+ ************************/
+void Morph_open(Bit2_T image, int se_width, int se_height, Pool_T pool)
+{
+        assert(se_width > 0 && se_height > 0);
+        struct rows rows = load_rows(image, pool);
+        erode_rows(&rows, centered(se_width, se_height, false));
+        dilate_rows(&rows, centered(se_width, se_height, true));
+        store_rows(&rows, image);
+}
+
+/**********Morph_close********
+ *
+ * Closes image (dilates, then erodes) by a rectangular structuring element,
+ * filling white gaps smaller than the element
+ * Inputs:
+ *              Bit2_T image: the image to close, changed in place
+ *              int se_width: width of the structuring element
+ *              int se_height: height of the structuring element
+ *              Pool_T pool: where working space is taken from
+ * Return: N/A
+ * Expects:
+ *      image and pool to be nonnull; se_width and se_height to be 
+ *      positive
+ * Notes:
+ *      * Checked runtime error if image or pool is null, the element is 
+ *      empty, or memory cannot be allocated
+ *      * The erosion uses the reflected element, so every black pixel of
+ *      image stays black
+ *      * Allocates nothing once pool holds arrays large enough for image
+ ************************/
+void Morph_close(Bit2_T image, int se_width, int se_height, Pool_T pool)
+{
+        assert(se_width > 0 && se_height > 0);
+        struct rows rows = load_rows(image, pool);
+        dilate_rows(&rows, centered(se_width, se_height, false));
+        erode_rows(&rows, centered(se_width, se_height, true));
+        store_rows(&rows, image);
+}
+
+/**********load_rows********
+ *
+ * Copies the rows of image into one block of packed words
+ * Inputs:
+ *              Bit2_T image: the image to copy
+ *              Pool_T pool: where the block is taken from
+ * Return: the copied rows
+ * Expects:
+ *      image and pool to be nonnull
+ * Notes:
+ *      The block is taken from pool here and given back by store_rows
+ ************************/
+static struct rows load_rows(Bit2_T image, Pool_T pool)
+{
+        assert(image != NULL && pool != NULL);
+        struct rows rows;
+        rows.width = Bit2_width(image);
+        rows.height = Bit2_height(image);
+        rows.words_per_row = (rows.width + WORD_BITS - 1) / WORD_BITS;
+        rows.pool = pool;
+        rows.words = scratch_words(pool, rows.words_per_row, rows.height, 
+                                                                &rows.block);
+
+        for (int r = 0; r < rows.height; r++) {
+                Bit2_get_row_words(image, r, 
+                        rows.words + (size_t)r * rows.words_per_row);
+        }
+        return rows;
+}
+
+/**********store_rows********
+ *
+ * Copies packed rows back into an image and gives their block back to the
+ * pool
+ * Inputs:
+ *              struct rows *rows: the rows to store
+ *              Bit2_T image: set to the rows
+ * Return: N/A
+ * Expects:
+ *      rows and image to be nonnull; image to be the size of the rows
+ * Notes:
+ *      rows->words must not be used afterwards
+ ************************/
+static void store_rows(struct rows *rows, Bit2_T image)
+{
+        for (int r = 0; r < rows->height; r++) {
+                Bit2_put_row_words(image, r, 
+                        rows->words + (size_t)r * rows->words_per_row);
+        }
+        Pool_put_uarray2(rows->pool, rows->block);
+        rows->words = NULL;
+}
+
+/**********scratch_words********
+ *
+ * Takes count rows of n words of zeros from a pool, as one block
+ * Inputs:
+ *              Pool_T pool: the pool
+ *              int n, int count: the shape of the block
+ *              UArray2_T *block: set to the array holding the words, to be
+ *                                given back with Pool_put_uarray2
+ * Return: the first word of the block
+ * Expects:
+ *      pool and block to be nonnull; n and count to be nonnegative
+ * Notes:
+ *      An empty block still has one word, so the pointer is always valid
+ ************************/
+static uint64_t *scratch_words(Pool_T pool, int n, int count, 
+                                                        UArray2_T *block)
+{
+        bool empty = n == 0 || count == 0;
+        *block = Pool_get_uarray2(pool, empty ? 1 : n, empty ? 1 : count, 
+                                                        sizeof(uint64_t));
+        return UArray2_at(*block, 0, 0);
+}
+
+/**********centered********
+ *
+ * Works out the reach of a structuring element anchored at its center
+ * Inputs:
+ *              int se_width, int se_height: size of the element
+ *              bool reflected: whether to reflect the element through its
+ *                              anchor
+ * Return: how far the element reaches in each direction
+ * Expects:
+ *      se_width and se_height to be positive
+ * Notes:
+ *      Reflection only matters for even sizes, where the anchor is off
+ *      center
+ ************************/
+static struct reach centered(int se_width, int se_height, bool reflected)
+{
+        struct reach reach = { (se_width - 1) / 2, se_width / 2, 
+                               (se_height - 1) / 2, se_height / 2 };
+        if (reflected) {
+                struct reach swapped = { reach.right, reach.left, 
+                                         reach.down, reach.up };
+                return swapped;
+        }
+        return reach;
+}
+
+/**********erode_rows********
+ *
+ * Erodes packed rows in place, as the complement of the dilation of the
+ * complement
+ * Inputs:
+ *              struct rows *rows: the rows to erode
+ *              struct reach reach: the window around each pixel
+ * Return: N/A
+ * Expects:
+ *      rows to be nonnull
+ * Notes:
+ *      Outside the image is white in the complement, which makes it black
+ *      for the erosion
+ ************************/
+static void erode_rows(struct rows *rows, struct reach reach)
+{
+        complement_rows(rows);
+        dilate_rows(rows, reach);
+        complement_rows(rows);
+}
+
+/**********dilate_rows********
+ *
+ * Dilates packed rows in place, one direction at a time
+ * Inputs:
+ *              struct rows *rows: the rows to dilate
+ *              struct reach reach: the window around each pixel
+ * Return: N/A
+ * Expects:
+ *      rows to be nonnull
+ * Notes:
+ *      A rectangle is the product of a row and a column, so dilating by 
+ *      each in turn dilates by the rectangle
+ ************************/
+static void dilate_rows(struct rows *rows, struct reach reach)
+{
+        dilate_horizontal(rows, reach.left, reach.right);
+        dilate_vertical(rows, reach.up, reach.down);
+        clear_padding(rows);
+}
+
+/**********dilate_horizontal********
+ *
+ * ORs every pixel with the pixels up to left columns before it and right
+ * columns after it
+ * Inputs:
+ *              struct rows *rows: the rows to dilate
+ *              int left, int right: the reach of the window
+ * Return: N/A
+ * Expects:
+ *      rows to be nonnull; left and right to be nonnegative
+ * Notes:
+ *      The window is split at its anchor into the part reaching left and
+ *      the part reaching right, each ORed together by or_run. Splitting it 
+ *      there means neither part has to look at columns outside the row
+ ************************/
+static void dilate_horizontal(struct rows *rows, int left, int right)
+{
+        int n = rows->words_per_row;
+        if ((left == 0 && right == 0) || n == 0) {
+                return;
+        }
+
+        UArray2_T block;
+        uint64_t *before = scratch_words(rows->pool, n, 3, &block);
+        uint64_t *after = before + n;
+        uint64_t *shifted = after + n;
+
+        for (int r = 0; r < rows->height; r++) {
+                uint64_t *row = rows->words + (size_t)r * n;
+                memcpy(before, row, n * sizeof(uint64_t));
+                memcpy(after, row, n * sizeof(uint64_t));
+                or_run(before, shifted, n, left, shift_toward_right);
+                or_run(after, shifted, n, right, shift_toward_left);
+                for (int w = 0; w < n; w++) {
+                        row[w] = before[w] | after[w];
+                }
+        }
+        Pool_put_uarray2(rows->pool, block);
+}
+
+/**********or_run********
+ *
+ * ORs every pixel of a packed row with the next reach pixels in one
+ * direction
+ * Inputs:
+ *              uint64_t *row: the row, changed in place
+ *              uint64_t *scratch: n words of working space
+ *              int n: words in the row
+ *              int reach: how many further pixels to OR in
+ *              shift_fn shift: moves a row in the direction to look
+ * Return: N/A
+ * Expects:
+ *      row and scratch to be n words long and not overlap
+ * Notes:
+ *      Works by doubling: after each shift-and-OR every pixel covers twice 
+ *      as many columns, and one last shift tops the count up to reach + 1,
+ *      so it takes about log2(reach) passes rather than reach
+ ************************/
+static void or_run(uint64_t *row, uint64_t *scratch, int n, int reach, 
+                                                        shift_fn shift)
+{
+        int covered = 1;
+        while (covered * 2 <= reach + 1) {
+                shift(row, scratch, n, covered);
+                for (int w = 0; w < n; w++) {
+                        row[w] |= scratch[w];
+                }
+                covered *= 2;
+        }
+        if (covered < reach + 1) {
+                shift(row, scratch, n, reach + 1 - covered);
+                for (int w = 0; w < n; w++) {
+                        row[w] |= scratch[w];
+                }
+        }
+}
+
+/**********dilate_vertical********
+ *
+ * ORs every pixel with the pixels up to up rows above it and down rows below
+ * it, a whole row of words at a time
+ * Inputs:
+ *              struct rows *rows: the rows to dilate
+ *              int up, int down: the reach of the window
+ * Return: N/A
+ * Expects:
+ *      rows to be nonnull; up and down to be nonnegative
+ * Notes:
+ *      * Uses the van Herk/Gil-Werman method. The rows, with up blank rows
+ *      added above and down below, are cut into blocks of k = up + down + 1.
+ *      Within each block, suffix[i] is the OR from row i to the end of its 
+ *      block and prefix[i] the OR from the start of its block to row i. The
+ *      window starting at row i is then suffix[i] | prefix[i + k - 1], 
+ *      three ORs per word whatever the value of k
+ *      * Takes two padded copies of the rows from the pool, given back 
+ *      before returning
+ ************************/
+static void dilate_vertical(struct rows *rows, int up, int down)
+{
+        int k = up + down + 1;
+        int n = rows->words_per_row;
+        if (k == 1 || n == 0 || rows->height == 0) {
+                return;
+        }
+
+        int padded_height = rows->height + k - 1;
+        size_t padded_words = (size_t)padded_height * n;
+        UArray2_T block;
+        uint64_t *prefix = scratch_words(rows->pool, n, 2 * padded_height, 
+                                                                &block);
+        uint64_t *suffix = prefix + padded_words;
+
+        /* padded row i is row i - up of the image */
+        for (int r = 0; r < rows->height; r++) {
+                memcpy(prefix + (size_t)(r + up) * n, 
+                       rows->words + (size_t)r * n, n * sizeof(uint64_t));
+        }
+        memcpy(suffix, prefix, padded_words * sizeof(uint64_t));
+
+        for (int i = 0; i < padded_height; i++) {
+                if (i % k != 0) {
+                        uint64_t *row = prefix + (size_t)i * n;
+                        for (int w = 0; w < n; w++) {
+                                row[w] |= row[w - n];
+                        }
+                }
+        }
+        for (int i = padded_height - 2; i >= 0; i--) {
+                if ((i + 1) % k != 0) {
+                        uint64_t *row = suffix + (size_t)i * n;
+                        for (int w = 0; w < n; w++) {
+                                row[w] |= row[w + n];
+                        }
+                }
+        }
+
+        /* the window of image row r is padded rows r .. r + k - 1 */
+        for (int r = 0; r < rows->height; r++) {
+                uint64_t *out = rows->words + (size_t)r * n;
+                uint64_t *from = suffix + (size_t)r * n;
+                uint64_t *to = prefix + (size_t)(r + k - 1) * n;
+                for (int w = 0; w < n; w++) {
+                        out[w] = from[w] | to[w];
+                }
+        }
+        Pool_put_uarray2(rows->pool, block);
+}
+
+/**********shift_toward_left********
+ *
+ * Moves the bits of a packed row shift columns toward column 0, so that
+ * dest at col is src at col + shift
+ * Inputs:
+ *              const uint64_t *src: the row to shift
+ *              uint64_t *dest: set to the shifted row (not src)
+ *              int n: words in the row
+ *              int shift: how many columns to move, zero or more
+ * Return: N/A
+ * Expects:
+ *      src and dest to be n words long and not overlap
+ * Notes:
+ *      Columns shifted in past the end of the row are zero
+ ************************/
+static void shift_toward_left(const uint64_t *src, uint64_t *dest, int n, 
+                                                                int shift)
+{
+        int words = shift / WORD_BITS;
+        int bits = shift % WORD_BITS;
+
+        for (int w = 0; w < n; w++) {
+                int from = w + words;
+                uint64_t low = from < n ? src[from] : 0;
+                uint64_t high = from + 1 < n ? src[from + 1] : 0;
+                dest[w] = bits == 0 ? low 
+                        : (low >> bits) | (high << (WORD_BITS - bits));
+        }
+}
+
+/**********shift_toward_right********
+ *
+ * Moves the bits of a packed row shift columns away from column 0, so that
+ * dest at col is src at col - shift
+ * Inputs:
+ *              const uint64_t *src: the row to shift
+ *              uint64_t *dest: set to the shifted row (not src)
+ *              int n: words in the row
+ *              int shift: how many columns to move, zero or more
+ * Return: N/A
+ * Expects:
+ *      src and dest to be n words long and not overlap
+ * Notes:
+ *      Columns shifted in before column 0 are zero
+ ************************/
+static void shift_toward_right(const uint64_t *src, uint64_t *dest, int n, 
+                                                                int shift)
+{
+        int words = shift / WORD_BITS;
+        int bits = shift % WORD_BITS;
+
+        for (int w = 0; w < n; w++) {
+                int from = w - words;
+                uint64_t high = from >= 0 ? src[from] : 0;
+                uint64_t low = from - 1 >= 0 ? src[from - 1] : 0;
+                dest[w] = bits == 0 ? high 
+                        : (high << bits) | (low >> (WORD_BITS - bits));
+        }
+}
+
+/**********complement_rows********
+ *
+ * Flips every pixel of packed rows, leaving the padding bits zero
+ * Inputs:
+ *              struct rows *rows: the rows to flip
+ * Return: N/A
+ * Expects:
+ *      rows to be nonnull
+ * Notes:
+ *      None
+ ************************/
+static void complement_rows(struct rows *rows)
+{
+        size_t num_words = (size_t)rows->words_per_row * rows->height;
+        for (size_t i = 0; i < num_words; i++) {
+                rows->words[i] = ~rows->words[i];
+        }
+        clear_padding(rows);
+}
+
+/**********clear_padding********
+ *
+ * Zeroes the bits past the width in the last word of every row
+ * Inputs:
+ *              struct rows *rows: the rows to tidy
+ * Return: N/A
+ * Expects:
+ *      rows to be nonnull
+ * Notes:
+ *      Keeps bits from past the edge out of later shifts
+ ************************/
+static void clear_padding(struct rows *rows)
+{
+        int n = rows->words_per_row;
+        int tail_bits = rows->width - (n - 1) * WORD_BITS;
+        if (n == 0 || tail_bits == WORD_BITS) {
+                return;
+        }
+
+        uint64_t mask = ((uint64_t)1 << tail_bits) - 1;
+        for (int r = 0; r < rows->height; r++) {
+                rows->words[(size_t)r * n + n - 1] &= mask;
+        }
+}
@@ -0,0 +1,26 @@
+/*
+ *     morph.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for binary morphology (erode, dilate, open, close)
+ *              on 2D Bit Arrays with rectangular structuring elements,
+ *              in place, with working space from a pool
+ */
+
+#ifndef MORPH_INCLUDED
+#define MORPH_INCLUDED
+
+#include "bit2.h"
+#include "pool.h"
+
+extern void Morph_erode(Bit2_T image, int se_width, int se_height, 
+                                                        Pool_T pool);
+extern void Morph_dilate(Bit2_T image, int se_width, int se_height, 
+                                                        Pool_T pool);
+extern void Morph_open(Bit2_T image, int se_width, int se_height, 
+                                                        Pool_T pool);
+extern void Morph_close(Bit2_T image, int se_width, int se_height, 
+                                                        Pool_T pool);
+
+#endif
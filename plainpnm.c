@@ -0,0 +1,606 @@
+/*
+ *     plainpnm.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of parallel decoding of plain pnm rasters.
+ *              The text is cut into one chunk per thread at line breaks, 
+ *              so that no sample or comment is split. A first parallel 
+ *              pass counts the samples in each chunk; a running sum of the
+ *              counts gives the index of the first sample of every chunk,
+ *              and a second parallel pass decodes each chunk into its place.
+ *              Packed bits are decoded a band of whole rows per thread
+ *              instead, each band starting on a multiple of BAND_ROWS rows
+ *              near where its thread's chunk starts, and each thread hands
+ *              its own rows to the client.
+ *
+ *              The text may go on past the raster into further images. A
+ *              'P' outside a comment can only be the start of the next 
+ *              image, so counting stops there, and chunks past it are 
+ *              dropped.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <pnmrdr.h>
+
+#include "plainpnm.h"
+
+#define WORD_BITS 64
+
+/* Rows of packed bits are handed out in bands of whole multiples of this */
+#define BAND_ROWS 64
+
+/* One thread's part of the raster and where its samples go */
+struct chunk {
+        Plainpnm_raster *raster;
+        const char *start;
+        const char *end;
+        size_t first;           /* index of the chunk's first sample */
+        size_t count;           /* samples in the chunk, from counting */
+        bool bad_format;        /* set when the chunk is not a raster */
+        bool next_image;        /* set when the chunk runs into one */
+        const char *stop;       /* just past the raster's last sample */
+
+        /* for decoding samples: where they go, one per pixel */
+        uint16_t *samples;
+
+        /* for decoding bits: the band of rows, and where they go */
+        unsigned first_row;
+        unsigned end_row;       /* just past the band's last row */
+        unsigned threshold;     /* gray samples below this are black */
+        void (*put_row)(unsigned row, const uint64_t *words, void *cl);
+        void *cl;
+};
+
+static struct chunk *make_chunks(Plainpnm_raster *raster, int *num_chunks);
+static void run_chunks(struct chunk *chunks, int num_chunks, 
+                                                void *(*pass)(void *));
+static void band_chunks(struct chunk *chunks, int num_chunks);
+static size_t finish_chunks(struct chunk *chunks, int num_chunks);
+static void *count_chunk(void *cl);
+static void *decode_chunk(void *cl);
+static void *decode_band(void *cl);
+static const char *next_sample(struct chunk *chunk, const char *p, 
+                                                        unsigned *value);
+static const char *skip_blanks(const char *p, const char *end);
+
+/**********Plainpnm_header********
+ *
+ * Finds where the raster of a plain pnm starts
+ * Inputs:
+ *              const char *text: the pnm, from the start of its header
+ *              size_t length: the bytes of text there are
+ * Return: the offset of the raster in text, just past the header's last 
+ *         number; or 0 if text does not start with a whole plain (P1 or P2)
+ *         header
+ * Expects:
+ *      text to be nonnull
+ * Notes:
+ *      * The header is read from text alone, so the offset does not depend
+ *      on how far a reader of the same bytes has got
+ *      * Only the layout is checked: the numbers are left to Pnmrdr
+ ************************/
+size_t Plainpnm_header(const char *text, size_t length)
+{
+        if (length < 2 || text[0] != 'P' || 
+                                (text[1] != '1' && text[1] != '2')) {
+                return 0;
+        }
+        int fields = text[1] == '1' ? 2 : 3;    /* P2 has a maxval too */
+
+        const char *end = text + length;
+        const char *p = text + 2;
+        for (int i = 0; i < fields; i++) {
+                p = skip_blanks(p, end);
+                if (p == end || isdigit((unsigned char)*p) == 0) {
+                        return 0;
+                }
+                while (p < end && isdigit((unsigned char)*p)) {
+                        p++;
+                }
+        }
+        return p - text;
+}
+
+/**********Plainpnm_bits********
+ *
+ * Decodes a plain raster into packed rows of black pixels, handing each row
+ * to the client from the thread that decoded it
+ * Inputs:
+ *              Plainpnm_raster raster: the raster to decode
+ *              unsigned threshold: for a P2 raster, the level below which a
+ *                                  pixel is black (ignored for P1, where 1 
+ *                                  is black)
+ *              int num_threads: how many threads to decode on
+ *              void put_row(unsigned row, const uint64_t *words, void *cl):
+ *                      given each row, as (width + 63) / 64 words with 
+ *                      column col in bit (col % 64) of word (col / 64), as 
+ *                      taken by Bit2_put_row_words. words is only good for
+ *                      the call
+ *              void *cl: passed to put_row
+ *              size_t *used: set to how much of the text the raster took up,
+ *                            up to the end of its last sample
+ * Return: N/A
+ * Expects:
+ *      raster.text, put_row and used to be nonnull; num_threads to be 
+ *      positive
+ * Notes:
+ *      * Raises Pnmrdr_Badformat if the raster holds anything but samples,
+ *      whitespace and comments, and Pnmrdr_Count if it holds fewer than
+ *      width x height samples before the text or the next image ends; 
+ *      put_row is not called then
+ *      * Each thread decodes a band of whole rows, starting on a multiple
+ *      of BAND_ROWS, and calls put_row for its rows in order. put_row is 
+ *      called from several threads at once, but rows in the same band of
+ *      BAND_ROWS (row / BAND_ROWS the same) always come from one thread.
+ *      A client that stores rows in fresh memory thus has each band first
+ *      touched by the thread that decoded it
+ *      * Checked runtime error if memory cannot be allocated or a thread 
+ *      cannot be started
+ ************************/
+void Plainpnm_bits(Plainpnm_raster raster, unsigned threshold, 
+                   int num_threads, void put_row(unsigned row, 
+                   const uint64_t *words, void *cl), void *cl, size_t *used)
+{
+        assert(num_threads > 0 && put_row != NULL);
+        int num_chunks = num_threads;
+        struct chunk *chunks = make_chunks(&raster, &num_chunks);
+        for (int i = 0; i < num_chunks; i++) {
+                chunks[i].threshold = threshold;
+                chunks[i].put_row = put_row;
+                chunks[i].cl = cl;
+        }
+        band_chunks(chunks, num_chunks);
+        run_chunks(chunks, num_chunks, decode_band);
+        *used = finish_chunks(chunks, num_chunks);
+}
+
+/**********Plainpnm_samples********
+ *
+ * Decodes a plain raster into one sample per pixel
+ * Inputs:
+ *              Plainpnm_raster raster: the raster to decode
+ *              int num_threads: how many threads to decode on
+ *              size_t *used: set as by Plainpnm_bits
+ * Return: width x height samples, in row-major order
+ * Expects:
+ *      raster.text and used to be nonnull; num_threads to be positive
+ * Notes:
+ *      * Raises Pnmrdr_Badformat and Pnmrdr_Count as Plainpnm_bits does,
+ *      and Pnmrdr_Badformat for a sample over 65535
+ *      * Checked runtime error if memory cannot be allocated or a thread 
+ *      cannot be started
+ *      * The client must free the samples
+ ************************/
+uint16_t *Plainpnm_samples(Plainpnm_raster raster, int num_threads, 
+                                                        size_t *used)
+{
+        assert(num_threads > 0);
+        size_t num_samples = (size_t)raster.width * raster.height;
+        uint16_t *samples = malloc((num_samples > 0 ? num_samples : 1) * 
+                                                        sizeof(uint16_t));
+        assert(samples != NULL);
+
+        int num_chunks = num_threads;
+        struct chunk *chunks = make_chunks(&raster, &num_chunks);
+        for (int i = 0; i < num_chunks; i++) {
+                chunks[i].samples = samples;
+        }
+        run_chunks(chunks, num_chunks, decode_chunk);
+        *used = finish_chunks(chunks, num_chunks);
+        return samples;
+}
+
+/**********make_chunks********
+ *
+ * Cuts a raster into chunks and works out where each one's samples start
+ * Inputs:
+ *              Plainpnm_raster *raster: the raster to cut
+ *              int *num_chunks: the number of chunks wanted. Set to the 
+ *                               number made, which is smaller when there 
+ *                               are too few line breaks to go round
+ * Return: the chunks, counted, with no output set
+ * Expects:
+ *      raster and num_chunks to be nonnull; *num_chunks to be positive
+ * Notes:
+ *      * Every chunk but the last ends just after a line break. Comments
+ *      run to the end of their line, so none is ever split
+ *      * Chunks after the first to reach the next image are dropped 
+ *      without looking at what they found, which is not this raster
+ *      * Raises Pnmrdr_Badformat if a kept chunk is badly formatted and
+ *      Pnmrdr_Count if there are too few samples
+ *      * The client must free the chunks
+ ************************/
+static struct chunk *make_chunks(Plainpnm_raster *raster, int *num_chunks)
+{
+        int wanted = *num_chunks;
+        struct chunk *chunks = calloc(wanted, sizeof(struct chunk));
+        assert(chunks != NULL);
+
+        const char *text = raster->text;
+        const char *end = text + raster->length;
+        const char *start = text;
+        int made = 0;
+        for (int i = 0; i < wanted && start < end; i++) {
+                const char *cut = end;
+                if (i + 1 < wanted) {
+                        cut = text + raster->length / wanted * (i + 1);
+                        if (cut < start) {
+                                cut = start;
+                        }
+                        const char *newline = memchr(cut, '\n', end - cut);
+                        cut = newline != NULL ? newline + 1 : end;
+                }
+
+                chunks[made].raster = raster;
+                chunks[made].start = start;
+                chunks[made].end = cut;
+                made++;
+                start = cut;
+        }
+        if (made == 0) {
+                /* an empty raster still gets a chunk, to report the count */
+                chunks[0].raster = raster;
+                chunks[0].start = chunks[0].end = end;
+                made = 1;
+        }
+        run_chunks(chunks, made, count_chunk);
+
+        for (int i = 0; i < made; i++) {
+                if (chunks[i].next_image) {
+                        made = i + 1;
+                        break;
+                }
+        }
+        *num_chunks = made;
+
+        size_t first = 0;
+        for (int i = 0; i < made; i++) {
+                chunks[i].first = first;
+                first += chunks[i].count;
+        }
+        bool bad_format = false;
+        for (int i = 0; i < made; i++) {
+                bad_format = bad_format || chunks[i].bad_format;
+        }
+        if (bad_format) {
+                free(chunks);
+                RAISE(Pnmrdr_Badformat);
+        }
+        if (first < (size_t)raster->width * raster->height) {
+                free(chunks);
+                RAISE(Pnmrdr_Count);
+        }
+        return chunks;
+}
+
+/**********run_chunks********
+ *
+ * Runs one pass over every chunk, each on its own thread
+ * Inputs:
+ *              struct chunk *chunks: the chunks
+ *              int num_chunks: how many there are
+ *              void *(*pass)(void *): the pass, given one struct chunk
+ * Return: N/A
+ * Expects:
+ *      chunks to be nonnull
+ * Notes:
+ *      * The first chunk runs on the calling thread
+ *      * The threads only flag errors in their chunks, since the exception
+ *      stack belongs to the calling thread; the client raises them
+ *      * Checked runtime error if a thread cannot be started
+ ************************/
+static void run_chunks(struct chunk *chunks, int num_chunks, 
+                                                void *(*pass)(void *))
+{
+        pthread_t *threads = malloc(num_chunks * sizeof(pthread_t));
+        assert(threads != NULL);
+        for (int i = 1; i < num_chunks; i++) {
+                int started = pthread_create(&threads[i], NULL, pass, 
+                                                                &chunks[i]);
+                assert(started == 0);
+        }
+        pass(&chunks[0]);
+        for (int i = 1; i < num_chunks; i++) {
+                pthread_join(threads[i], NULL);
+        }
+        free(threads);
+}
+
+/**********band_chunks********
+ *
+ * Gives each counted chunk the band of whole rows its thread decodes, and
+ * where in the text to start looking for it
+ * Inputs:
+ *              struct chunk *chunks: the chunks, counted
+ *              int num_chunks: how many there are
+ * Return: N/A
+ * Expects:
+ *      chunks to be nonnull
+ * Notes:
+ *      * Chunk i's band starts at the first row that starts in chunk i,
+ *      rounded up to a multiple of BAND_ROWS, and runs to where chunk 
+ *      i + 1's band starts; the last runs to the bottom of the raster. A
+ *      band can be empty, when a chunk holds less than BAND_ROWS rows
+ *      * Each chunk's start and first are moved to those of the chunk 
+ *      holding its band's first sample, which is chunk i or a later one,
+ *      and its end to the end of the last chunk, as a band can run on into
+ *      the chunks after it. Its thread skips at most a band's worth of 
+ *      samples to reach the band
+ ************************/
+static void band_chunks(struct chunk *chunks, int num_chunks)
+{
+        Plainpnm_raster *raster = chunks[0].raster;
+        size_t width = raster->width;
+        const char *end = chunks[num_chunks - 1].end;
+
+        for (int i = 0; i < num_chunks; i++) {
+                size_t row = 0;
+                if (i > 0 && width > 0) {
+                        row = (chunks[i].first + width - 1) / width;
+                        row = (row + BAND_ROWS - 1) / BAND_ROWS * BAND_ROWS;
+                }
+                if (row > raster->height) {
+                        row = raster->height;
+                }
+                chunks[i].first_row = row;
+                if (i > 0) {
+                        chunks[i - 1].end_row = row;
+                }
+
+                /* later chunks are untouched yet, so j's fields still hold */
+                int j = i;
+                while (j + 1 < num_chunks && 
+                       chunks[j + 1].first <= row * width) {
+                        j++;
+                }
+                chunks[i].start = chunks[j].start;
+                chunks[i].first = chunks[j].first;
+                chunks[i].end = end;
+        }
+        chunks[num_chunks - 1].end_row = raster->height;
+}
+
+/**********finish_chunks********
+ *
+ * Frees decoded chunks, finding where their raster ended
+ * Inputs:
+ *              struct chunk *chunks: the chunks
+ *              int num_chunks: how many there are
+ * Return: how much of the text the raster took up
+ * Expects:
+ *      chunks to be nonnull and decoded
+ * Notes:
+ *      None
+ ************************/
+static size_t finish_chunks(struct chunk *chunks, int num_chunks)
+{
+        size_t used = 0;
+        for (int i = 0; i < num_chunks; i++) {
+                if (chunks[i].stop != NULL) {
+                        used = chunks[i].stop - chunks[i].raster->text;
+                }
+        }
+        free(chunks);
+        return used;
+}
+
+/**********count_chunk********
+ *
+ * Thread that counts the samples in one chunk
+ * Inputs:
+ *              void *cl: the struct chunk to count
+ * Return: NULL
+ * Expects:
+ *      cl to be nonnull
+ * Notes:
+ *      Sets the count, bad_format and next_image fields of the chunk
+ ************************/
+static void *count_chunk(void *cl)
+{
+        struct chunk *chunk = cl;
+        const char *p = chunk->start;
+        size_t count = 0;
+        unsigned value;
+
+        for (;;) {
+                p = next_sample(chunk, p, &value);
+                if (p == NULL) {
+                        break;
+                }
+                count++;
+        }
+        chunk->count = count;
+        return NULL;
+}
+
+/**********decode_chunk********
+ *
+ * Thread that decodes the samples of one chunk into their places
+ * Inputs:
+ *              void *cl: the struct chunk to decode, already counted
+ * Return: NULL
+ * Expects:
+ *      cl to be nonnull, with samples set
+ * Notes:
+ *      * Each sample has its own element, so samples are stored directly
+ *      * The chunk holding the raster's last sample sets its stop field
+ ************************/
+static void *decode_chunk(void *cl)
+{
+        struct chunk *chunk = cl;
+        Plainpnm_raster *raster = chunk->raster;
+        size_t num_samples = (size_t)raster->width * raster->height;
+        if (chunk->first >= num_samples) {
+                return NULL;
+        }
+        size_t last = chunk->first + chunk->count;
+        if (last > num_samples) {
+                last = num_samples;
+        }
+
+        const char *p = chunk->start;
+        unsigned value;
+        for (size_t i = chunk->first; i < last; i++) {
+                p = next_sample(chunk, p, &value);
+                assert(p != NULL);
+                chunk->samples[i] = value;
+        }
+        if (last == num_samples) {
+                chunk->stop = p;
+        }
+        return NULL;
+}
+
+/**********decode_band********
+ *
+ * Thread that decodes one chunk's band of rows into packed bits and hands
+ * them to the client
+ * Inputs:
+ *              void *cl: the struct chunk, given its band by band_chunks
+ * Return: NULL
+ * Expects:
+ *      cl to be nonnull
+ * Notes:
+ *      * Samples before the band are skipped, and the band is read on 
+ *      past the end of the chunk when it needs to be; every sample up to 
+ *      the raster's last was found when the chunks were counted
+ *      * A row is built up in words of the thread's own and handed over 
+ *      whole, so no two threads share a word
+ *      * The chunk whose band holds the raster's last row sets its stop 
+ *      field
+ *      * Checked runtime error if memory cannot be allocated
+ ************************/
+static void *decode_band(void *cl)
+{
+        struct chunk *chunk = cl;
+        Plainpnm_raster *raster = chunk->raster;
+        if (chunk->first_row == chunk->end_row) {
+                return NULL;
+        }
+
+        size_t width = raster->width;
+        const char *p = chunk->start;
+        unsigned value;
+        for (size_t i = chunk->first; i < chunk->first_row * width; i++) {
+                p = next_sample(chunk, p, &value);
+                assert(p != NULL);
+        }
+
+        size_t words_per_row = (width + WORD_BITS - 1) / WORD_BITS;
+        uint64_t *words = malloc((words_per_row > 0 ? words_per_row : 1) * 
+                                                        sizeof(uint64_t));
+        assert(words != NULL);
+        for (unsigned row = chunk->first_row; row < chunk->end_row; row++) {
+                for (size_t w = 0; w < words_per_row; w++) {
+                        uint64_t word = 0;
+                        size_t end = (w + 1) * WORD_BITS < width 
+                                        ? (w + 1) * WORD_BITS : width;
+                        for (size_t col = w * WORD_BITS; col < end; col++) {
+                                p = next_sample(chunk, p, &value);
+                                assert(p != NULL);
+                                bool black = raster->gray 
+                                                ? value < chunk->threshold
+                                                : value == 1;
+                                word |= (uint64_t)black << (col % WORD_BITS);
+                        }
+                        words[w] = word;
+                }
+                chunk->put_row(row, words, chunk->cl);
+        }
+        free(words);
+
+        if (chunk->end_row == raster->height) {
+                chunk->stop = p;
+        }
+        return NULL;
+}
+
+/**********next_sample********
+ *
+ * Finds the next sample of a chunk, skipping whitespace and comments
+ * Inputs:
+ *              struct chunk *chunk: the chunk being read
+ *              const char *p: where in the chunk to start looking
+ *              unsigned *value: set to the sample found
+ * Return: just past the sample, or NULL if there is none before the end of
+ *         the chunk
+ * Expects:
+ *      chunk, p and value to be nonnull
+ * Notes:
+ *      * Sets bad_format in the chunk if something other than a sample, 
+ *      whitespace or comment is found, and next_image if a 'P' is
+ *      * P1 bits need not be separated, so each 0 or 1 is a sample of its 
+ *      own
+ ************************/
+static const char *next_sample(struct chunk *chunk, const char *p, 
+                                                        unsigned *value)
+{
+        const char *end = chunk->end;
+        p = skip_blanks(p, end);
+        if (p == end) {
+                return NULL;
+        }
+        if (*p == 'P') {
+                chunk->next_image = true;
+                return NULL;
+        }
+
+        if (chunk->raster->gray == false) {
+                if (*p != '0' && *p != '1') {
+                        chunk->bad_format = true;
+                        return NULL;
+                }
+                *value = *p - '0';
+                return p + 1;
+        }
+
+        if (isdigit((unsigned char)*p) == 0) {
+                chunk->bad_format = true;
+                return NULL;
+        }
+        unsigned long sample = 0;
+        while (p < end && isdigit((unsigned char)*p)) {
+                sample = sample * 10 + (*p - '0');
+                if (sample > UINT16_MAX) {
+                        chunk->bad_format = true;
+                        return NULL;
+                }
+                p++;
+        }
+        *value = sample;
+        return p;
+}
+
+/**********skip_blanks********
+ *
+ * Skips whitespace and comments
+ * Inputs:
+ *              const char *p: where to start
+ *              const char *end: where the text ends
+ * Return: the first byte that is neither whitespace nor in a comment, or 
+ *         end
+ * Expects:
+ *      p and end to be nonnull, with p <= end
+ * Notes:
+ *      A comment runs from '#' to the end of its line
+ ************************/
+static const char *skip_blanks(const char *p, const char *end)
+{
+        while (p < end) {
+                if (*p == '#') {
+                        while (p < end && *p != '\n') {
+                                p++;
+                        }
+                } else if (isspace((unsigned char)*p)) {
+                        p++;
+                } else {
+                        break;
+                }
+        }
+        return p;
+}
@@ -0,0 +1,36 @@
+/*
+ *     plainpnm.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for finding and decoding the raster of a plain 
+ *              (P1 or P2) pnm that is already in memory, on several threads
+ *              at once
+ */
+
+#ifndef PLAINPNM_INCLUDED
+#define PLAINPNM_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* A plain raster of width x height samples held in memory */
+typedef struct Plainpnm_raster {
+        const char *text;       /* the raster, after the header */
+        size_t length;          /* to the end of the input, which may hold
+                                   more images after this one */
+        unsigned width;
+        unsigned height;
+        bool gray;              /* P2 samples rather than P1 bits */
+} Plainpnm_raster;
+
+extern size_t Plainpnm_header(const char *text, size_t length);
+extern void Plainpnm_bits(Plainpnm_raster raster, unsigned threshold, 
+                          int num_threads, void put_row(unsigned row, 
+                          const uint64_t *words, void *cl), void *cl, 
+                          size_t *used);
+extern uint16_t *Plainpnm_samples(Plainpnm_raster raster, int num_threads, 
+                                                        size_t *used);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ *     pool.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of pools of Bit2 and UArray2 arrays
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "pool.h"
+#include "stack.h"
+
+#define T Pool_T
+
+/*
+ * The arrays given back and not yet handed out again, one stack of each 
+ * kind. The last one given back is the first handed out: it is the likeliest
+ * to still be in the cache, and a client that gets and puts its arrays in 
+ * the same order every time gets the same array for the same use, which 
+ * has already grown to fit it
+ */
+struct T {
+        Stack_T bit2s;
+        Stack_T uarray2s;
+        Bigmem_policy policy;   /* for the arrays the pool makes */
+};
+
+/**********Pool_new********
+ *
+ * Creates an empty pool
+ * Inputs:
+ *              Bigmem_policy policy: how the storage of the arrays the pool
+ *                                    makes is allocated
+ * Return: A new pool holding no arrays
+ * Expects:
+ *      None
+ * Notes:
+ *      * Checked runtime error if memory cannot be allocated
+ *      * The client must use Pool_free once the pool is no longer needed
+ *      * A pool is not safe to use from two threads at once
+ ************************/
+T Pool_new(Bigmem_policy policy)
+{
+        T pool = malloc(sizeof(*pool));
+        assert(pool != NULL);
+
+        pool->bit2s = Stack_new();
+        pool->uarray2s = Stack_new();
+        pool->policy = policy;
+        return pool;
+}
+
+/**********Pool_free********
+ *
+ * Deallocates *pool, and every array that was given back to it, and sets 
+ * *pool to NULL
+ * Inputs:
+ *              T *pool: pointer to the pool to free
+ * Return: N/A
+ * Expects:
+ *      pool and *pool to be nonnull
+ * Notes:
+ *      * Checked runtime error if pool or *pool is null
+ *      * Arrays still handed out are not freed; the client frees them with 
+ *      Bit2_free or UArray2_free
+ ************************/
+void Pool_free(T *pool)
+{
+        assert(pool != NULL && *pool != NULL);
+        while (Stack_empty((*pool)->bit2s) != 1) {
+                Bit2_T bit2_array = Stack_pop((*pool)->bit2s);
+                Bit2_free(&bit2_array);
+        }
+        while (Stack_empty((*pool)->uarray2s) != 1) {
+                UArray2_T uarray2 = Stack_pop((*pool)->uarray2s);
+                UArray2_free(&uarray2);
+        }
+        Stack_free(&(*pool)->bit2s);
+        Stack_free(&(*pool)->uarray2s);
+        free(*pool);
+        *pool = NULL;
+}
+
+/**********Pool_get_bit2********
+ *
+ * Hands out a width x height bit2 array with every bit zero
+ * Inputs:
+ *              T pool: the pool
+ *              int width, int height: the size wanted
+ * Return: the last array given back to the pool, resized, or a new one if
+ *         the pool has none
+ * Expects:
+ *      pool to be nonnull; width and height to be nonnegative
+ * Notes:
+ *      * Checked runtime error if pool is null, width or height is negative,
+ *      or memory cannot be allocated
+ *      * Bit2_resize clears the array with one memset, and only reallocates
+ *      it when it has never been this large
+ *      * The client gives the array back with Pool_put_bit2
+ ************************/
+Bit2_T Pool_get_bit2(T pool, int width, int height)
+{
+        assert(pool != NULL);
+        if (Stack_empty(pool->bit2s) == 1) {
+                return Bit2_new_policy(width, height, pool->policy);
+        }
+        Bit2_T bit2_array = Stack_pop(pool->bit2s);
+        Bit2_resize(bit2_array, width, height);
+        return bit2_array;
+}
+
+/**********Pool_put_bit2********
+ *
+ * Gives a bit2 array back to the pool, to be handed out again
+ * Inputs:
+ *              T pool: the pool
+ *              Bit2_T bit2_array: the array, from Pool_get_bit2 or Bit2_new
+ * Return: N/A
+ * Expects:
+ *      pool and bit2_array to be nonnull
+ * Notes:
+ *      * Checked runtime error if pool or bit2_array is null
+ *      * The client must not use the array, or views of it, afterwards
+ ************************/
+void Pool_put_bit2(T pool, Bit2_T bit2_array)
+{
+        assert(pool != NULL && bit2_array != NULL);
+        Stack_push(pool->bit2s, bit2_array);
+}
+
+/**********Pool_get_uarray2********
+ *
+ * Hands out a width x height array of elements of size bytes, with every 
+ * byte zero
+ * Inputs:
+ *              T pool: the pool
+ *              int width, int height: the size wanted
+ *              int size: the number of bytes in each element
+ * Return: the last array given back to the pool, reshaped, or a new one if
+ *         the pool has none
+ * Expects:
+ *      pool to be nonnull; width and height to be nonnegative; size to be
+ *      positive
+ * Notes:
+ *      * As for Pool_get_bit2, with UArray2_resize doing the reshaping
+ *      * Arrays of any element size share the pool, since a reshape only 
+ *      needs enough bytes
+ ************************/
+UArray2_T Pool_get_uarray2(T pool, int width, int height, int size)
+{
+        assert(pool != NULL);
+        if (Stack_empty(pool->uarray2s) == 1) {
+                return UArray2_new_policy(width, height, size, pool->policy);
+        }
+        UArray2_T uarray2 = Stack_pop(pool->uarray2s);
+        UArray2_resize(uarray2, width, height, size);
+        return uarray2;
+}
+
+/**********Pool_put_uarray2********
+ *
+ * Gives an array back to the pool, to be handed out again
+ * Inputs:
+ *              T pool: the pool
+ *              UArray2_T uarray2: the array, from Pool_get_uarray2 or 
+ *                                 UArray2_new
+ * Return: N/A
+ * Expects:
+ *      pool and uarray2 to be nonnull
+ * Notes:
+ *      * Checked runtime error if pool or uarray2 is null
+ *      * The client must not use the array, or views of it, afterwards
+ ************************/
+void Pool_put_uarray2(T pool, UArray2_T uarray2)
+{
+        assert(pool != NULL && uarray2 != NULL);
+        Stack_push(pool->uarray2s, uarray2);
+}
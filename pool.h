@@ -0,0 +1,30 @@
+/*
+ *     pool.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for a pool of Bit2 and UArray2 arrays that are 
+ *              handed out, given back and handed out again, reshaped in 
+ *              place, so a long run stops allocating once it has seen its
+ *              largest arrays
+ */
+
+#ifndef POOL_INCLUDED
+#define POOL_INCLUDED
+
+#include "bit2.h"
+#include "uarray2.h"
+#include "bigmem.h"
+
+#define T Pool_T
+typedef struct T *T;
+
+extern T Pool_new(Bigmem_policy policy);
+extern void Pool_free(T *pool);
+extern Bit2_T Pool_get_bit2(T pool, int width, int height);
+extern void Pool_put_bit2(T pool, Bit2_T bit2_array);
+extern UArray2_T Pool_get_uarray2(T pool, int width, int height, int size);
+extern void Pool_put_uarray2(T pool, UArray2_T uarray2);
+
+#undef T
+#endif
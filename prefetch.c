@@ -0,0 +1,713 @@
+/*
+ *     prefetch.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of reading files ahead. When built with
+ *              -DPREFETCH_URING and linked with -luring, each file is 
+ *              opened, sized, read and closed by requests to an io_uring,
+ *              which the kernel carries out while the client works; no 
+ *              threads are used, and the client's thread makes no calls 
+ *              on the files itself. Otherwise, or when the kernel cannot
+ *              open and size files through a ring (before Linux 5.6), a 
+ *              pool of threads reads the files with pread.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#ifdef PREFETCH_URING
+#include <liburing.h>
+#endif
+
+#include "prefetch.h"
+
+#define T Prefetch_T
+
+#define READ_CHUNK (64 * 1024)
+
+/* 
+ * The longest single io_uring read: its length is an unsigned, and Linux 
+ * reads at most a little under 2 GiB in one go anyway
+ */
+#define URING_READ_MAX (1u << 30)
+
+/*
+ * The kinds of io_uring request made for a file. A request's user data is 
+ * URING_KINDS * slot index + kind + 1, so 0 is left for cancels
+ */
+enum { URING_OPEN, URING_SIZE, URING_READ, URING_CLOSE, URING_KINDS };
+#define URING_CANCEL 0
+
+/* One file being read, and how far its read has got */
+struct slot {
+        char *bytes;
+        size_t length;          /* bytes read so far */
+        size_t capacity;        /* bytes allocated */
+        int fd;                 /* with io_uring, while the file is open */
+        enum { EMPTY, READING, READY, FAILED } state;
+#ifdef PREFETCH_URING
+        struct statx size;      /* where the file's statx lands */
+        unsigned requests;      /* bit k set while a request of kind k is
+                                   in flight */
+#endif
+};
+
+/*
+ * File i is read into slot i % depth. A file is only started once the file
+ * depth places before it has been handed out, so at most depth files are
+ * held at once. started counts the files whose reads have begun and
+ * handed_out the files given to the client.
+ *
+ * With threads, each thread claims the next file to start, reads it and
+ * marks its slot READY, taking lock to touch started, handed_out or a
+ * state. With io_uring the client's thread does it all: Prefetch_new and
+ * Prefetch_next submit an open and a statx of each file that may be 
+ * started, and Prefetch_next takes completions, submitting each file's 
+ * reads once it is open and sized, until the file it wants is READY. 
+ * stopping is set while Prefetch_free cancels the requests.
+ */
+struct T {
+        const char **paths;
+        int num_paths;
+        int depth;
+        struct slot *slots;
+        int started;
+        int handed_out;
+
+        pthread_t *threads;     /* depth threads, or NULL with io_uring */
+        pthread_mutex_t lock;
+        pthread_cond_t changed;
+        bool stopping;
+#ifdef PREFETCH_URING
+        struct io_uring ring;
+#endif
+};
+
+static void *read_files(void *cl);
+static bool read_file(const char *path, struct slot *slot);
+static int open_sized(const char *path, struct slot *slot);
+static void size_buffer(struct slot *slot, size_t size);
+static void grow(struct slot *slot);
+#ifdef PREFETCH_URING
+static bool uring_supported(struct io_uring *ring);
+static void uring_start(T prefetch);
+static bool uring_step(T prefetch);
+static void uring_read(T prefetch, struct slot *slot);
+static void uring_close(T prefetch, struct slot *slot);
+static void uring_tag(T prefetch, struct io_uring_sqe *sqe, 
+                      struct slot *slot, int kind);
+static uint64_t uring_data(T prefetch, struct slot *slot, int kind);
+static void uring_cancel(T prefetch);
+#endif
+
+/**********Prefetch_new********
+ *
+ * Starts reading a list of files, up to depth of them ahead of the client
+ * Inputs:
+ *              const char **paths: the files, in the order they are wanted
+ *              int num_paths: the number of files
+ *              int depth: the most files to read, or hold read, at once
+ * Return: a new prefetch, whose first reads are already under way
+ * Expects:
+ *      paths to be nonnull and to outlive the prefetch; num_paths to be
+ *      nonnegative; depth to be positive
+ * Notes:
+ *      * Checked runtime error if memory cannot be allocated or a thread
+ *      cannot be started
+ *      * With PREFETCH_URING, threads are only used if io_uring_queue_init
+ *      fails, as it does on kernels older than 5.1 or where io_uring is
+ *      turned off, or if the ring cannot open, statx, read and close files
+ *      (kernels older than 5.6)
+ *      * The client must use Prefetch_free once done
+ ************************/
+T Prefetch_new(const char **paths, int num_paths, int depth)
+{
+        assert(paths != NULL && num_paths >= 0 && depth > 0);
+        T prefetch = malloc(sizeof(*prefetch));
+        assert(prefetch != NULL);
+
+        prefetch->paths = paths;
+        prefetch->num_paths = num_paths;
+        prefetch->depth = depth < num_paths ? depth :
+                                              (num_paths > 0 ? num_paths : 1);
+        prefetch->slots = calloc(prefetch->depth, sizeof(struct slot));
+        assert(prefetch->slots != NULL);
+        prefetch->started = 0;
+        prefetch->handed_out = 0;
+        prefetch->threads = NULL;
+        prefetch->stopping = false;
+        pthread_mutex_init(&prefetch->lock, NULL);
+        pthread_cond_init(&prefetch->changed, NULL);
+
+#ifdef PREFETCH_URING
+        if (io_uring_queue_init(URING_KINDS * prefetch->depth, 
+                                &prefetch->ring, 0) == 0) {
+                if (uring_supported(&prefetch->ring)) {
+                        uring_start(prefetch);
+                        return prefetch;
+                }
+                io_uring_queue_exit(&prefetch->ring);
+        }
+#endif
+        prefetch->threads = malloc(prefetch->depth * sizeof(pthread_t));
+        assert(prefetch->threads != NULL);
+        for (int i = 0; i < prefetch->depth; i++) {
+                int started = pthread_create(&prefetch->threads[i], NULL,
+                                             read_files, prefetch);
+                assert(started == 0);
+        }
+        return prefetch;
+}
+
+/**********Prefetch_free********
+ *
+ * Stops reading ahead, deallocates *prefetch and sets it to NULL
+ * Inputs:
+ *              T *prefetch: pointer to the prefetch to free
+ * Return: N/A
+ * Expects:
+ *      prefetch and *prefetch to be nonnull
+ * Notes:
+ *      * Checked runtime error if prefetch or *prefetch is null
+ *      * Files read but never handed out are dropped. Reads under way are
+ *      cancelled, and waited for, so no read lands in freed memory
+ *      * Files already handed out are the client's, and are not freed
+ ************************/
+void Prefetch_free(T *prefetch)
+{
+        assert(prefetch != NULL && *prefetch != NULL);
+        T p = *prefetch;
+
+        if (p->threads != NULL) {
+                pthread_mutex_lock(&p->lock);
+                p->stopping = true;
+                pthread_cond_broadcast(&p->changed);
+                pthread_mutex_unlock(&p->lock);
+                for (int i = 0; i < p->depth; i++) {
+                        pthread_join(p->threads[i], NULL);
+                }
+                free(p->threads);
+        }
+#ifdef PREFETCH_URING
+        else {
+                uring_cancel(p);
+                io_uring_queue_exit(&p->ring);
+        }
+#endif
+
+        for (int i = 0; i < p->depth; i++) {
+                free(p->slots[i].bytes);
+        }
+        free(p->slots);
+        pthread_mutex_destroy(&p->lock);
+        pthread_cond_destroy(&p->changed);
+        free(p);
+        *prefetch = NULL;
+}
+
+/**********Prefetch_next********
+ *
+ * Hands over the next file, whole, waiting for its read to finish
+ * Inputs:
+ *              T prefetch: the prefetch
+ *              Prefetch_file *file: set to the next file
+ * Return: true if there was a next file, false once every file has been
+ *         handed out
+ * Expects:
+ *      prefetch and file to be nonnull
+ * Notes:
+ *      * Checked runtime error if the file cannot be opened or read
+ *      * Handing a file over frees its slot, so the read of the file depth
+ *      places after it starts straight away. With io_uring, the open and
+ *      statx of that file are submitted here, along with the reads of any
+ *      files whose open and statx have completed since the last call
+ *      * file->bytes is the client's to free, and is not NUL terminated
+ ************************/
+bool Prefetch_next(T prefetch, Prefetch_file *file)
+{
+        assert(prefetch != NULL && file != NULL);
+        if (prefetch->handed_out == prefetch->num_paths) {
+                return false;
+        }
+
+        int index = prefetch->handed_out;
+        struct slot *slot = &prefetch->slots[index % prefetch->depth];
+        pthread_mutex_lock(&prefetch->lock);
+#ifdef PREFETCH_URING
+        while (prefetch->threads == NULL && slot->state != READY &&
+                                            slot->state != FAILED) {
+                uring_step(prefetch);
+        }
+#endif
+        while (slot->state != READY && slot->state != FAILED) {
+                pthread_cond_wait(&prefetch->changed, &prefetch->lock);
+        }
+        assert(slot->state == READY);
+
+        file->path = prefetch->paths[index];
+        file->bytes = slot->bytes;
+        file->length = slot->length;
+        slot->bytes = NULL;
+        slot->length = 0;
+        slot->capacity = 0;
+        slot->state = EMPTY;
+        prefetch->handed_out++;
+        pthread_cond_broadcast(&prefetch->changed);
+        pthread_mutex_unlock(&prefetch->lock);
+
+#ifdef PREFETCH_URING
+        if (prefetch->threads == NULL) {
+                uring_start(prefetch);
+        }
+#endif
+        return true;
+}
+
+/**********read_files********
+ *
+ * Thread that reads files into their slots, one after another, until
+ * every file has been started or the prefetch is freed
+ * Inputs:
+ *              void *cl: the prefetch
+ * Return: NULL
+ * Expects:
+ *      cl to be nonnull
+ * Notes:
+ *      Waits whenever the next file's slot still holds a file the client
+ *      has not taken
+ ************************/
+static void *read_files(void *cl)
+{
+        T prefetch = cl;
+        pthread_mutex_lock(&prefetch->lock);
+        for (;;) {
+                while (!prefetch->stopping &&
+                       prefetch->started < prefetch->num_paths &&
+                       prefetch->started == prefetch->handed_out +
+                                                        prefetch->depth) {
+                        pthread_cond_wait(&prefetch->changed,
+                                                        &prefetch->lock);
+                }
+                if (prefetch->stopping ||
+                    prefetch->started == prefetch->num_paths) {
+                        break;
+                }
+
+                int index = prefetch->started++;
+                struct slot *slot = &prefetch->slots[index % prefetch->depth];
+                slot->state = READING;
+                pthread_mutex_unlock(&prefetch->lock);
+
+                bool read = read_file(prefetch->paths[index], slot);
+
+                pthread_mutex_lock(&prefetch->lock);
+                slot->state = read ? READY : FAILED;
+                pthread_cond_broadcast(&prefetch->changed);
+        }
+        pthread_mutex_unlock(&prefetch->lock);
+        return NULL;
+}
+
+/**********read_file********
+ *
+ * Reads a whole file into a slot with pread
+ * Inputs:
+ *              const char *path: the file
+ *              struct slot *slot: an EMPTY slot, set to the contents
+ * Return: true if the file was read, false if it could not be opened or
+ *         read
+ * Expects:
+ *      path and slot to be nonnull
+ * Notes:
+ *      * The buffer is sized by open_sized, and grown if the file turns out
+ *      longer
+ *      * A file that cannot be seeked, such as a pipe, fails
+ ************************/
+static bool read_file(const char *path, struct slot *slot)
+{
+        int fd = open_sized(path, slot);
+        if (fd < 0) {
+                return false;
+        }
+
+        for (;;) {
+                if (slot->length == slot->capacity) {
+                        grow(slot);
+                }
+                ssize_t got = pread(fd, slot->bytes + slot->length,
+                                    slot->capacity - slot->length,
+                                    slot->length);
+                if (got < 0 && errno == EINTR) {
+                        continue;
+                }
+                if (got <= 0) {
+                        close(fd);
+                        return got == 0;
+                }
+                slot->length += got;
+        }
+}
+
+/**********open_sized********
+ *
+ * Opens a file and gives its slot a buffer of the file's size
+ * Inputs:
+ *              const char *path: the file
+ *              struct slot *slot: an EMPTY slot, given the buffer
+ * Return: the open file, or -1 if it could not be opened
+ * Expects:
+ *      path and slot to be nonnull
+ * Notes:
+ *      * A file fstat cannot size, or an empty one, gets no buffer
+ *      * Checked runtime error if memory cannot be allocated
+ ************************/
+static int open_sized(const char *path, struct slot *slot)
+{
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+                return -1;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                size_buffer(slot, info.st_size);
+        }
+        return fd;
+}
+
+/**********size_buffer********
+ *
+ * Gives a slot a buffer for a file of a known size
+ * Inputs:
+ *              struct slot *slot: an EMPTY or READING slot with no buffer
+ *              size_t size: the size of the file, over 0
+ * Return: N/A
+ * Expects:
+ *      slot to be nonnull
+ * Notes:
+ *      * The buffer is one byte over size, so the read that finds the end
+ *      of the file needs no more room
+ *      * Checked runtime error if memory cannot be allocated
+ ************************/
+static void size_buffer(struct slot *slot, size_t size)
+{
+        slot->capacity = size + 1;
+        slot->bytes = malloc(slot->capacity);
+        assert(slot->bytes != NULL);
+}
+
+/**********grow********
+ *
+ * Makes room for more of a file in its slot
+ * Inputs:
+ *              struct slot *slot: the slot, with length == capacity
+ * Return: N/A
+ * Expects:
+ *      slot to be nonnull
+ * Notes:
+ *      Checked runtime error if memory cannot be allocated
+ ************************/
+static void grow(struct slot *slot)
+{
+        slot->capacity = slot->capacity > 0 ? 2 * slot->capacity
+                                            : READ_CHUNK;
+        slot->bytes = realloc(slot->bytes, slot->capacity);
+        assert(slot->bytes != NULL);
+}
+
+#ifdef PREFETCH_URING
+/**********uring_supported********
+ *
+ * Checks that a ring can carry out every kind of request made of it
+ * Inputs:
+ *              struct io_uring *ring: a new ring
+ * Return: true if the kernel can open, statx, read and close files
+ *         through ring, false if not
+ * Expects:
+ *      ring to be nonnull
+ * Notes:
+ *      Kernels older than 5.6 cannot, nor can they be asked
+ ************************/
+static bool uring_supported(struct io_uring *ring)
+{
+        struct io_uring_probe *probe = io_uring_get_probe_ring(ring);
+        if (probe == NULL) {
+                return false;
+        }
+        bool supported = io_uring_opcode_supported(probe, IORING_OP_OPENAT) &&
+                         io_uring_opcode_supported(probe, IORING_OP_STATX) &&
+                         io_uring_opcode_supported(probe, IORING_OP_READ) &&
+                         io_uring_opcode_supported(probe, IORING_OP_CLOSE);
+        io_uring_free_probe(probe);
+        return supported;
+}
+
+/**********uring_start********
+ *
+ * Submits the reads of files that are now open and sized, then an open
+ * and a statx of every file whose slot is free
+ * Inputs:
+ *              T prefetch: a prefetch using io_uring
+ * Return: N/A
+ * Expects:
+ *      prefetch to be nonnull
+ * Notes:
+ *      * Only completions already in are taken; this does not wait
+ *      * The open and the statx go by path, side by side, so a file's
+ *      metadata costs one round trip to its filesystem, taken by the
+ *      kernel while the client works. Sizing the file lets a read made as
+ *      long as the file fetch it, up to URING_READ_MAX bytes, then one
+ *      more find its end
+ *      * Each slot has at most one request of each kind in flight, so the
+ *      ring, made with URING_KINDS * depth entries, never runs out of them
+ ************************/
+static void uring_start(T prefetch)
+{
+        while (io_uring_cq_ready(&prefetch->ring) > 0) {
+                uring_step(prefetch);
+        }
+
+        while (prefetch->started < prefetch->num_paths &&
+               prefetch->started < prefetch->handed_out + prefetch->depth) {
+                int index = prefetch->started++;
+                struct slot *slot = &prefetch->slots[index % prefetch->depth];
+                const char *path = prefetch->paths[index];
+                slot->fd = -1;
+                slot->size.stx_size = 0;
+                slot->state = READING;
+
+                struct io_uring_sqe *sqe = io_uring_get_sqe(&prefetch->ring);
+                assert(sqe != NULL);
+                io_uring_prep_openat(sqe, AT_FDCWD, path, O_RDONLY, 0);
+                uring_tag(prefetch, sqe, slot, URING_OPEN);
+                sqe = io_uring_get_sqe(&prefetch->ring);
+                assert(sqe != NULL);
+                io_uring_prep_statx(sqe, AT_FDCWD, path, 0, STATX_SIZE,
+                                    &slot->size);
+                uring_tag(prefetch, sqe, slot, URING_SIZE);
+        }
+        io_uring_submit(&prefetch->ring);
+}
+
+/**********uring_step********
+ *
+ * Waits for one request or cancel to complete, and carries its file on
+ * Inputs:
+ *              T prefetch: a prefetch using io_uring
+ * Return: true if a request completed, false if a cancel did
+ * Expects:
+ *      prefetch to be nonnull, with a request or cancel in flight
+ * Notes:
+ *      * Once both the open and the statx of a file are in, its buffer is
+ *      sized and its first read submitted. A file that could not be
+ *      opened is FAILED; one that could not be sized is read all the same,
+ *      its buffer grown as it goes
+ *      * As with pread, only a read that comes back empty ends the file.
+ *      Any other read is followed by one of the rest of the buffer, which
+ *      is grown first if the file has grown since it was sized. Files of
+ *      over URING_READ_MAX bytes, or ones the kernel reads short, take
+ *      several reads this way
+ *      * A file is READY, or FAILED, as soon as its reads end; its close
+ *      is left in flight
+ *      * Once prefetch->stopping is set no more requests are submitted,
+ *      and every file whose request completes is marked FAILED
+ *      * Checked runtime error if waiting fails
+ ************************/
+static bool uring_step(T prefetch)
+{
+        struct io_uring_cqe *cqe = NULL;
+        int waited = io_uring_wait_cqe(&prefetch->ring, &cqe);
+        assert(waited == 0);
+        uint64_t data = io_uring_cqe_get_data64(cqe);
+        int result = cqe->res;
+        io_uring_cqe_seen(&prefetch->ring, cqe);
+
+        if (data == URING_CANCEL) {
+                return false;
+        }
+        struct slot *slot = &prefetch->slots[(data - 1) / URING_KINDS];
+        int kind = (data - 1) % URING_KINDS;
+        slot->requests &= ~(1u << kind);
+        if (kind == URING_OPEN && result >= 0) {
+                slot->fd = result;
+        }
+        if (kind == URING_READ && result > 0) {
+                slot->length += result;
+        }
+        if (kind == URING_CLOSE ||
+            (slot->requests & ~(1u << URING_CLOSE)) != 0) {
+                return true;
+        }
+
+        bool reading = kind != URING_READ || result > 0;
+        if (reading && slot->fd >= 0 && !prefetch->stopping) {
+                if (kind != URING_READ && slot->size.stx_size > 0) {
+                        size_buffer(slot, slot->size.stx_size);
+                }
+                uring_read(prefetch, slot);
+                io_uring_submit(&prefetch->ring);
+                return true;
+        }
+
+        slot->state = kind == URING_READ && result == 0 &&
+                      !prefetch->stopping ? READY : FAILED;
+        uring_close(prefetch, slot);
+        return true;
+}
+
+/**********uring_read********
+ *
+ * Prepares the read of the rest of a file, up to the end of its buffer or
+ * URING_READ_MAX bytes, whichever is less
+ * Inputs:
+ *              T prefetch: a prefetch using io_uring
+ *              struct slot *slot: a READING slot whose file is open
+ * Return: N/A
+ * Expects:
+ *      prefetch and slot to be nonnull
+ * Notes:
+ *      * The buffer is grown first if it is full
+ *      * The client submits it
+ ************************/
+static void uring_read(T prefetch, struct slot *slot)
+{
+        if (slot->length == slot->capacity) {
+                grow(slot);
+        }
+        size_t length = slot->capacity - slot->length;
+        if (length > URING_READ_MAX) {
+                length = URING_READ_MAX;
+        }
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&prefetch->ring);
+        assert(sqe != NULL);
+        io_uring_prep_read(sqe, slot->fd, slot->bytes + slot->length,
+                           length, slot->length);
+        uring_tag(prefetch, sqe, slot, URING_READ);
+}
+
+/**********uring_close********
+ *
+ * Closes a slot's file, if it was opened
+ * Inputs:
+ *              T prefetch: a prefetch using io_uring
+ *              struct slot *slot: a slot whose reads have ended
+ * Return: N/A
+ * Expects:
+ *      prefetch and slot to be nonnull
+ * Notes:
+ *      * The close is a request like the others, submitted here and not
+ *      waited for; the slot may take its next file meanwhile
+ *      * Once prefetch->stopping is set the file is closed with close(2)
+ *      instead, as no more requests may be submitted
+ ************************/
+static void uring_close(T prefetch, struct slot *slot)
+{
+        if (slot->fd < 0) {
+                return;
+        }
+        if (prefetch->stopping) {
+                close(slot->fd);
+        } else {
+                struct io_uring_sqe *sqe = io_uring_get_sqe(&prefetch->ring);
+                assert(sqe != NULL);
+                io_uring_prep_close(sqe, slot->fd);
+                uring_tag(prefetch, sqe, slot, URING_CLOSE);
+                io_uring_submit(&prefetch->ring);
+        }
+        slot->fd = -1;
+}
+
+/**********uring_tag********
+ *
+ * Marks a prepared submission entry as a request about a slot's file
+ * Inputs:
+ *              T prefetch: a prefetch using io_uring
+ *              struct io_uring_sqe *sqe: the entry, already prepared
+ *              struct slot *slot: the slot
+ *              int kind: URING_OPEN, URING_SIZE, URING_READ or URING_CLOSE
+ * Return: N/A
+ * Expects:
+ *      prefetch, sqe and slot to be nonnull, with no request of kind in 
+ *      flight for slot
+ * Notes:
+ *      The request is in flight for slot from here on
+ ************************/
+static void uring_tag(T prefetch, struct io_uring_sqe *sqe, 
+                      struct slot *slot, int kind)
+{
+        io_uring_sqe_set_data64(sqe, uring_data(prefetch, slot, kind));
+        slot->requests |= 1u << kind;
+}
+
+/**********uring_data********
+ *
+ * Gives the user data of a request about a slot's file
+ * Inputs:
+ *              T prefetch: a prefetch using io_uring
+ *              struct slot *slot: the slot
+ *              int kind: URING_OPEN, URING_SIZE, URING_READ or URING_CLOSE
+ * Return: URING_KINDS * the slot's index + kind + 1, never URING_CANCEL
+ * Expects:
+ *      prefetch and slot to be nonnull
+ * Notes:
+ *      uring_step takes the slot and kind back out of it
+ ************************/
+static uint64_t uring_data(T prefetch, struct slot *slot, int kind)
+{
+        return (uint64_t)(slot - prefetch->slots) * URING_KINDS + kind + 1;
+}
+
+/**********uring_cancel********
+ *
+ * Cancels every request in flight and waits for them all to finish
+ * Inputs:
+ *              T prefetch: a prefetch using io_uring
+ * Return: N/A
+ * Expects:
+ *      prefetch to be nonnull
+ * Notes:
+ *      * A request may complete before its cancel reaches it; it is then
+ *      dropped like a cancelled one. Either way each request and each
+ *      cancel completes once, which the ring's 2 * URING_KINDS * depth
+ *      completion entries hold
+ *      * Leaves no slot READING, and no file open
+ ************************/
+static void uring_cancel(T prefetch)
+{
+        prefetch->stopping = true;
+        int requests = 0;
+        for (int i = 0; i < prefetch->depth; i++) {
+                struct slot *slot = &prefetch->slots[i];
+                for (int kind = 0; kind < URING_KINDS; kind++) {
+                        if ((slot->requests & (1u << kind)) == 0) {
+                                continue;
+                        }
+                        struct io_uring_sqe *sqe =
+                                        io_uring_get_sqe(&prefetch->ring);
+                        assert(sqe != NULL);
+                        io_uring_prep_cancel64(sqe, uring_data(prefetch, slot,
+                                                               kind), 0);
+                        io_uring_sqe_set_data64(sqe, URING_CANCEL);
+                        requests++;
+                }
+        }
+        io_uring_submit(&prefetch->ring);
+
+        int cancels = requests;
+        while (requests > 0 || cancels > 0) {
+                if (uring_step(prefetch)) {
+                        requests--;
+                } else {
+                        cancels--;
+                }
+        }
+}
+#endif
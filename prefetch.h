@@ -0,0 +1,33 @@
+/*
+ *     prefetch.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for reading a list of files ahead of their use.
+ *              Reads of the next few files are in flight while the client
+ *              works on the current one, and each file is handed over
+ *              whole, in memory, in the order the files were listed
+ */
+
+#ifndef PREFETCH_INCLUDED
+#define PREFETCH_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define T Prefetch_T
+typedef struct T *T;
+
+/* One file, read whole */
+typedef struct Prefetch_file {
+        const char *path;
+        char *bytes;            /* the contents; the client frees them */
+        size_t length;
+} Prefetch_file;
+
+extern T Prefetch_new(const char **paths, int num_paths, int depth);
+extern void Prefetch_free(T *prefetch);
+extern bool Prefetch_next(T prefetch, Prefetch_file *file);
+
+#undef T
+#endif
@@ -0,0 +1,140 @@
+#!/bin/sh
+#
+#     prefetch_test.sh
+#     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+#     HW2: Interfaces, Implementations and Images (iii)
+#
+#     Summary: Checks reading files ahead with both backends. Builds
+#              sudoku and unblackedges twice in scratch copies of this
+#              directory, once with the thread pool and once with io_uring
+#              (make URING=1), and runs each over many files kept on tmpfs:
+#                - unblackedges given every image at once must print what
+#                  it prints given them one at a time
+#                - sudoku must pass a list of solved grids, and fail one
+#                  whose first grid is not solved, which frees the prefetch
+#                  while the reads of the rest are in flight
+#              The io_uring half fails if it does not build (no liburing)
+#              or if io_uring is turned off on this machine, as the build
+#              would then quietly fall back to the thread pool.
+#
+#     Usage: ./prefetch_test.sh [-t] [make variables]
+#              -t checks the thread pool alone, on a machine that cannot
+#              run the io_uring half; the run says it was left out. The 
+#              variables are passed to make, e.g. IFLAGS=... to find the 
+#              course headers elsewhere. Exits with 0 if every check 
+#              passes.
+#
+
+set -u
+
+backends="threads uring"
+if [ "${1:-}" = -t ]; then
+        backends=threads
+        shift
+        echo "NOTE: -t given, the io_uring backend is not checked"
+fi
+
+here=$(cd "$(dirname "$0")" && pwd)
+shm=/dev/shm
+[ -d "$shm" ] && [ -w "$shm" ] || shm=${TMPDIR:-/tmp}
+work=$(mktemp -d "$shm/prefetch_test.XXXXXX") || exit 1
+trap 'rm -rf "$work"' EXIT
+
+failures=0
+fail() {
+        echo "FAIL: $*"
+        failures=$((failures + 1))
+}
+
+# A plain pbm of the given width and height, black edges and specks
+make_pbm() {
+        awk -v w="$1" -v h="$2" -v seed="$3" 'BEGIN {
+                srand(seed)
+                print "P1"; print w, h
+                for (r = 0; r < h; r++) {
+                        line = ""
+                        for (c = 0; c < w; c++) {
+                                edge = r < 2 || c < 3 || r == h - 1
+                                line = line ((edge || rand() < 0.3) ? 1 : 0)
+                                line = line (c % 35 == 34 ? "\n" : " ")
+                        }
+                        print line
+                }
+        }'
+}
+
+# A plain pgm of a sudoku grid; solved unless the second argument is 1
+make_pgm() {
+        awk -v shift_="$1" -v broken="$2" 'BEGIN {
+                print "P2"; print "9 9"; print "9"
+                for (r = 0; r < 9; r++) {
+                        line = ""
+                        for (c = 0; c < 9; c++) {
+                                d = (3 * (r % 3) + int(r / 3) + c + shift_) % 9
+                                if (broken && r == 4 && c == 4) {
+                                        d = (d + 1) % 9
+                                }
+                                line = line (d + 1) " "
+                        }
+                        print line
+                }
+        }'
+}
+
+mkdir "$work/in"
+images=""
+i=0
+for size in 40x30 700x500 64x64 1200x900 9x9 300x2000 17x3 800x800; do
+        make_pbm "${size%x*}" "${size#*x}" "$i" > "$work/in/page$i.pbm"
+        images="$images $work/in/page$i.pbm"
+        i=$((i + 1))
+done
+grids=""
+for i in $(seq 0 39); do
+        make_pgm "$i" 0 > "$work/in/grid$i.pgm"
+        grids="$grids $work/in/grid$i.pgm"
+done
+make_pgm 0 1 > "$work/in/broken.pgm"
+
+for backend in $backends; do
+        build="$work/$backend"
+        mkdir "$build"
+        cp "$here"/*.c "$here"/*.h "$here"/Makefile "$build"
+        flags=""
+        if [ "$backend" = uring ]; then
+                flags="URING=1"
+                disabled=$(cat /proc/sys/kernel/io_uring_disabled \
+                                                        2>/dev/null || echo 0)
+                if [ "$disabled" != 0 ]; then
+                        fail "uring: io_uring is turned off here (use -t)"
+                        continue
+                fi
+        fi
+        if ! make -s -C "$build" $flags "$@" sudoku unblackedges \
+                                        > "$build/make.log" 2>&1; then
+                cat "$build/make.log"
+                fail "$backend: build (without liburing, use -t)"
+                continue
+        fi
+
+        for depth in 1 3 8; do
+                for image in $images; do
+                        "$build/unblackedges" "$image"
+                done > "$work/one_by_one" 2>&1
+                "$build/unblackedges" -a "$depth" $images \
+                                        > "$work/all_at_once" 2>&1 ||
+                        fail "$backend: unblackedges -a $depth exit status"
+                cmp -s "$work/one_by_one" "$work/all_at_once" ||
+                        fail "$backend: unblackedges -a $depth output"
+
+                "$build/sudoku" -a "$depth" $grids ||
+                        fail "$backend: sudoku -a $depth on solved grids"
+                "$build/sudoku" -a "$depth" "$work/in/broken.pgm" $grids
+                [ $? -eq 1 ] ||
+                        fail "$backend: sudoku -a $depth on a broken grid"
+        done
+        echo "$backend: done"
+done
+
+[ "$failures" -eq 0 ] && echo "all prefetch checks passed"
+[ "$failures" -eq 0 ]
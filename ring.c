@@ -0,0 +1,127 @@
+/*
+ *     ring.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of a lock-free single-producer, single-consumer
+ *              ring buffer of row blocks
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <assert.h>
+#include <sched.h>
+
+#include "ring.h"
+
+#define T Ring_T
+
+/*
+ * head counts the blocks ever put and is only written by the producer; tail
+ * counts the blocks ever taken and is only written by the consumer. Slot 
+ * i % capacity holds block i. The release store of head publishes both the
+ * block and everything the producer wrote to the image before putting it.
+ */
+struct T {
+        Ring_block *slots;
+        unsigned capacity;
+        unsigned head;
+        unsigned tail;
+};
+
+/**********Ring_new********
+ *
+ * Creates an empty ring with room for capacity blocks
+ * Inputs:
+ *              int capacity: the most blocks the ring holds at once
+ * Return: A new, empty ring
+ * Expects:
+ *      capacity to be positive
+ * Notes:
+ *      * Checked runtime error if capacity is not positive or memory cannot
+ *      be allocated
+ *      * The client must use Ring_free once the ring is no longer needed
+ ************************/
+T Ring_new(int capacity)
+{
+        assert(capacity > 0);
+        T ring = malloc(sizeof(*ring));
+        assert(ring != NULL);
+
+        ring->slots = malloc(capacity * sizeof(Ring_block));
+        assert(ring->slots != NULL);
+        ring->capacity = capacity;
+        ring->head = 0;
+        ring->tail = 0;
+        return ring;
+}
+
+/**********Ring_free********
+ *
+ * Deallocates *ring and sets it to NULL
+ * Inputs:
+ *              T *ring: A pointer to the ring to be freed
+ * Return: N/A
+ * Expects:
+ *      ring and *ring to be nonnull, and neither thread to be using it
+ * Notes:
+ *      Checked runtime error if ring or *ring is null
+ ************************/
+void Ring_free(T *ring)
+{
+        assert(ring != NULL && *ring != NULL);
+        free((*ring)->slots);
+        free(*ring);
+        *ring = NULL;
+}
+
+/**********Ring_put********
+ *
+ * Adds a block to the ring, waiting for room if the ring is full
+ * Inputs:
+ *              T ring: the ring to add to
+ *              Ring_block block: the block to add
+ * Return: N/A
+ * Expects:
+ *      ring to be nonnull, and only one thread to put blocks
+ * Notes:
+ *      Yields the processor while the ring is full rather than taking a lock
+ ************************/
+void Ring_put(T ring, Ring_block block)
+{
+        assert(ring != NULL);
+        unsigned head = ring->head;
+
+        while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == 
+                                                        ring->capacity) {
+                sched_yield();
+        }
+        ring->slots[head % ring->capacity] = block;
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**********Ring_get********
+ *
+ * Removes the oldest block from the ring, waiting for one if it is empty
+ * Inputs:
+ *              T ring: the ring to take from
+ * Return: the oldest block in the ring
+ * Expects:
+ *      ring to be nonnull, and only one thread to get blocks
+ * Notes:
+ *      Yields the processor while the ring is empty rather than taking a 
+ *      lock
+ ************************/
+Ring_block Ring_get(T ring)
+{
+        assert(ring != NULL);
+        unsigned tail = ring->tail;
+
+        while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+                sched_yield();
+        }
+        Ring_block block = ring->slots[tail % ring->capacity];
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        return block;
+}
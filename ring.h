@@ -0,0 +1,28 @@
+/*
+ *     ring.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for a lock-free single-producer, single-consumer
+ *              ring buffer of row blocks, used to hand parts of an image
+ *              from one thread to the next without copying them
+ */
+
+#ifndef RING_INCLUDED
+#define RING_INCLUDED
+#define T Ring_T
+typedef struct T *T;
+
+/* Rows [first_row, first_row + num_rows) of an image shared by the threads */
+typedef struct Ring_block {
+        int first_row;
+        int num_rows;
+} Ring_block;
+
+extern T Ring_new(int capacity);
+extern void Ring_free(T *ring);
+extern void Ring_put(T ring, Ring_block block);
+extern Ring_block Ring_get(T ring);
+
+#undef T
+#endif
@@ -0,0 +1,647 @@
+/*
+ *     server.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of a pre-forked Unix domain socket server.
+ *              The parent binds the socket and forks a pool of workers that
+ *              each accept connections on it, so every worker keeps its own
+ *              buffers warm from one request to the next. A worker that 
+ *              dies (for example on a badly formatted image) is replaced.
+ *              Served a line at a time, each worker instead runs an epoll 
+ *              loop over every connection it has accepted, so the number
+ *              of connections open at once is not bound by the pool.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include "server.h"
+
+#define BACKLOG SOMAXCONN
+#define MAX_EVENTS 256
+#define BUFFER_SIZE (2 * SERVER_LINE_MAX)
+
+/* What the workers serve: whole connections, or connections line by line */
+struct service {
+        Server_handler *handle;         /* for Server_run, else NULL */
+        Server_lines lines;             /* for Server_run_lines */
+        void *cl;
+};
+
+/* The epoll loop of a worker serving lines */
+struct loop {
+        int epoll_fd;
+        int listen_fd;
+        bool accepting;         /* listen_fd is in the epoll set */
+        const struct service *service;
+};
+
+/* A connection served a line at a time */
+struct connection {
+        int fd;
+        bool ending;            /* to be closed once out is written */
+        bool writing;           /* waiting for room to write out */
+        short in_length;        /* bytes of in not yet answered */
+        short out_length;       /* bytes of out not yet written */
+        void *state;            /* from lines.start */
+        char in[BUFFER_SIZE];
+        char out[BUFFER_SIZE];
+};
+
+static volatile sig_atomic_t stopping = 0;
+
+static void serve(const char *socket_path, int num_workers, 
+                  const struct service *service);
+static int open_socket(const char *socket_path);
+static pid_t start_worker(int listen_fd, const struct service *service);
+static void worker_loop(int listen_fd, Server_handler handle, void *cl);
+static void line_loop(int listen_fd, const struct service *service);
+static void accept_lines(struct loop *loop);
+static void serve_lines(struct loop *loop, struct connection *conn);
+static void answer_lines(struct loop *loop, struct connection *conn, 
+                         bool at_end);
+static bool write_answers(struct connection *conn);
+static void watch(struct loop *loop, struct connection *conn, bool writing);
+static void close_connection(struct loop *loop, struct connection *conn);
+static void stop(int signal_number);
+
+/**********Server_run********
+ *
+ * Listens on a Unix domain socket and serves connections with a pool of
+ * worker processes until the server is sent SIGINT or SIGTERM
+ * Inputs:
+ *              const char *socket_path: path of the socket to listen on.
+ *                                       Anything already at the path is 
+ *                                       removed first
+ *              int num_workers: number of worker processes in the pool
+ *              Server_handler handle: called by a worker once for every
+ *                                     connection it accepts
+ *              void *cl: closure passed to handle. Each worker gets its own
+ *                        copy of whatever cl points to
+ * Return: N/A
+ * Expects:
+ *      * socket_path to be nonnull and short enough for a sockaddr_un
+ *      * num_workers to be positive
+ * Notes:
+ *      * Checked runtime error if the socket cannot be created, bound or
+ *      listened on, or if a worker cannot be forked
+ *      * Workers that exit are replaced, so a request that makes the 
+ *      handler exit only costs the client its connection
+ *      * A worker serves one connection at a time, so at most num_workers
+ *      are served at once and the rest wait to be accepted
+ *      * On return the workers have been stopped and the socket removed
+ ************************/
+void Server_run(const char *socket_path, int num_workers, 
+                                        Server_handler handle, void *cl)
+{
+        assert(handle != NULL);
+        struct service service = { handle, { NULL, NULL, NULL }, cl };
+        serve(socket_path, num_workers, &service);
+}
+
+/**********Server_run_lines********
+ *
+ * Listens on a Unix domain socket and serves connections a line at a time
+ * with a pool of worker processes, until the server is sent SIGINT or 
+ * SIGTERM
+ * Inputs:
+ *              const char *socket_path: path of the socket to listen on.
+ *                                       Anything already at the path is 
+ *                                       removed first
+ *              int num_workers: number of worker processes in the pool
+ *              Server_lines lines: how a worker starts, answers and ends
+ *                                  each connection it accepts
+ *              void *cl: closure passed to lines. Each worker gets its own
+ *                        copy of whatever cl points to
+ * Return: N/A
+ * Expects:
+ *      * socket_path to be nonnull and short enough for a sockaddr_un
+ *      * num_workers to be positive
+ *      * lines.start, lines.answer and lines.end to be nonnull
+ * Notes:
+ *      * Checked runtime error as for Server_run
+ *      * Each worker serves every connection it has accepted from one 
+ *      epoll loop, so a connection holds a struct connection and its 
+ *      state, not a worker. How many can be open at once is bound by
+ *      memory and the open file limit, which each worker raises to its
+ *      hard limit
+ *      * A connection ends when the client closes it, sends a line of
+ *      SERVER_LINE_MAX bytes or more, or has a line answered with -1.
+ *      Answers already made are written first. A last line with no 
+ *      newline is answered as if it had one
+ *      * A worker reads no more of a connection while the client leaves
+ *      its answers unread, so a client cannot make it buffer without end
+ *      * A worker that exits is replaced, but takes all its connections 
+ *      with it
+ *      * On return the workers have been stopped and the socket removed
+ ************************/
+void Server_run_lines(const char *socket_path, int num_workers,
+                      Server_lines lines, void *cl)
+{
+        assert(lines.start != NULL && lines.answer != NULL && 
+               lines.end != NULL);
+        struct service service = { NULL, lines, cl };
+        serve(socket_path, num_workers, &service);
+}
+
+/**********serve********
+ *
+ * Runs the pool of workers for Server_run or Server_run_lines
+ * Inputs:
+ *              const char *socket_path: path of the socket to listen on
+ *              int num_workers: number of worker processes in the pool
+ *              const struct service *service: what the workers serve
+ * Return: N/A
+ * Expects:
+ *      * socket_path and service to be nonnull
+ *      * num_workers to be positive
+ * Notes:
+ *      As for Server_run
+ ************************/
+static void serve(const char *socket_path, int num_workers, 
+                  const struct service *service)
+{
+        assert(socket_path != NULL);
+        assert(num_workers > 0);
+
+        int listen_fd = open_socket(socket_path);
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = stop;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+
+        pid_t *workers = malloc(num_workers * sizeof(*workers));
+        assert(workers != NULL);
+        for (int i = 0; i < num_workers; i++) {
+                workers[i] = start_worker(listen_fd, service);
+        }
+
+        /* replace workers as they die, until told to stop */
+        while (!stopping) {
+                pid_t dead = waitpid(-1, NULL, 0);
+                if (dead < 0) {
+                        assert(errno == EINTR);
+                        continue;
+                }
+                for (int i = 0; i < num_workers && !stopping; i++) {
+                        if (workers[i] == dead) {
+                                workers[i] = start_worker(listen_fd, 
+                                                          service);
+                        }
+                }
+        }
+
+        for (int i = 0; i < num_workers; i++) {
+                kill(workers[i], SIGTERM);
+        }
+        while (waitpid(-1, NULL, 0) > 0 || errno == EINTR) {
+        }
+
+        free(workers);
+        close(listen_fd);
+        unlink(socket_path);
+}
+
+/**********open_socket********
+ *
+ * Creates a Unix domain stream socket listening at socket_path
+ * Inputs:
+ *              const char *socket_path: path to bind the socket to
+ * Return: the file descriptor of the listening socket
+ * Expects:
+ *      socket_path to be nonnull and shorter than sun_path
+ * Notes:
+ *      Checked runtime error if any of the socket calls fail
+ ************************/
+static int open_socket(const char *socket_path)
+{
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        assert(strlen(socket_path) < sizeof(address.sun_path));
+        strcpy(address.sun_path, socket_path);
+
+        int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(listen_fd >= 0);
+
+        unlink(socket_path);
+        int bound = bind(listen_fd, (struct sockaddr *)&address, 
+                                                        sizeof(address));
+        assert(bound == 0);
+        int listening = listen(listen_fd, BACKLOG);
+        assert(listening == 0);
+
+        return listen_fd;
+}
+
+/**********start_worker********
+ *
+ * Forks one worker process that serves connections on listen_fd
+ * Inputs:
+ *              int listen_fd: the listening socket
+ *              const struct service *service: what the worker serves
+ * Return: the process id of the new worker
+ * Expects:
+ *      listen_fd to be a listening socket
+ * Notes:
+ *      Checked runtime error if fork fails
+ ************************/
+static pid_t start_worker(int listen_fd, const struct service *service)
+{
+        pid_t pid = fork();
+        assert(pid >= 0);
+
+        if (pid == 0) {
+                signal(SIGINT, SIG_DFL);
+                signal(SIGTERM, SIG_DFL);
+                /* a client hanging up early should not kill the worker */
+                signal(SIGPIPE, SIG_IGN);
+                if (service->handle != NULL) {
+                        worker_loop(listen_fd, service->handle, service->cl);
+                } else {
+                        line_loop(listen_fd, service);
+                }
+        }
+        return pid;
+}
+
+/**********worker_loop********
+ *
+ * Accepts connections forever, running handle once per connection
+ * Inputs:
+ *              int listen_fd: the listening socket
+ *              Server_handler handle: the per-connection handler
+ *              void *cl: closure passed to handle
+ * Return: Does not return
+ * Expects:
+ *      listen_fd to be a listening socket
+ * Notes:
+ *      * Each connection is wrapped in one stream for reading and one for
+ *      writing, and both are closed once handle returns
+ *      * Exits with EXIT_FAILURE if accept fails for any reason other than
+ *      an interrupted call, leaving the parent to replace the worker
+ ************************/
+static void worker_loop(int listen_fd, Server_handler handle, void *cl)
+{
+        for (;;) {
+                int conn_fd = accept(listen_fd, NULL, NULL);
+                if (conn_fd < 0) {
+                        if (errno == EINTR || errno == ECONNABORTED) {
+                                continue;
+                        }
+                        exit(EXIT_FAILURE);
+                }
+
+                FILE *in = fdopen(conn_fd, "r");
+                FILE *out = fdopen(dup(conn_fd), "w");
+                assert(in != NULL && out != NULL);
+
+                handle(in, out, cl);
+
+                fclose(out);
+                fclose(in);
+        }
+}
+
+/**********line_loop********
+ *
+ * Serves connections a line at a time forever, from one epoll loop over
+ * the listening socket and every connection accepted on it
+ * Inputs:
+ *              int listen_fd: the listening socket
+ *              const struct service *service: the lines to serve
+ * Return: Does not return
+ * Expects:
+ *      listen_fd to be a listening socket, service to be nonnull
+ * Notes:
+ *      * The listening socket is made nonblocking, as another worker may
+ *      accept the connection that woke this one. It is watched with 
+ *      EPOLLEXCLUSIVE, so a connection wakes one worker, not the pool
+ *      * Exits with EXIT_FAILURE if the epoll set cannot be made or waited
+ *      on, leaving the parent to replace the worker
+ ************************/
+static void line_loop(int listen_fd, const struct service *service)
+{
+        struct rlimit files;
+        if (getrlimit(RLIMIT_NOFILE, &files) == 0) {
+                files.rlim_cur = files.rlim_max;
+                setrlimit(RLIMIT_NOFILE, &files);
+        }
+        fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+        struct loop loop = { epoll_create1(EPOLL_CLOEXEC), listen_fd, true, 
+                             service };
+        struct epoll_event event = { EPOLLIN | EPOLLEXCLUSIVE, 
+                                     { .ptr = NULL } };
+        if (loop.epoll_fd < 0 || 
+            epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) != 0) {
+                exit(EXIT_FAILURE);
+        }
+
+        struct epoll_event events[MAX_EVENTS];
+        for (;;) {
+                int ready = epoll_wait(loop.epoll_fd, events, MAX_EVENTS, -1);
+                if (ready < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        exit(EXIT_FAILURE);
+                }
+                for (int i = 0; i < ready; i++) {
+                        if (events[i].data.ptr == NULL) {
+                                accept_lines(&loop);
+                        } else {
+                                serve_lines(&loop, events[i].data.ptr);
+                        }
+                }
+        }
+}
+
+/**********accept_lines********
+ *
+ * Accepts every connection waiting on the listening socket and starts 
+ * serving each
+ * Inputs:
+ *              struct loop *loop: the worker's epoll loop
+ * Return: N/A
+ * Expects:
+ *      loop to be nonnull
+ * Notes:
+ *      * Checked runtime error if a connection cannot be allocated or 
+ *      added to the epoll set
+ *      * If the worker runs out of file descriptors the listening socket
+ *      is taken out of the epoll set, rather than waking the loop over and
+ *      over, until one of its connections closes
+ ************************/
+static void accept_lines(struct loop *loop)
+{
+        for (;;) {
+                int fd = accept4(loop->listen_fd, NULL, NULL, 
+                                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                        if (errno == EINTR || errno == ECONNABORTED) {
+                                continue;
+                        }
+                        if (errno == EMFILE || errno == ENFILE) {
+                                epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, 
+                                          loop->listen_fd, NULL);
+                                loop->accepting = false;
+                        }
+                        return;
+                }
+
+                struct connection *conn = malloc(sizeof(*conn));
+                assert(conn != NULL);
+                conn->fd = fd;
+                conn->ending = false;
+                conn->writing = false;
+                conn->in_length = 0;
+                conn->out_length = 0;
+                conn->state = loop->service->lines.start(loop->service->cl);
+
+                struct epoll_event event = { EPOLLIN, { .ptr = conn } };
+                int added = epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, 
+                                                                &event);
+                assert(added == 0);
+        }
+}
+
+/**********serve_lines********
+ *
+ * Carries a connection on as far as it can go without blocking, when 
+ * epoll reports it ready
+ * Inputs:
+ *              struct loop *loop: the worker's epoll loop
+ *              struct connection *conn: the connection
+ * Return: N/A
+ * Expects:
+ *      loop and conn to be nonnull
+ * Notes:
+ *      * Answers still unwritten are written first, and nothing more is
+ *      read until they are. Then the lines already read are answered, 
+ *      writing the answers whenever there is no room for another, and once
+ *      none is left complete the connection is read once and the lines 
+ *      that completes answered the same way
+ *      * The connection is then watched for room to write if answers are
+ *      left unwritten, closed if it is ending, and watched for input if 
+ *      not. Being level triggered, epoll brings the loop back for input 
+ *      left unread
+ *      * A read or write error ends the connection, dropping its answers
+ ************************/
+static void serve_lines(struct loop *loop, struct connection *conn)
+{
+        bool has_read = false;
+        while (write_answers(conn) && !conn->ending) {
+                answer_lines(loop, conn, false);
+                if (BUFFER_SIZE - conn->out_length < SERVER_LINE_MAX) {
+                        continue;
+                }
+                if (has_read) {
+                        write_answers(conn);
+                        break;
+                }
+
+                has_read = true;
+                ssize_t got = read(conn->fd, conn->in + conn->in_length,
+                                   BUFFER_SIZE - conn->in_length);
+                if (got > 0) {
+                        conn->in_length += got;
+                } else if (got == 0) {
+                        answer_lines(loop, conn, true);
+                        conn->ending = true;
+                } else if (errno != EAGAIN && errno != EINTR) {
+                        conn->out_length = 0;
+                        conn->ending = true;
+                }
+        }
+
+        if (conn->out_length > 0) {
+                watch(loop, conn, true);
+        } else if (conn->ending) {
+                close_connection(loop, conn);
+        } else {
+                watch(loop, conn, false);
+        }
+}
+
+/**********answer_lines********
+ *
+ * Answers the complete lines read from a connection, while there is room
+ * for their answers
+ * Inputs:
+ *              struct loop *loop: the worker's epoll loop
+ *              struct connection *conn: the connection
+ *              bool at_end: the client has closed the connection, so a 
+ *                           last line with no newline is complete
+ * Return: N/A
+ * Expects:
+ *      loop and conn to be nonnull
+ * Notes:
+ *      * Each line is handed to lines.answer without its newline. The
+ *      lines answered are dropped from conn->in, and what is left of an
+ *      incomplete line moved to its start
+ *      * A line of SERVER_LINE_MAX bytes or more, or one answered with -1,
+ *      ends the connection, and the lines after it are not answered
+ *      * Checked runtime error if an answer is longer than SERVER_LINE_MAX
+ ************************/
+static void answer_lines(struct loop *loop, struct connection *conn, 
+                         bool at_end)
+{
+        const Server_lines *lines = &loop->service->lines;
+        int start = 0;
+        while (!conn->ending && 
+               BUFFER_SIZE - conn->out_length >= SERVER_LINE_MAX) {
+                char *line = conn->in + start;
+                char *newline = memchr(line, '\n', conn->in_length - start);
+                int length = newline != NULL ? newline - line 
+                                             : conn->in_length - start;
+                if (length >= SERVER_LINE_MAX) {
+                        conn->ending = true;
+                        break;
+                }
+                if (newline == NULL && (!at_end || length == 0)) {
+                        break;
+                }
+
+                line[length] = '\0';
+                int answered = lines->answer(conn->state, line, 
+                                             conn->out + conn->out_length,
+                                             loop->service->cl);
+                if (answered < 0) {
+                        conn->ending = true;
+                } else {
+                        assert(answered <= SERVER_LINE_MAX);
+                        conn->out_length += answered;
+                }
+                start += length + (newline != NULL);
+        }
+        memmove(conn->in, conn->in + start, conn->in_length - start);
+        conn->in_length -= start;
+}
+
+/**********write_answers********
+ *
+ * Writes as many of a connection's answers as it will take without 
+ * blocking
+ * Inputs:
+ *              struct connection *conn: the connection
+ * Return: true if no answers are left unwritten, false if the client has
+ *         yet to make room for them
+ * Expects:
+ *      conn to be nonnull
+ * Notes:
+ *      A write error ends the connection and drops its answers
+ ************************/
+static bool write_answers(struct connection *conn)
+{
+        while (conn->out_length > 0) {
+                ssize_t put = write(conn->fd, conn->out, conn->out_length);
+                if (put < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                                return false;
+                        }
+                        conn->out_length = 0;
+                        conn->ending = true;
+                        break;
+                }
+                memmove(conn->out, conn->out + put, conn->out_length - put);
+                conn->out_length -= put;
+        }
+        return true;
+}
+
+/**********watch********
+ *
+ * Sets what epoll is to wake the loop for on a connection
+ * Inputs:
+ *              struct loop *loop: the worker's epoll loop
+ *              struct connection *conn: the connection
+ *              bool writing: true to wait for room to write, false to wait
+ *                            for input
+ * Return: N/A
+ * Expects:
+ *      loop and conn to be nonnull
+ * Notes:
+ *      * The epoll set is only changed if conn was waiting for the other
+ *      * Checked runtime error if it cannot be changed
+ ************************/
+static void watch(struct loop *loop, struct connection *conn, bool writing)
+{
+        if (conn->writing == writing) {
+                return;
+        }
+        struct epoll_event event = { writing ? EPOLLOUT : EPOLLIN, 
+                                     { .ptr = conn } };
+        int changed = epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, conn->fd, 
+                                                                &event);
+        assert(changed == 0);
+        conn->writing = writing;
+}
+
+/**********close_connection********
+ *
+ * Ends a connection, freeing it and its state
+ * Inputs:
+ *              struct loop *loop: the worker's epoll loop
+ *              struct connection *conn: the connection
+ * Return: N/A
+ * Expects:
+ *      loop and conn to be nonnull
+ * Notes:
+ *      * Closing the socket takes it out of the epoll set
+ *      * If accept_lines stopped accepting for want of file descriptors, 
+ *      the one freed here lets it start again
+ ************************/
+static void close_connection(struct loop *loop, struct connection *conn)
+{
+        loop->service->lines.end(conn->state, loop->service->cl);
+        close(conn->fd);
+        free(conn);
+
+        if (!loop->accepting) {
+                struct epoll_event event = { EPOLLIN | EPOLLEXCLUSIVE, 
+                                             { .ptr = NULL } };
+                epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->listen_fd, 
+                                                                &event);
+                loop->accepting = true;
+        }
+}
+
+/**********stop********
+ *
+ * Signal handler that tells Server_run to shut the pool down
+ * Inputs:
+ *              int signal_number: the signal received (not used)
+ * Return: N/A
+ * Expects:
+ *      None
+ * Notes:
+ *      None
+ ************************/
+static void stop(int signal_number)
+{
+        (void)signal_number;
+        stopping = 1;
+}
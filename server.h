@@ -0,0 +1,45 @@
+/*
+ *     server.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for a pre-forked Unix domain socket server that
+ *              runs one request per connection, or serves connections a
+ *              line at a time
+ */
+
+#ifndef SERVER_INCLUDED
+#define SERVER_INCLUDED
+
+#include <stdio.h>
+
+/*
+ * Handles one connection: reads a request from in and writes the response
+ * to out. cl is the closure given to Server_run, private to each worker.
+ */
+typedef void Server_handler(FILE *in, FILE *out, void *cl);
+
+extern void Server_run(const char *socket_path, int num_workers, 
+                                        Server_handler handle, void *cl);
+
+/* The longest line, and the longest answer to one, Server_run_lines takes */
+#define SERVER_LINE_MAX 64
+
+/*
+ * Serves connections a line at a time. start makes the state kept for a new
+ * connection, and end frees it once the connection closes. answer handles 
+ * one line, given without its newline: it writes at most SERVER_LINE_MAX 
+ * bytes of answer to answer and returns how many, or returns -1 to end the
+ * connection. cl is the closure given to Server_run_lines, private to each
+ * worker.
+ */
+typedef struct Server_lines {
+        void *(*start)(void *cl);
+        int (*answer)(void *state, const char *line, char *answer, void *cl);
+        void (*end)(void *state, void *cl);
+} Server_lines;
+
+extern void Server_run_lines(const char *socket_path, int num_workers,
+                             Server_lines lines, void *cl);
+
+#endif
@@ -3,247 +3,440 @@
  *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
  *     HW2: Interfaces, Implementations and Images (iii)
  *
- *     Summary: Uses uarray2.h interface to identify Sudoku puzzle solutions
+ *     Summary: Uses board.h interface to identify Sudoku puzzle solutions
+ *
+ *     Usage: sudoku [-C cachefile] [-a files] [file.pgm ...]
+ *              Exits with EXIT_SUCCESS if the pgm is a solved puzzle and
+ *              EXIT_FAILURE if it is not. The pgm may be gzip compressed
+ *              (or zstd, when built with ZSTREAM_ZSTD). Given several 
+ *              files, exits with EXIT_SUCCESS only if every one is solved,
+ *              stopping at the first that is not
+ *              -C: remembers answers in cachefile, so a grid checked before
+ *                  is answered from the file
+ *              -a files: with several files, how many to read ahead of 
+ *                  the one being checked (8 unless given). The reads go 
+ *                  through io_uring when built with PREFETCH_URING, and a
+ *                  pool of threads otherwise
+ *
+ *            sudoku -S socket [-w workers] [-g] [-c | -C cachefile]
+ *              Serves on a Unix domain socket instead: every connection 
+ *              sends one pgm and gets back a line holding the exit code the
+ *              command line program would give. Requests are run by a pool
+ *              of worker processes (4 unless -w is given)
+ *              -g: every connection is a game instead, starting from a 
+ *                  blank grid. Each line sent is a move, "col row digit" 
+ *                  (digit 0 clears the cell), and is answered with a line
+ *                  "consistent solved", each 1 or 0. Each worker plays 
+ *                  every game it accepts from one event loop, so any 
+ *                  number may be played at once
+ *              -c: the workers share a cache of answers held in memory
+ *              -C: as -c, but the cache is kept in cachefile
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <ctype.h>
+#include <string.h>
+#include <stdbool.h>
 #include <pnmrdr.h>
-#include "uarray2.h"
-#include "set.h"
-#include "atom.h"
+#include "board.h"
+#include "server.h"
+#include "zstream.h"
+#include "grid.h"
+#include "cache.h"
+#include "prefetch.h"
+
+const int DEFAULT_WORKERS = 4;
+const int CACHE_LOG2_SLOTS = 17;
+const int DEFAULT_READ_AHEAD = 8;
 
-const int LINE_WIDTH = 9;
-const int LINE_HEIGHT = 1;
+/* What the command line asked for */
+struct options {
+        const char **filenames; /* input files; with none, stdin */
+        int num_files;
+        const char *socket_path;        /* -S: serve on this socket */
+        int workers;            /* -w: worker processes when serving */
+        bool game;              /* -g: serve games move by move */
+        bool cache;             /* -c or -C: cache answers */
+        const char *cache_path; /* -C: file to keep the cache in */
+        int read_ahead;         /* -a: files read ahead of the current one */
+};
+
+/* The state one server worker keeps between requests */
+struct worker {
+        Cache_T cache;          /* answers shared by all workers, or NULL */
+};
+
+struct options parse_options(int argc, char *argv[]);
+void serve_puzzle(FILE *in, FILE *out, void *cl);
+void *start_game(void *cl);
+int play_move(void *state, const char *line, char *answer, void *cl);
+void end_game(void *state, void *cl);
+bool check_files(struct options *opts, Cache_T cache);
+bool check_puzzle(FILE *in, Cache_T cache);
+bool solved(const Board *sudoku, Cache_T cache);
 
 void check_pgm_format(Pnmrdr_mapdata input_data);
-UArray2_T sudoku_puzzle(Pnmrdr_T input, Pnmrdr_mapdata input_data);
-void insert_pgm_into_array(int col, int row, UArray2_T sudoku, 
-                                        void *element_at, void *input);
-void validate_lines(int col, int row, UArray2_T sudoku, void *element_at, 
-                                                        void *one_line);
-void validate_3x3s(UArray2_T sudoku, Set_T one_line);
+void sudoku_puzzle(Pnmrdr_T input, Pnmrdr_mapdata input_data, 
+                                                        Board *sudoku);
 
 
 int main(int argc, char *argv[]) 
 {
-        assert(argc == 1 || argc == 2);
-        FILE *input_file;
-        
-        if (argc == 1) {
-                input_file = stdin;
-        } else { 
-                input_file = fopen(argv[1], "r");
-                assert(input_file != NULL);
+        struct options opts = parse_options(argc, argv);
+        Cache_T cache = NULL;
+        if (opts.cache) {
+                cache = Cache_new(opts.cache_path, CACHE_LOG2_SLOTS);
         }
 
-        /* check format of pgm */
-        Pnmrdr_T input = Pnmrdr_new(input_file);
-        Pnmrdr_mapdata input_data = Pnmrdr_data(input);
-        check_pgm_format(input_data);
+        if (opts.socket_path != NULL) {
+                /* made before the workers fork, so they share it */
+                struct worker worker = { cache };
+                if (opts.game) {
+                        Server_lines game = { start_game, play_move, 
+                                              end_game };
+                        Server_run_lines(opts.socket_path, opts.workers, 
+                                         game, &worker);
+                } else {
+                        Server_run(opts.socket_path, opts.workers, 
+                                   serve_puzzle, &worker);
+                }
+                exit(EXIT_SUCCESS);
+        }
 
-        /* turn pgm into a 2D UArray */
-        UArray2_T test = sudoku_puzzle(input, input_data);
+        bool is_solved;
+        if (opts.num_files > 1) {
+                is_solved = check_files(&opts, cache);
+        } else {
+                FILE *input_file;
         
-        /* validate rows and columns */
-        Set_T one_line = Set_new(9, NULL, NULL);
-        UArray2_map_row_major(test, validate_lines, &one_line);
-        UArray2_map_col_major(test, validate_lines, &one_line);
-
-        /* validate smaller 3x3 grids */
-        validate_3x3s(test, one_line);
+                if (opts.num_files == 0) {
+                        input_file = stdin;
+                } else { 
+                        input_file = fopen(opts.filenames[0], "r");
+                        assert(input_file != NULL);
+                }
+                is_solved = check_puzzle(input_file, cache);
+                fclose(input_file);
+        }
 
         /* free up memory */
-        UArray2_free(&test);
-        Pnmrdr_free(&input);
-        fclose(input_file);
+        free(opts.filenames);
+        if (cache != NULL) {
+                Cache_free(&cache);
+        }
 
-        exit(EXIT_SUCCESS);
+        exit(is_solved ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
+/**********parse_options********
+ *
+ * Reads the command line into a struct options
+ * Inputs:
+ *              int argc: number of command line arguments
+ *              char *argv[]: the command line arguments
+ * Return: the options given, with defaults for those that were not
+ * Expects:
+ *      -S, -w, -C and -a to be followed by a value
+ * Notes:
+ *      * Checked runtime error if an option is missing its value, or the 
+ *      worker or read ahead count is not positive
+ *      * The file names are collected in opts.filenames, which the client
+ *      must free
+ ************************/
+struct options parse_options(int argc, char *argv[])
+{
+        struct options opts = { NULL, 0, NULL, DEFAULT_WORKERS, false, 
+                                false, NULL, DEFAULT_READ_AHEAD };
+        opts.filenames = malloc(argc * sizeof(*opts.filenames));
+        assert(opts.filenames != NULL);
 
-/**********check_pgm_format********
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "-S") == 0) {
+                        assert(i + 1 < argc);
+                        opts.socket_path = argv[++i];
+                } else if (strcmp(argv[i], "-w") == 0) {
+                        assert(i + 1 < argc);
+                        opts.workers = atoi(argv[++i]);
+                        assert(opts.workers > 0);
+                } else if (strcmp(argv[i], "-g") == 0) {
+                        opts.game = true;
+                } else if (strcmp(argv[i], "-c") == 0) {
+                        opts.cache = true;
+                } else if (strcmp(argv[i], "-C") == 0) {
+                        assert(i + 1 < argc);
+                        opts.cache = true;
+                        opts.cache_path = argv[++i];
+                } else if (strcmp(argv[i], "-a") == 0) {
+                        assert(i + 1 < argc);
+                        opts.read_ahead = atoi(argv[++i]);
+                        assert(opts.read_ahead > 0);
+                } else {
+                        opts.filenames[opts.num_files++] = argv[i];
+                }
+        }
+        return opts;
+}
+
+/**********serve_puzzle********
  *
- * Checks that the filename provided is a correct portable graymap file
+ * Server_handler that checks the pgm sent on one connection
  * Inputs:
- *              Pnmrdr_mapdata input_data: input_data is an instance of a 
- *                                         struct of type Pnmrdr_mapdata, 
- *                                         which is used in the function to
- *                                         validate that the correct values 
- *                                         associated with the pgm file are 
- *                                         being inputted.
+ *              FILE *in: the connection, carrying a pgm
+ *              FILE *out: the connection, for the answer
+ *              void *cl: the struct worker of the worker process running
+ *                        the request
  * Return: N/A
  * Expects:
- *      * type of input_data to be a pgm (value = 2)
- *      * width, height and denominator to be 9
+ *      in, out and cl to be nonnull
  * Notes:
- *      * Checked runtime error if type of input_data != 2 (not of type pgm)
- *      * Program exits if width, height, denominator != 9
+ *      * Answers with one line, "0" if the puzzle is solved and "1" if it
+ *      is not, the same as the exit code of the command line program
+ *      * Exits on a badly formatted pgm, as in check_pgm_format
  ************************/
-void check_pgm_format(Pnmrdr_mapdata input_data)
+void serve_puzzle(FILE *in, FILE *out, void *cl)
 {
-        /* check if it's a pgm */
-        assert(input_data.type == 2);
-        
-        if (input_data.width != 9 || input_data.height != 9 
-                                        || input_data.denominator != 9) {
-                exit(EXIT_FAILURE);
-        }
+        struct worker *worker = cl;
+        fprintf(out, "%d\n", check_puzzle(in, worker->cache) ? EXIT_SUCCESS 
+                                                             : EXIT_FAILURE);
 }
 
-/**********sudoku_puzzle********
+/**********start_game********
  *
- * Creates, allocates and populates a new UArray2 with values from the pgm 
- * input file. The UArray2 that holds these values represents the sudoku board
+ * Starts the game played on a new connection, for Server_run_lines
  * Inputs:
- *              Pnmrdr_T input: input will be passed as a closure to a map 
- *                              function in order to read in the values from an
- *                              input file
- *              Pnmrdr_mapdata input_data: input_data is an instance of a 
- *                                         struct of type Pnmrdr_mapdata, 
- *                                         which is used in the function to
- *                                         access the values associated with 
- *                                         the pgm file that is inputted
- * Return: A UArray2 that is populated with the values in the pgm file
+ *              void *cl: the struct worker of the worker process (not used)
+ * Return: a blank Grid_T, the state of the game
  * Expects:
- *      * width and height to be nonnegative
- *      * size to be positive
+ *      None
  * Notes:
- *      * UArray2 sudoku_array is allocated memory in this function. 
- *      * The client must use Uarray2_free once the memory is no longer needed
+ *      Checked runtime error, as in Grid_new, if it cannot be allocated
  ************************/
-UArray2_T sudoku_puzzle(Pnmrdr_T input, Pnmrdr_mapdata input_data) 
+void *start_game(void *cl)
 {
-        UArray2_T sudoku_array = UArray2_new(input_data.width, 
-                                        input_data.height, sizeof(int));
-        UArray2_map_row_major(sudoku_array, insert_pgm_into_array, &input);
-        return sudoku_array;
+        (void)cl;
+        return Grid_new();
 }
 
-/**********insert_pgm_into_array********
+/**********play_move********
  *
- * Inserts a value in the pgm file into the UArray2 at a given position 
- * defined by (col, row)
+ * Applies one move sent on a game's connection and answers it with the 
+ * state of the grid
  * Inputs:
- *              int col: column value where element will be inserted
- *              int row: row value where element will be inserted
- *              UArray2_T sudoku: Pointer to the UArray2 where value will be 
- *                                inserted
- *              void *element_at: pointer to element at a specific position
- *                                (not used)
- *              void *input: a closure value, in this case it is a pointer to 
- *                           a struct of type Pnmrdr_T, which is used to enable
- *                           access to each value in the pgm file
- * Return: N/A
- * Expects: 
- *      * An existing UArray2 is entered in as the first parameter
- *      * The row value is positive and is less than the height of the UArray2
- *      * The col value is positive and is less than the width of the UArray2
+ *              void *state: the game's Grid_T, from start_game
+ *              const char *line: the move, without its newline
+ *              char *answer: where to write the answer
+ *              void *cl: the struct worker of the worker process (not used)
+ * Return: the length of the answer, or -1 if line is not a move
+ * Expects:
+ *      state, line and answer to be nonnull, answer to hold 
+ *      SERVER_LINE_MAX bytes
  * Notes:
- *      * Program exits if element = 0
- *      * Used as an apply function for map_row_major, so that it will iterate
- *      and insert every value from the pgm file into the UArray2
+ *      * A move is "col row digit", with col and row from 0 to 8 and digit
+ *      from 0 (clear) to 9. Each is answered with "consistent solved", 
+ *      each 1 or 0
+ *      * Every move and answer takes constant time, whatever has been 
+ *      played before
+ *      * A line that is not a move ends the game, as does the client 
+ *      closing the connection
  ************************/
-void insert_pgm_into_array(int col, int row, UArray2_T sudoku, 
-                                        void *element_at, void *input)
+int play_move(void *state, const char *line, char *answer, void *cl)
 {
-        (void) element_at;
-        *(int *)UArray2_at(sudoku, col, row) = Pnmrdr_get(*(Pnmrdr_T *)input);
-        
-        if (*(int *)UArray2_at(sudoku, col, row) == 0) {
-                exit(EXIT_FAILURE);
+        (void)cl;
+        Grid_T grid = state;
+        int col, row, digit;
+        char extra;
+        if (sscanf(line, "%d %d %d %c", &col, &row, &digit, &extra) != 3 ||
+            col < 0 || col > 8 || row < 0 || row > 8 || 
+            digit < 0 || digit > 9) {
+                return -1;
         }
+
+        Grid_place(grid, col, row, digit);
+        return sprintf(answer, "%d %d\n", Grid_consistent(grid), 
+                                           Grid_solved(grid));
 }
 
-/**********validate_lines********
+/**********end_game********
  *
- * Checks that every value in a line (row or column) is unique
+ * Frees the state of a game whose connection has closed
  * Inputs:
- *              int col: column value (not used in function)
- *              int row: row value (not used in function)
- *              UArray2_T sudoku: Pointer to the UArray2 (not used in function)
- *              void *element_at: pointer to element at a specific position
- *              void *one_line: a closure value. In this function it is a 
- *                              set that is used to check if each element in a
- *                              line is unique
- * Return: None
+ *              void *state: the game's Grid_T, from start_game
+ *              void *cl: the struct worker of the worker process (not used)
+ * Return: N/A
  * Expects:
+ *      state to be nonnull
+ * Notes:
  *      None
+ ************************/
+void end_game(void *state, void *cl)
+{
+        (void)cl;
+        Grid_T grid = state;
+        Grid_free(&grid);
+}
+
+/**********check_files********
+ *
+ * Checks the pgm in every input file, in order, until one is not solved
+ * Inputs:
+ *              struct options *opts: the input files and read ahead count
+ *              Cache_T cache: as for solved
+ * Return: true if every file holds a solved puzzle
+ * Expects:
+ *      opts to be nonnull
  * Notes:
- *      * Each new set created is allocated memory in this function, and then
- *      freed in this function once the set reaches max capacity (length = 9)
- *      * However, in the final instance (when validating the last line), a new
- *      set is allocated memory within this function. The client must free the
- *      memory using Set_free once it is no longer needed.
+ *      * The next opts->read_ahead files are read while one is checked, 
+ *      so storage that is slow to answer only holds up the first file
+ *      * Exits on a badly formatted pgm, as in check_pgm_format
+ *      * Checked runtime error if a file cannot be opened or read
  ************************/
-void validate_lines(int col, int row, UArray2_T sudoku, void *element_at, 
-                                                                void *one_line)
-{        
-        (void)col;
-        (void)row;
-        (void)sudoku;
+bool check_files(struct options *opts, Cache_T cache)
+{
+        Prefetch_T prefetch = Prefetch_new(opts->filenames, opts->num_files,
+                                                        opts->read_ahead);
+        bool all_solved = true;
+        Prefetch_file file;
+        while (all_solved && Prefetch_next(prefetch, &file)) {
+                FILE *in = fmemopen(file.bytes, file.length, "r");
+                assert(in != NULL);
+                all_solved = check_puzzle(in, cache);
+                fclose(in);
+                free(file.bytes);
+        }
+        Prefetch_free(&prefetch);
+        return all_solved;
+}
 
-        int elem = *(int *)element_at;
+/**********check_puzzle********
+ *
+ * Reads one pgm and checks whether it is a solved puzzle
+ * Inputs:
+ *              FILE *in: stream holding the pgm, which may be compressed
+ *              Cache_T cache: as for solved
+ * Return: true if the pgm is a solved puzzle
+ * Expects:
+ *      in to be nonnull
+ * Notes:
+ *      * A compressed pgm is decompressed on a thread of its own
+ *      * Exits on a badly formatted pgm, as in check_pgm_format
+ *      * The board is on the stack, so nothing is left to free
+ ************************/
+bool check_puzzle(FILE *in, Cache_T cache)
+{
+        /* check format of pgm, decompressing it if need be */
+        Zstream_T unzip = Zstream_decompress(in);
+        Pnmrdr_T input = Pnmrdr_new(unzip != NULL ? Zstream_file(unzip) 
+                                                  : in);
+        Pnmrdr_mapdata input_data = Pnmrdr_data(input);
+        check_pgm_format(input_data);
 
-        /* turns elem into an Atom to be able to be used in the Set */
-        const char *curr_elem = Atom_int(elem);
+        /* turn pgm into a packed board */
+        Board puzzle;
+        sudoku_puzzle(input, input_data, &puzzle);
+        Pnmrdr_free(&input);
+        Zstream_close(&unzip);
 
-        /* if there are any repeat numbers in one line */
-        if (Set_member(*(Set_T *)one_line, curr_elem)) {
-                exit(EXIT_FAILURE);
+        return solved(&puzzle, cache);
+}
+
+/**********solved********
+ *
+ * Checks whether a sudoku board is a solved puzzle
+ * Inputs:
+ *              const Board *sudoku: the board
+ *              Cache_T cache: answers for boards seen before, or NULL
+ * Return: true if every cell holds 1 to 9 and no digit repeats in any row,
+ *         column or 3x3 box; false otherwise
+ * Expects:
+ *      sudoku to be nonnull
+ * Notes:
+ *      * Nothing is allocated: each row, column and box is checked as a 
+ *      mask of the digits in it
+ *      * With a cache, the board is looked up first and the answer stored
+ *      there if it is missing. Only exact repeats are found: putting a 
+ *      board in its canonical form (Board_canonical) costs several times 
+ *      what checking it does, so it could never save time. bench_sudoku's
+ *      cache-canon and validate phases measure the two
+ ************************/
+bool solved(const Board *sudoku, Cache_T cache)
+{
+        if (cache == NULL) {
+                return Board_solved(sudoku);
         }
+
+        uint64_t hash = Board_hash(sudoku);
+        bool answer;
+        if (!Cache_lookup(cache, sudoku, hash, &answer)) {
+                answer = Board_solved(sudoku);
+                Cache_insert(cache, sudoku, hash, answer);
+        }
+        return answer;
+}
+
+/**********check_pgm_format********
+ *
+ * Checks that the filename provided is a correct portable graymap file
+ * Inputs:
+ *              Pnmrdr_mapdata input_data: input_data is an instance of a 
+ *                                         struct of type Pnmrdr_mapdata, 
+ *                                         which is used in the function to
+ *                                         validate that the correct values 
+ *                                         associated with the pgm file are 
+ *                                         being inputted.
+ * Return: N/A
+ * Expects:
+ *      * type of input_data to be a pgm (value = 2)
+ *      * width, height and denominator to be 9
+ * Notes:
+ *      * Checked runtime error if type of input_data != 2 (not of type pgm)
+ *      * Program exits if width, height, denominator != 9
+ ************************/
+void check_pgm_format(Pnmrdr_mapdata input_data)
+{
+        /* check if it's a pgm */
+        assert(input_data.type == 2);
         
-        Set_put(*(Set_T *)one_line, curr_elem);
-        
-        /* reset the Set every 9 elems */
-        if (Set_length(*(Set_T *)one_line) == 9) {
-                Set_free(&(*(Set_T *)one_line));
-                *(Set_T *)one_line = Set_new(9, NULL, NULL);
+        if (input_data.width != 9 || input_data.height != 9 
+                                        || input_data.denominator != 9) {
+                exit(EXIT_FAILURE);
         }
 }
 
-/**********validate_3x3s********
+/**********sudoku_puzzle********
  *
- * Checks that every value in each 3x3 grid is unique
+ * Reads the values of the pgm input file into a packed board
  * Inputs:
- *              UArray2_T sudoku: Pointer to the UArray2 (not used in function)
- *              Set_T one_line: Pointer to a set that will be populated with
- *                              each value in each 3x3 grid
- * Return: None
+ *              Pnmrdr_T input: reader positioned at the start of the raster
+ *              Pnmrdr_mapdata input_data: input_data is an instance of a 
+ *                                         struct of type Pnmrdr_mapdata, 
+ *                                         which is used in the function to
+ *                                         access the values associated with 
+ *                                         the pgm file that is inputted
+ *              Board *sudoku: set to the board in the pgm
+ * Return: N/A
  * Expects:
- *      * width and height to be nonnegative
- *      * size to be positive
+ *      * input_data to be for a 9 x 9 pgm, as checked by check_pgm_format
+ *      * sudoku to be nonnull
  * Notes:
- *      A new UArray2 box_to_row is allocated memory to hold each grid, and 
- *      freed after the check is done
- *      This function also frees the set that contains the last line in 
- *      validate_lines()
+ *      * Blank (0) cells are stored as they are and rejected by solved, as 
+ *      are values over 9
+ *      * The board is the caller's, so nothing is allocated here. It is
+ *      cleared first, as board.h asks
  ************************/
-void validate_3x3s(UArray2_T sudoku, Set_T one_line) 
+void sudoku_puzzle(Pnmrdr_T input, Pnmrdr_mapdata input_data, 
+                                                        Board *sudoku) 
 {
-        for (int row = 0; row < 9; row += 3) {
-                for (int col = 0; col < 9; col += 3) {
-                        /* new 9 x 1 UArray2 for each small box */
-                        UArray2_T box_to_row = UArray2_new
-                                                (LINE_WIDTH, 
-                                                 LINE_HEIGHT, 
-                                                 sizeof(int));
-                        int count = 0;
-
-                        for (int i = row; i < row + 3; i++) {
-                                for (int j = col; j < col + 3; j++) {
-                                        *(int *)UArray2_at
-                                        (box_to_row, count, 0)
-                                         = *(int *)UArray2_at(sudoku, j, i);
-                                        count++;
-                                }        
-                        }
-                        UArray2_map_row_major(box_to_row, validate_lines, 
-                                                                &one_line);
-                        UArray2_free(&box_to_row);
+        assert(sudoku != NULL);
+        Board_clear(sudoku);
+        for (unsigned row = 0; row < input_data.height; row++) {
+                for (unsigned col = 0; col < input_data.width; col++) {
+                        unsigned sample = Pnmrdr_get(input);
+                        Board_set(sudoku, col, row, 
+                                  sample > 9 ? -1 : (int)sample);
                 }
         }
-        Set_free(&one_line);
 }
@@ -0,0 +1,470 @@
+/*
+ *     uarray2.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of 2D Unboxed Arrays, and of views onto
+ *              rectangles of them
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "uarray2.h"
+
+#define T UArray2_T
+
+/*
+ * Elements are stored in one block in row major order: element (col, row)
+ * is at elements + (row * width + col) * size. A whole array is the view
+ * of itself from (0, 0) with a stride of width * size bytes, so the view
+ * functions work on any rectangle of it the same way
+ */
+struct T {
+        char *elements;
+        Bigmem_policy policy;   /* how elements is allocated */
+        size_t capacity;        /* bytes allocated at elements */
+        int width;
+        int height;
+        int size;
+};
+
+/**********UArray2_new********
+ *
+ * Creates a new width x height array of elements of size bytes each
+ * Inputs:
+ *              int width: the number of columns
+ *              int height: the number of rows
+ *              int size: the number of bytes in each element
+ * Return: A new array with every element's bytes set to zero
+ * Expects:
+ *      width and height to be nonnegative; size to be positive
+ * Notes:
+ *      * Checked runtime error if width or height is negative, size is not
+ *      positive, or memory cannot be allocated
+ *      * The client must use UArray2_free once the array is no longer
+ *      needed
+ ************************/
+T UArray2_new(int width, int height, int size)
+{
+        return UArray2_new_policy(width, height, size, Bigmem_default);
+}
+
+/**********UArray2_new_policy********
+ *
+ * Creates a new width x height array of elements of size bytes each, 
+ * allocating the elements as a policy says
+ * Inputs:
+ *              int width, int height: the size of the array
+ *              int size: the number of bytes in each element
+ *              Bigmem_policy policy: how to allocate the elements
+ * Return: A new array with every element's bytes set to zero
+ * Expects:
+ *      width and height to be nonnegative; size to be positive
+ * Notes:
+ *      * As for UArray2_new
+ *      * Worth it for arrays of many megabytes: see bigmem.h
+ ************************/
+T UArray2_new_policy(int width, int height, int size, Bigmem_policy policy)
+{
+        assert(width >= 0 && height >= 0 && size > 0);
+        T uarray2 = malloc(sizeof(*uarray2));
+        assert(uarray2 != NULL);
+
+        uarray2->policy = policy;
+        uarray2->capacity = (size_t)width * height * size;
+        uarray2->elements = Bigmem_alloc(uarray2->capacity, policy);
+        uarray2->width = width;
+        uarray2->height = height;
+        uarray2->size = size;
+        return uarray2;
+}
+
+/**********UArray2_free********
+ *
+ * Deallocates *uarray2 and sets it to NULL
+ * Inputs:
+ *              T *uarray2: pointer to the array to free
+ * Return: N/A
+ * Expects:
+ *      uarray2 and *uarray2 to be nonnull
+ * Notes:
+ *      * Checked runtime error if uarray2 or *uarray2 is null
+ *      * Views of the array must not be used afterwards
+ ************************/
+void UArray2_free(T *uarray2)
+{
+        assert(uarray2 != NULL && *uarray2 != NULL);
+        T array = *uarray2;
+        Bigmem_free(array->elements, array->capacity, array->policy);
+        free(*uarray2);
+        *uarray2 = NULL;
+}
+
+/**********UArray2_resize********
+ *
+ * Changes the shape of uarray2 and sets every element's bytes to zero, 
+ * reusing its memory when there is enough of it
+ * Inputs:
+ *              T uarray2: the array
+ *              int width, int height: the new size
+ *              int size: the new number of bytes in each element
+ * Return: N/A
+ * Expects:
+ *      uarray2 to be nonnull; width and height to be nonnegative; size to 
+ *      be positive
+ * Notes:
+ *      * Checked runtime error if uarray2 is null, the new shape is bad, or
+ *      memory cannot be allocated
+ *      * As with Bit2_resize, memory is only reallocated when the array 
+ *      grows past the most bytes it has held
+ *      * Views of the array must not be used afterwards
+ ************************/
+void UArray2_resize(T uarray2, int width, int height, int size)
+{
+        assert(uarray2 != NULL);
+        assert(width >= 0 && height >= 0 && size > 0);
+
+        size_t bytes = (size_t)width * height * size;
+        if (bytes > uarray2->capacity) {
+                Bigmem_free(uarray2->elements, uarray2->capacity, 
+                                                        uarray2->policy);
+                uarray2->elements = Bigmem_alloc(bytes, uarray2->policy);
+                uarray2->capacity = bytes;
+        } else {
+                memset(uarray2->elements, 0, bytes);
+        }
+
+        uarray2->width = width;
+        uarray2->height = height;
+        uarray2->size = size;
+}
+
+/**********UArray2_width********
+ *
+ * Returns the number of columns in uarray2
+ * Inputs:
+ *              T uarray2: the array
+ * Return: its width
+ * Expects:
+ *      uarray2 to be nonnull
+ * Notes:
+ *      Checked runtime error if uarray2 is null
+ ************************/
+int UArray2_width(T uarray2)
+{
+        assert(uarray2 != NULL);
+        return uarray2->width;
+}
+
+/**********UArray2_height********
+ *
+ * Returns the number of rows in uarray2
+ * Inputs:
+ *              T uarray2: the array
+ * Return: its height
+ * Expects:
+ *      uarray2 to be nonnull
+ * Notes:
+ *      Checked runtime error if uarray2 is null
+ ************************/
+int UArray2_height(T uarray2)
+{
+        assert(uarray2 != NULL);
+        return uarray2->height;
+}
+
+/**********UArray2_size********
+ *
+ * Returns the number of bytes in each element of uarray2
+ * Inputs:
+ *              T uarray2: the array
+ * Return: its element size
+ * Expects:
+ *      uarray2 to be nonnull
+ * Notes:
+ *      Checked runtime error if uarray2 is null
+ ************************/
+int UArray2_size(T uarray2)
+{
+        assert(uarray2 != NULL);
+        return uarray2->size;
+}
+
+/**********UArray2_at********
+ *
+ * Returns a pointer to the element at (col, row)
+ * Inputs:
+ *              T uarray2: the array
+ *              int col, int row: the element
+ * Return: a pointer to the element, valid until the array is freed
+ * Expects:
+ *      uarray2 to be nonnull; col and row in range
+ * Notes:
+ *      Checked runtime error if uarray2 is null or the element is out of
+ *      range
+ ************************/
+void *UArray2_at(T uarray2, int col, int row)
+{
+        assert(uarray2 != NULL);
+        assert(col >= 0 && col < uarray2->width);
+        assert(row >= 0 && row < uarray2->height);
+        return uarray2->elements + ((size_t)row * uarray2->width + col) *
+                                                        uarray2->size;
+}
+
+/**********UArray2_map_row_major********
+ *
+ * Calls apply on every element of uarray2, row by row, with column indices
+ * varying fastest
+ * Inputs:
+ *              T uarray2: the array
+ *              void apply: called with each element's column, row, the
+ *                          array, a pointer to the element and cl
+ *              void *cl: closure passed on to apply
+ * Return: N/A
+ * Expects:
+ *      uarray2 and apply to be nonnull
+ * Notes:
+ *      * Checked runtime error if uarray2 is null
+ *      * Visits the elements in the order they are stored
+ ************************/
+void UArray2_map_row_major(T uarray2, void apply(int col, int row,
+                            T uarray2, void *element_at, void *cl), void *cl)
+{
+        assert(uarray2 != NULL && apply != NULL);
+        char *element = uarray2->elements;
+        for (int r = 0; r < uarray2->height; r++) {
+                for (int c = 0; c < uarray2->width; c++) {
+                        apply(c, r, uarray2, element, cl);
+                        element += uarray2->size;
+                }
+        }
+}
+
+/**********UArray2_map_col_major********
+ *
+ * Calls apply on every element of uarray2, column by column, with row
+ * indices varying fastest
+ * Inputs:
+ *              T uarray2: the array
+ *              void apply: called with each element's column, row, the
+ *                          array, a pointer to the element and cl
+ *              void *cl: closure passed on to apply
+ * Return: N/A
+ * Expects:
+ *      uarray2 and apply to be nonnull
+ * Notes:
+ *      Checked runtime error if uarray2 is null
+ ************************/
+void UArray2_map_col_major(T uarray2, void apply(int col, int row,
+                            T uarray2, void *element_at, void *cl), void *cl)
+{
+        assert(uarray2 != NULL && apply != NULL);
+        size_t stride = (size_t)uarray2->width * uarray2->size;
+        for (int c = 0; c < uarray2->width; c++) {
+                char *element = uarray2->elements + (size_t)c *
+                                                        uarray2->size;
+                for (int r = 0; r < uarray2->height; r++) {
+                        apply(c, r, uarray2, element, cl);
+                        element += stride;
+                }
+        }
+}
+
+/**********UArray2_view_of********
+ *
+ * Makes a view of a rectangle of uarray2, without copying it
+ * Inputs:
+ *              T uarray2: the array
+ *              int col, int row: the top left element of the rectangle
+ *              int width, int height: the size of the rectangle
+ * Return: the view, whose element (0, 0) is uarray2's element (col, row)
+ * Expects:
+ *      uarray2 to be nonnull; the rectangle to lie inside uarray2
+ * Notes:
+ *      * Checked runtime error if uarray2 is null or the rectangle does not
+ *      fit
+ *      * Writing through the view writes to uarray2
+ ************************/
+UArray2_view UArray2_view_of(T uarray2, int col, int row, int width,
+                                                                int height)
+{
+        assert(uarray2 != NULL);
+        UArray2_view whole = { uarray2->elements, uarray2->width,
+                               uarray2->height, uarray2->size,
+                               (long)uarray2->width * uarray2->size };
+        return UArray2_view_sub(whole, col, row, width, height);
+}
+
+/**********UArray2_view_sub********
+ *
+ * Makes a view of a rectangle of another view, such as one box of a board
+ * Inputs:
+ *              UArray2_view view: the view to take the rectangle from
+ *              int col, int row: the top left element of the rectangle, in
+ *                                view's coordinates
+ *              int width, int height: the size of the rectangle
+ * Return: the narrower view, over the same array as view
+ * Expects:
+ *      the rectangle to lie inside view
+ * Notes:
+ *      Checked runtime error if the rectangle does not fit
+ ************************/
+UArray2_view UArray2_view_sub(UArray2_view view, int col, int row,
+                                                    int width, int height)
+{
+        assert(col >= 0 && row >= 0 && width >= 0 && height >= 0);
+        assert(col + width <= view.width && row + height <= view.height);
+        view.origin += row * view.stride + (long)col * view.size;
+        view.width = width;
+        view.height = height;
+        return view;
+}
+
+/**********UArray2_view_width********
+ *
+ * Returns the width of a view
+ * Inputs:
+ *              UArray2_view view: the view
+ * Return: the number of columns in the view
+ * Expects:
+ *      None
+ * Notes:
+ *      None
+ ************************/
+int UArray2_view_width(UArray2_view view)
+{
+        return view.width;
+}
+
+/**********UArray2_view_height********
+ *
+ * Returns the height of a view
+ * Inputs:
+ *              UArray2_view view: the view
+ * Return: the number of rows in the view
+ * Expects:
+ *      None
+ * Notes:
+ *      None
+ ************************/
+int UArray2_view_height(UArray2_view view)
+{
+        return view.height;
+}
+
+/**********UArray2_view_size********
+ *
+ * Returns the size of the elements of a view
+ * Inputs:
+ *              UArray2_view view: the view
+ * Return: the number of bytes in each element
+ * Expects:
+ *      None
+ * Notes:
+ *      None
+ ************************/
+int UArray2_view_size(UArray2_view view)
+{
+        return view.size;
+}
+
+/**********UArray2_view_at********
+ *
+ * Returns a pointer to the element at (col, row) of a view
+ * Inputs:
+ *              UArray2_view view: the view
+ *              int col, int row: the element, in view's coordinates
+ * Return: a pointer to the element in the underlying array
+ * Expects:
+ *      col and row in range
+ * Notes:
+ *      Checked runtime error if the element is out of range
+ ************************/
+void *UArray2_view_at(UArray2_view view, int col, int row)
+{
+        assert(col >= 0 && col < view.width);
+        assert(row >= 0 && row < view.height);
+        return view.origin + row * view.stride + (long)col * view.size;
+}
+
+/**********UArray2_view_row********
+ *
+ * Returns one row of a view as a contiguous span
+ * Inputs:
+ *              UArray2_view view: the view
+ *              int row: the row
+ * Return: a pointer to the row's first element; its width elements follow
+ *         one after another, size bytes apart
+ * Expects:
+ *      row in range
+ * Notes:
+ *      * Checked runtime error if row is out of range
+ *      * Lets a row be read or written with memcpy or a plain loop, with
+ *      no call per element
+ ************************/
+void *UArray2_view_row(UArray2_view view, int row)
+{
+        assert(row >= 0 && row < view.height);
+        return view.origin + row * view.stride;
+}
+
+/**********UArray2_view_map_row_major********
+ *
+ * Calls apply on every element of a view, row by row
+ * Inputs:
+ *              UArray2_view view: the view
+ *              void apply: called with each element's column and row in
+ *                          view's coordinates, the view, a pointer to the
+ *                          element and cl
+ *              void *cl: closure passed on to apply
+ * Return: N/A
+ * Expects:
+ *      apply to be nonnull
+ * Notes:
+ *      Checked runtime error if apply is null
+ ************************/
+void UArray2_view_map_row_major(UArray2_view view, void apply(int col,
+                int row, UArray2_view view, void *element_at, void *cl),
+                                                                void *cl)
+{
+        assert(apply != NULL);
+        for (int r = 0; r < view.height; r++) {
+                char *element = view.origin + r * view.stride;
+                for (int c = 0; c < view.width; c++) {
+                        apply(c, r, view, element, cl);
+                        element += view.size;
+                }
+        }
+}
+
+/**********UArray2_view_map_col_major********
+ *
+ * Calls apply on every element of a view, column by column
+ * Inputs:
+ *              UArray2_view view: the view
+ *              void apply: called with each element's column and row in
+ *                          view's coordinates, the view, a pointer to the
+ *                          element and cl
+ *              void *cl: closure passed on to apply
+ * Return: N/A
+ * Expects:
+ *      apply to be nonnull
+ * Notes:
+ *      Checked runtime error if apply is null
+ ************************/
+void UArray2_view_map_col_major(UArray2_view view, void apply(int col,
+                int row, UArray2_view view, void *element_at, void *cl),
+                                                                void *cl)
+{
+        assert(apply != NULL);
+        for (int c = 0; c < view.width; c++) {
+                char *element = view.origin + (long)c * view.size;
+                for (int r = 0; r < view.height; r++) {
+                        apply(c, r, view, element, cl);
+                        element += view.stride;
+                }
+        }
+}
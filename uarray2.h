@@ -9,12 +9,35 @@
 
 #ifndef UARRAY2_INCLUDED
 #define UARRAY2_INCLUDED
+
+#include "bigmem.h"
+
 #define T UArray2_T
 typedef struct T *T;
 
+/* 
+ * A width x height window onto an array, sharing its elements. A view is a 
+ * plain value: making, copying and dropping one allocates nothing, and it 
+ * stays valid as long as the array it was made from.
+ *
+ * The fields are only declared here so a view can be passed by value; they
+ * are private to the implementation, and clients go through the 
+ * UArray2_view functions below
+ */
+typedef struct UArray2_view {
+        char *origin;           /* element (0, 0) of the view */
+        int width;
+        int height;
+        int size;               /* bytes per element */
+        long stride;            /* bytes from one row to the next */
+} UArray2_view;
+
 
 extern T UArray2_new(int width, int height, int size);
+extern T UArray2_new_policy(int width, int height, int size, 
+                                                Bigmem_policy policy);
 extern void UArray2_free(T *uarray2);
+extern void UArray2_resize(T uarray2, int width, int height, int size);
 extern int UArray2_width(T uarray2);
 extern int UArray2_height(T uarray2);
 extern int UArray2_size (T uarray2);
@@ -24,6 +47,22 @@ extern void UArray2_map_row_major(T uarray2, void apply(int col, int row,
 extern void UArray2_map_col_major(T uarray2, void apply(int col, int row, 
                             T uarray2, void *element_at, void *cl), void *cl);
 
+extern UArray2_view UArray2_view_of(T uarray2, int col, int row, int width,
+                                                                int height);
+extern UArray2_view UArray2_view_sub(UArray2_view view, int col, int row, 
+                                                    int width, int height);
+extern int UArray2_view_width(UArray2_view view);
+extern int UArray2_view_height(UArray2_view view);
+extern int UArray2_view_size(UArray2_view view);
+extern void *UArray2_view_at(UArray2_view view, int col, int row);
+extern void *UArray2_view_row(UArray2_view view, int row);
+extern void UArray2_view_map_row_major(UArray2_view view, void apply(int col,
+                int row, UArray2_view view, void *element_at, void *cl), 
+                                                                void *cl);
+extern void UArray2_view_map_col_major(UArray2_view view, void apply(int col,
+                int row, UArray2_view view, void *element_at, void *cl), 
+                                                                void *cl);
+
 
 #undef T
 #endif
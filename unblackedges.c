@@ -5,19 +5,92 @@
  *
  *     Summary: Uses bit2.h interface to implement a program that removes black
  *              edges
+ *
+ *     Usage: unblackedges [-s] [-r] [-c] [-p] [-z] [-H] [-t level] 
+ *                         [-j threads] [-m op:WxH ...] [-a files] 
+ *                         [file.pbm ...]
+ *              Input may be gzip compressed (or zstd, when built with
+ *              ZSTREAM_ZSTD); it is decompressed on a thread of its own.
+ *              It may hold several images one after another, and the
+ *              output then holds the cleaned images in the same order.
+ *              Several files are cleaned one after another, into the one
+ *              output, while the next few are read ahead into memory
+ *              -s: add a comment line to the output header with the number
+ *                  of pixels cleared, the number of border components, and
+ *                  the amount and bounding box of the black that is left
+ *              -r: write a raw (P4) pbm, one bit per pixel, instead of P1
+ *              -c: crop the output to the bounding box of the black pixels
+ *                  left after cleaning
+ *              -p: pipelined: read and clean on separate threads, 
+ *                  cleaning each block of rows as soon as it is read
+ *              -z: gzip the output
+ *              -H: keep large images on huge (2 MiB) pages where the 
+ *                  system has them, to cut TLB misses on big scans
+ *              -t level: for a graymap (P2 or P5) input, pixels darker than
+ *                  level are black. Without -t the level is chosen by 
+ *                  Otsu's method from the histogram of the page, and -p 
+ *                  is ignored, since no row can be thresholded until the 
+ *                  whole page has been read
+ *              -j threads: read the whole input into memory first, and 
+ *                  decode a plain (P1 or P2) raster on this many threads.
+ *                  -p is ignored for plain input, which is read by then.
+ *                  Each thread writes its own band of rows of the image, 
+ *                  and a large image's memory is left untouched until 
+ *                  then, so on a NUMA machine each band starts out on the 
+ *                  node of the thread that decoded it (except with Otsu's
+ *                  method, where the rows are written once the level is 
+ *                  known, on one thread). A raw (P4 or P5) raster is 
+ *                  decoded on one thread as usual, so -j does nothing for
+ *                  it
+ *              -m op:WxH: after the edges are removed, apply a morphology
+ *                  op (erode, dilate, open or close) with a W x H 
+ *                  rectangle, e.g. -m open:3x3 to drop specks. May be given
+ *                  up to 8 times; the steps run in order
+ *              -a files: with several files, how many to read ahead (8 
+ *                  unless given). The reads go through io_uring when built
+ *                  with PREFETCH_URING, and a pool of threads otherwise
+ *
+ *            unblackedges -S socket [-w workers] [options]
+ *              Serves on a Unix domain socket instead: every connection 
+ *              sends one pbm and gets back the cleaned pbm. Requests are
+ *              run by a pool of worker processes (4 unless -w is given)
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <ctype.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <pnmrdr.h>
 #include "bit2.h"
 #include "stack.h"
+#include "server.h"
+#include "ring.h"
+#include "morph.h"
+#include "pool.h"
+#include "prefetch.h"
+#include "plainpnm.h"
+#include "zstream.h"
 #include <stdbool.h>
 
-const int MARKED = 1;
 const int WHITE = 0; 
+const int DEFAULT_WORKERS = 4;
+const int OTSU = -1;
+const int DEFAULT_READ_AHEAD = 8;
+
+/* 
+ * size of the row blocks passed between the threads of a pipelined run. A 
+ * multiple of 64, so that with the chunked Bit2 the reader and the cleaner
+ * never write to the same band of chunks
+ */
+const int ROWS_PER_BLOCK = 64;
+const int RING_BLOCKS = 64;
+
+#define MAX_MORPH_STEPS 8
 
 struct bit_position {
         int col;
@@ -26,62 +99,525 @@ struct bit_position {
 
 typedef struct bit_position *bp;
 
+/* 
+ * What remove_black_edges did to one image. The content fields are only
+ * filled in by content_stats
+ */
+struct edge_stats {
+        long cleared;           /* black pixels turned white */
+        int components;         /* black regions touching the border */
+        long remaining;         /* black pixels left in the image */
+        bool has_content;       /* whether any black pixels are left */
+        int left, top, right, bottom;   /* bounding box of what is left */
+};
+
+/* 
+ * A run of pixels in one row, from column left to column right, and the 
+ * border component it belongs to
+ */
+struct span {
+        int left;
+        int right;
+        int row;
+        int label;
+};
+
+/* 
+ * A scanline flood fill over the rows of image read so far. Spans whose row
+ * below has not been read yet wait on the deferred stack.
+ *
+ * Each border component gets a label when its fill starts. Two components 
+ * whose regions only meet below the rows read so far are found to be one 
+ * when the later rows arrive, and their labels are then joined: parent 
+ * holds a union-find forest over the labels, and owner records which 
+ * label filled each pixel of the first row of the latest block
+ */
+struct fill {
+        Bit2_T image;
+        Stack_T seeds;          /* bit_positions still to be filled */
+        Stack_T deferred;       /* spans waiting for the next row */
+        int rows_ready;         /* rows [0, rows_ready) have been read */
+        int first_new;          /* first row of the latest block */
+        int label;              /* label of the component being filled */
+        int *parent;            /* each label's parent, or itself */
+        int num_labels;
+        int capacity;           /* of parent */
+        int *owner;             /* label per pixel of row first_new, or -1 */
+        struct edge_stats *stats;
+};
+
+/* One -m step: a morphology operation and its structuring element */
+struct morph_step {
+        void (*op)(Bit2_T image, int se_width, int se_height, Pool_T pool);
+        int se_width;
+        int se_height;
+};
+
+/* What the command line asked for */
+struct options {
+        bool show_stats;        /* -s: statistics comment in the header */
+        bool raw_output;        /* -r: P4 instead of P1 */
+        bool crop;              /* -c: crop to the remaining content */
+        bool pipelined;         /* -p: read and clean on 2 threads */
+        bool compress;          /* -z: gzip the output */
+        bool huge_pages;        /* -H: images on huge pages */
+        const char **filenames; /* input files; with none, stdin */
+        int num_files;
+        const char *socket_path;        /* -S: serve on this socket */
+        int workers;            /* -w: worker processes when serving */
+        int threshold;          /* -t: graymap level, or OTSU */
+        int threads;            /* -j: threads decoding plain rasters */
+        int read_ahead;         /* -a: files read ahead of the current one */
+        struct morph_step morph[MAX_MORPH_STEPS];       /* -m, in order */
+        int num_morph;
+};
+
+/* The whole input, read into memory for -j */
+struct buffered_input {
+        char *bytes;
+        size_t length;
+};
+
+/* The state one server worker keeps between requests */
+struct worker {
+        struct options *opts;
+        Pool_T pool;
+};
+
+/* A rectangle of an image: its top left corner and its size */
+struct region {
+        int left;
+        int top;
+        int width;
+        int height;
+};
+
+/* 
+ * Shared by the reader and cleaner threads of a pipelined run. Only row 
+ * numbers travel through the ring; the rows themselves stay in image
+ */
+struct pipeline {
+        Pnmrdr_T input;
+        Bit2_T image;
+        Ring_T decoded;         /* blocks read in, for the cleaner */
+        struct options *opts;
+};
+
+struct options parse_options(int argc, char *argv[]);
+struct morph_step parse_morph_step(const char *arg);
+void serve_image(FILE *in, FILE *out, void *cl);
+void clean_files(struct options *opts, Pool_T pool);
+void clean_stream(FILE *in, FILE *out, struct options *opts, Pool_T pool);
+void clean_image(FILE *in, struct buffered_input *buffered, FILE *out, 
+                                struct options *opts, Pool_T pool);
+bool more_images(FILE *in);
+
 void check_pbm_format(Pnmrdr_mapdata input_data);
-Bit2_T image_2D_array(Pnmrdr_T input, Pnmrdr_mapdata input_data);
-void insert_pbm_into_array(int col, int row, Bit2_T image, int bit, 
-                                                            void *input);
+void image_2D_array(Pnmrdr_T input, Pnmrdr_mapdata input_data, 
+                                        Bit2_T image, int threshold);
+Pool_T new_pool(struct options *opts);
+void decode_row(Pnmrdr_T input, Pnmrdr_mapdata input_data, int threshold,
+                                                        uint64_t *words);
+void plain_2D_array(const char *text, size_t length, 
+                    Pnmrdr_mapdata input_data, Bit2_T image, 
+                    struct options *opts, size_t *used);
+void put_plain_row(unsigned row, const uint64_t *words, void *cl);
+char *read_input(FILE *in, size_t *length);
+void threshold_otsu(Pnmrdr_T input, Pnmrdr_mapdata input_data, 
+                                                        Bit2_T image);
+void threshold_samples(const uint16_t *samples, unsigned long *histogram, 
+                       Pnmrdr_mapdata input_data, Bit2_T image);
+unsigned otsu_level(const unsigned long *histogram, unsigned maxval);
 
-void remove_black_edges(Bit2_T image);
-void connected_black_edge(int col, int row, Bit2_T image, int bit, 
-                                                            void *black_edges);
+void remove_black_edges(Bit2_T image, struct edge_stats *stats);
+void start_fill(struct fill *fill, Bit2_T image, struct edge_stats *stats);
+void end_fill(struct fill *fill);
+void fill_new_rows(struct fill *fill, int num_rows);
+void fill_border_component(struct fill *fill, int col, int row);
+long drain_seeds(struct fill *fill);
+long fill_span(struct fill *fill, int col, int row);
+void push_run_seeds(struct fill *fill, int left, int right, int row);
+int new_label(struct fill *fill);
+int find_label(struct fill *fill, int label);
+void join_labels(struct fill *fill, int label1, int label2);
 
 bp make_bp(int col, int row);
-bool is_black_edge(int col, int row, Bit2_T image);
-void free_structs_in_stack(Stack_T stack);
-bool valid_black_bit(int col, int row, Bit2_T image, Bit2_T visited_bits);
-bool visited(Bit2_T visited_bits, int col, int row);
+struct span *make_span(int left, int right, int row, int label);
+
+void clean_pipelined(Pnmrdr_T input, struct options *opts, Bit2_T image, 
+                                        struct edge_stats *stats);
+void *read_rows(void *cl);
 
-void print_one_bit(int col, int row, Bit2_T image, int bit, void *input);
+void apply_morphology(Bit2_T image, struct options *opts, Pool_T pool);
+void content_stats(Bit2_T image, struct edge_stats *stats);
+
+struct region output_region(Bit2_T image, bool crop, 
+                                                struct edge_stats *stats);
+void print_header(FILE *out, struct region region, bool raw_output, 
+                                                struct edge_stats *stats);
+void print_plain_rows(FILE *out, Bit2_T image, struct region region);
+void print_raw_rows(FILE *out, Bit2_T image, struct region region);
 
 
 int main(int argc, char *argv[]) 
 {
-        assert(argc == 1 || argc == 2);
-	FILE *input_file;
+        struct options opts = parse_options(argc, argv);
+
+        if (opts.socket_path != NULL) {
+                struct worker worker = { &opts, new_pool(&opts) };
+                Server_run(opts.socket_path, opts.workers, serve_image, 
+                                                                &worker);
+                exit(EXIT_SUCCESS);
+        }
+
+        Pool_T pool = new_pool(&opts);
+        if (opts.num_files > 1) {
+                clean_files(&opts, pool);
+        } else {
+                FILE *input_file;
+
+                if (opts.num_files == 0) {
+                        input_file = stdin;
+                } else { 
+                        input_file = fopen(opts.filenames[0], "r");
+                        assert(input_file != NULL);
+                }
+                clean_stream(input_file, stdout, &opts, pool);
+                fclose(input_file);
+        }
+
+        /* freeing memory */
+        Pool_free(&pool);
+        free(opts.filenames);
+
+        exit(EXIT_SUCCESS);
+}
+
+/**********parse_options********
+ *
+ * Reads the command line into a struct options
+ * Inputs:
+ *              int argc: number of command line arguments
+ *              char *argv[]: the command line arguments
+ * Return: the options given, with defaults for those that were not
+ * Expects:
+ *      -S, -w, -t, -j, -m and -a to be followed by a value
+ * Notes:
+ *      * Checked runtime error if an option is missing its value, the 
+ *      worker, thread or read ahead count is not positive, the -t level is
+ *      negative, or a -m step is malformed or there are more than 
+ *      MAX_MORPH_STEPS of them
+ *      * The file names are collected in opts.filenames, which the client
+ *      must free
+ ************************/
+struct options parse_options(int argc, char *argv[])
+{
+        struct options opts = { false, false, false, false, false, false,
+                                NULL, 0, NULL, 
+                                DEFAULT_WORKERS, OTSU, 1, DEFAULT_READ_AHEAD,
+                                { { NULL, 0, 0 } }, 0 };
+        opts.filenames = malloc(argc * sizeof(*opts.filenames));
+        assert(opts.filenames != NULL);
+
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "-s") == 0) {
+                        opts.show_stats = true;
+                } else if (strcmp(argv[i], "-r") == 0) {
+                        opts.raw_output = true;
+                } else if (strcmp(argv[i], "-c") == 0) {
+                        opts.crop = true;
+                } else if (strcmp(argv[i], "-p") == 0) {
+                        opts.pipelined = true;
+                } else if (strcmp(argv[i], "-z") == 0) {
+                        opts.compress = true;
+                } else if (strcmp(argv[i], "-H") == 0) {
+                        opts.huge_pages = true;
+                } else if (strcmp(argv[i], "-S") == 0) {
+                        assert(i + 1 < argc);
+                        opts.socket_path = argv[++i];
+                } else if (strcmp(argv[i], "-w") == 0) {
+                        assert(i + 1 < argc);
+                        opts.workers = atoi(argv[++i]);
+                        assert(opts.workers > 0);
+                } else if (strcmp(argv[i], "-t") == 0) {
+                        assert(i + 1 < argc);
+                        opts.threshold = atoi(argv[++i]);
+                        assert(opts.threshold >= 0);
+                } else if (strcmp(argv[i], "-j") == 0) {
+                        assert(i + 1 < argc);
+                        opts.threads = atoi(argv[++i]);
+                        assert(opts.threads > 0);
+                } else if (strcmp(argv[i], "-m") == 0) {
+                        assert(i + 1 < argc);
+                        assert(opts.num_morph < MAX_MORPH_STEPS);
+                        opts.morph[opts.num_morph++] = 
+                                                parse_morph_step(argv[++i]);
+                } else if (strcmp(argv[i], "-a") == 0) {
+                        assert(i + 1 < argc);
+                        opts.read_ahead = atoi(argv[++i]);
+                        assert(opts.read_ahead > 0);
+                } else {
+                        opts.filenames[opts.num_files++] = argv[i];
+                }
+        }
+        return opts;
+}
+
+/**********parse_morph_step********
+ *
+ * Reads the value of a -m option
+ * Inputs:
+ *              const char *arg: a step of the form op:WxH, where op is 
+ *                               erode, dilate, open or close
+ * Return: the step described by arg
+ * Expects:
+ *      arg to be nonnull
+ * Notes:
+ *      Checked runtime error if arg is not of that form, or W or H is not 
+ *      positive
+ ************************/
+struct morph_step parse_morph_step(const char *arg)
+{
+        char name[8];
+        struct morph_step step = { NULL, 0, 0 };
+        char extra;
+        int fields = sscanf(arg, "%7[a-z]:%dx%d%c", name, &step.se_width, 
+                                                &step.se_height, &extra);
+        assert(fields == 3);
+        assert(step.se_width > 0 && step.se_height > 0);
+
+        if (strcmp(name, "erode") == 0) {
+                step.op = Morph_erode;
+        } else if (strcmp(name, "dilate") == 0) {
+                step.op = Morph_dilate;
+        } else if (strcmp(name, "open") == 0) {
+                step.op = Morph_open;
+        } else if (strcmp(name, "close") == 0) {
+                step.op = Morph_close;
+        }
+        assert(step.op != NULL);
+        return step;
+}
+
+/**********serve_image********
+ *
+ * Server_handler that cleans the pbm sent on one connection
+ * Inputs:
+ *              FILE *in: the connection, carrying a pbm
+ *              FILE *out: the connection, for the cleaned pbm
+ *              void *cl: the struct worker of the worker process running
+ *                        the request
+ * Return: N/A
+ * Expects:
+ *      in, out and cl to be nonnull
+ * Notes:
+ *      The worker's pool is kept for the next request, so once it has 
+ *      served its largest page it serves the rest without allocating
+ ************************/
+void serve_image(FILE *in, FILE *out, void *cl)
+{
+        struct worker *worker = cl;
+        clean_stream(in, out, worker->opts, worker->pool);
+}
+
+/**********clean_files********
+ *
+ * Cleans every pbm in every input file, in order, onto stdout
+ * Inputs:
+ *              struct options *opts: the input files and output options
+ *              Pool_T pool: as for clean_image
+ * Return: N/A
+ * Expects:
+ *      opts and pool to be nonnull
+ * Notes:
+ *      * The next opts->read_ahead files are read while one is cleaned, 
+ *      so storage that is slow to answer only holds up the first file
+ *      * Each file is cleaned from memory as by clean_stream, and freed 
+ *      once done
+ *      * Checked runtime error if a file cannot be opened or read
+ ************************/
+void clean_files(struct options *opts, Pool_T pool)
+{
+        Prefetch_T prefetch = Prefetch_new(opts->filenames, opts->num_files,
+                                                        opts->read_ahead);
+        Prefetch_file file;
+        while (Prefetch_next(prefetch, &file)) {
+                FILE *in = fmemopen(file.bytes, file.length, "r");
+                assert(in != NULL);
+                clean_stream(in, stdout, opts, pool);
+                fclose(in);
+                free(file.bytes);
+        }
+        Prefetch_free(&prefetch);
+}
 
-        if (argc == 1) {
-                input_file = stdin;
-        } else { 
-                input_file = fopen(argv[1], "r");
-                assert(input_file != NULL);
+/**********clean_stream********
+ *
+ * Cleans every pbm on a stream that may be compressed, compressing the 
+ * output if -z was given
+ * Inputs:
+ *              FILE *in: stream holding the pbms, plain or compressed
+ *              FILE *out: stream the cleaned pbms are printed to
+ *              struct options *opts: the output options
+ *              Pool_T pool: as for clean_image
+ * Return: N/A
+ * Expects:
+ *      in, out, opts and pool to be nonnull
+ * Notes:
+ *      * Compressed input is decompressed on its own thread, which feeds
+ *      the parser through a pipe, so no temporary file is written
+ *      * With -z, out has all of the compressed output when this returns
+ *      * With -j the whole of the input is read first, and the images are
+ *      parsed from memory
+ *      * Every image is read into the same Bit2_array from pool, resized 
+ *      as needed
+ ************************/
+void clean_stream(FILE *in, FILE *out, struct options *opts, Pool_T pool)
+{
+        Zstream_T unzip = Zstream_decompress(in);
+        Zstream_T zip = opts->compress ? Zstream_compress(out) : NULL;
+
+        FILE *source = unzip != NULL ? Zstream_file(unzip) : in;
+        FILE *sink = zip != NULL ? Zstream_file(zip) : out;
+
+        struct buffered_input buffered = { NULL, 0 };
+        if (opts->threads > 1) {
+                buffered.bytes = read_input(source, &buffered.length);
+                source = fmemopen(buffered.bytes, buffered.length, "r");
+                assert(source != NULL);
         }
 
+        do {
+                clean_image(source, buffered.bytes != NULL ? &buffered 
+                                                           : NULL, 
+                            sink, opts, pool);
+        } while (more_images(source));
+
+        if (buffered.bytes != NULL) {
+                fclose(source);
+                free(buffered.bytes);
+        }
+        Zstream_close(&unzip);
+        Zstream_close(&zip);
+}
+
+/**********clean_image********
+ *
+ * Reads one pbm (or pgm), removes its black edges, and prints the result
+ * Inputs:
+ *              FILE *in: stream holding the pbm or pgm, which is read up 
+ *                        to the end of its raster
+ *              struct buffered_input *buffered: the input in memory, which 
+ *                                               in reads from, or NULL
+ *              FILE *out: stream the cleaned pbm is printed to
+ *              struct options *opts: the output options
+ *              Pool_T pool: where the image and all working space are 
+ *                           taken from, and given back to
+ * Return: N/A
+ * Expects:
+ *      in, out, opts and pool to be nonnull
+ * Notes:
+ *      * The image is taken from pool, cleared, and given back once the pbm
+ *      is printed, so the next pbm reuses its memory
+ *      * Exits with EXIT_FAILURE on a badly formatted pbm, as in 
+ *      check_pbm_format
+ *      * With -p, reading and removing the edges are handed to 
+ *      clean_pipelined, unless the input is a pgm whose threshold has to be
+ *      found by Otsu's method
+ *      * With the input in memory, a plain raster is decoded by 
+ *      plain_2D_array, and in is then moved past it. Where the raster 
+ *      starts is worked out from the bytes in memory, not from how far 
+ *      Pnmrdr has read in
+ ************************/
+void clean_image(FILE *in, struct buffered_input *buffered, FILE *out, 
+                                struct options *opts, Pool_T pool)
+{
+        /* where the image starts, before Pnmrdr reads any of it */
+        long start = buffered != NULL ? ftell(in) : 0;
+        assert(start >= 0 && (size_t)start <= 
+                                (buffered != NULL ? buffered->length : 0));
+        size_t header = buffered != NULL ? 
+                        Plainpnm_header(buffered->bytes + start, 
+                                        buffered->length - start) : 0;
+
         /* check format of pbm */
-	Pnmrdr_T input = Pnmrdr_new(input_file);
+	Pnmrdr_T input = Pnmrdr_new(in);
         Pnmrdr_mapdata input_data = Pnmrdr_data(input);
         check_pbm_format(input_data);
+        Bit2_T image = Pool_get_bit2(pool, input_data.width, 
+                                                        input_data.height);
 
-        /* turn pbm into a 2D bit array */
-        Bit2_T image = image_2D_array(input, input_data);
+        bool plain = header > 0;
+        bool pipelined = opts->pipelined && plain == false && 
+                         (input_data.type == Pnmrdr_bit || 
+                          opts->threshold != OTSU);
 
-        remove_black_edges(image);
+        /* turn pbm into a 2D bit array, and remove its black edges */
+        struct edge_stats stats;
+        if (plain) {
+                size_t raster = start + header;
+                size_t used;
+                plain_2D_array(buffered->bytes + raster, 
+                               buffered->length - raster, input_data, image, 
+                               opts, &used);
+                fseek(in, raster + used, SEEK_SET);
+        } else if (pipelined) {
+                clean_pipelined(input, opts, image, &stats);
+        } else {
+                image_2D_array(input, input_data, image, opts->threshold);
+        }
+        Pnmrdr_free(&input);
+        if (!pipelined) {
+                remove_black_edges(image, &stats);
+        }
+
+        apply_morphology(image, opts, pool);
+        if (opts->show_stats || opts->crop) {
+                content_stats(image, &stats);
+        }
 
         /* printing output */
-        printf("P1\n# file without black edges\n%i %i\n", 
-                        Bit2_width(image), Bit2_height(image));
-        Bit2_map_row_major(image, print_one_bit, NULL);
+        struct region region = output_region(image, opts->crop, &stats);
+        print_header(out, region, opts->raw_output, 
+                                        opts->show_stats ? &stats : NULL);
+        if (opts->raw_output) {
+                print_raw_rows(out, image, region);
+        } else {
+                print_plain_rows(out, image, region);
+        }
+        Pool_put_bit2(pool, image);
+}
 
-        /* freeing memory */
-        Pnmrdr_free(&input);
-        Bit2_free(&image);
-	fclose(input_file);
+/**********more_images********
+ *
+ * Checks whether another image follows on a stream
+ * Inputs:
+ *              FILE *in: the stream, just past the raster of an image
+ * Return: true if anything but whitespace is left on in
+ * Expects:
+ *      in to be nonnull
+ * Notes:
+ *      Whitespace is skipped, and the first byte of the next image is 
+ *      put back
+ ************************/
+bool more_images(FILE *in)
+{
+        int c;
+        do {
+                c = getc(in);
+        } while (c != EOF && isspace(c));
 
-        exit(EXIT_SUCCESS);
+        if (c == EOF) {
+                return false;
+        }
+        ungetc(c, in);
+        return true;
 }
 
 /**********check_pbm_format********
  *
- * Checks that the filename provided is a correct portable bitmap file
+ * Checks that the filename provided is a correct portable bitmap or 
+ * graymap file
  * Inputs:
  *              Pnmrdr_mapdata input_data: input_data is an instance of a 
  *                                         struct of type Pnmrdr_mapdata, 
@@ -91,17 +627,18 @@ int main(int argc, char *argv[])
  *                                         being inputted.
  * Return: N/A
  * Expects:
- *      * type of input_data to be a pbm (value = 1)
+ *      * type of input_data to be a pbm (value = 1) or pgm (value = 2)
  *      * width and height to be 0
  * Notes:
  *      Checked runtime error if:
- *              * type of input_data != 1 (not of type pbm)
+ *              * type of input_data is neither pbm nor pgm
  *      Exits with EXIT_FAILURE if width or height are nonzero  
  ************************/
 void check_pbm_format(Pnmrdr_mapdata input_data) 
 {
-        /* check if it's a pbm */
-	assert(input_data.type == 1);
+        /* check if it's a pbm or pgm */
+	assert(input_data.type == Pnmrdr_bit || 
+               input_data.type == Pnmrdr_gray);
 
 	if (input_data.width == 0 || input_data.height == 0) {
                 exit(EXIT_FAILURE);
@@ -110,61 +647,328 @@ void check_pbm_format(Pnmrdr_mapdata input_data)
 
 /**********image_2D_array********
  *
- * Creates, allocates and populates a new Bit2_array with values from the pbm 
- * input file. The Bit2_array that holds these values represents the bitmap to
- * be converted.
+ * Populates a Bit2_array with values from the pbm input file. The 
+ * Bit2_array that holds these values represents the bitmap to be converted.
  * Inputs:
- *              Pnmrdr_T input: input will be passed as a closure to the map 
- *                              function in order to read in the bits from an
- *                              input file
+ *              Pnmrdr_T input: reader positioned at the start of the raster
  *              Pnmrdr_mapdata input_data: input_data is an instance of a 
  *                                         struct of type Pnmrdr_mapdata, 
  *                                         which is used in the function to
  *                                         access the values associated with 
  *                                         the pbm file that is inputted
- * Return: A Bit2_array that is populated with the values in the pbm file
+ *              Bit2_T image: set to the black pixels of the pbm
+ *              int threshold: for a pgm, the level below which a pixel is
+ *                             black, or OTSU
+ * Return: N/A
  * Expects:
- *      * input_data.width and input_data.height to be nonnegative
+ *      * image to be nonnull and input_data.width x input_data.height
  * Notes:
- *      * Bit2_array image_array is allocated memory in this function. 
- *      * The client must use Bit2_free once the memory is no longer needed
+ *      Rows are decoded into packed words and stored a row at a time. A
+ *      pgm is thresholded as it is decoded, so no bitmap of it is ever 
+ *      written out
  ************************/
-Bit2_T image_2D_array(Pnmrdr_T input, Pnmrdr_mapdata input_data) 
+void image_2D_array(Pnmrdr_T input, Pnmrdr_mapdata input_data, 
+                                        Bit2_T image, int threshold) 
 {
-        Bit2_T image_array = Bit2_new(input_data.width, input_data.height);
-        Bit2_map_row_major(image_array, insert_pbm_into_array, &input);
-        return image_array;
+        if (input_data.type == Pnmrdr_gray && threshold == OTSU) {
+                threshold_otsu(input, input_data, image);
+                return;
+        }
+
+        uint64_t *words = malloc((input_data.width + 63) / 64 * 
+                                                        sizeof(uint64_t));
+        assert(words != NULL);
+        for (unsigned row = 0; row < input_data.height; row++) {
+                decode_row(input, input_data, threshold, words);
+                Bit2_put_row_words(image, row, words);
+        }
+        free(words);
 }
 
-/**********insert_pbm_into_array********
+/**********new_pool********
  *
- * Inserts a value in the pbm file into the Bit2_array at a given position 
- * defined by (col, row)
+ * Creates the pool that every image, and the working space for -m, is 
+ * taken from
  * Inputs:
- *              int col: column value where element will be inserted
- *              int row: row value where element will be inserted
- *              Bit2_T image: Pointer to the Bit2_array where value will be 
- *                            inserted
- *              int bit: integer value of bit at given position (either 1 or 0)
- *                       (not used)
- *              void *input: a closure value, in this case it is a pointer to 
- *                           a struct of type Pnmrdr_T, which is used to enable
- *                           access to each value in the pbm file
+ *              struct options *opts: the command line options
+ * Return: an empty pool
+ * Expects:
+ *      opts to be nonnull
+ * Notes:
+ *      Its arrays are allocated on huge pages with -H, and left for the -j
+ *      decoding threads to first touch, whenever one grows large enough 
+ *      for that to matter
+ ************************/
+Pool_T new_pool(struct options *opts)
+{
+        Bigmem_policy policy = { opts->huge_pages, opts->threads > 1 };
+        return Pool_new(policy);
+}
+
+/**********decode_row********
+ *
+ * Reads the next row of the raster as packed bits, black as 1
+ * Inputs:
+ *              Pnmrdr_T input: reader positioned at the start of a row
+ *              Pnmrdr_mapdata input_data: the header of the input
+ *              int threshold: for a pgm, the level below which a pixel is
+ *                             black (ignored for a pbm)
+ *              uint64_t *words: set to the row, laid out as for 
+ *                               Bit2_put_row_words
  * Return: N/A
- * Expects: 
- *      None
+ * Expects:
+ *      words to hold (input_data.width + 63) / 64 words; threshold not to
+ *      be OTSU for a pgm
+ * Notes:
+ *      Raises Pnmrdr_Count if the raster ends early
+ ************************/
+void decode_row(Pnmrdr_T input, Pnmrdr_mapdata input_data, int threshold,
+                                                        uint64_t *words)
+{
+        bool gray = input_data.type == Pnmrdr_gray;
+        assert(gray == false || threshold != OTSU);
+
+        unsigned width = input_data.width;
+        for (unsigned w = 0; w < (width + 63) / 64; w++) {
+                uint64_t word = 0;
+                unsigned end = (w + 1) * 64 < width ? (w + 1) * 64 : width;
+                for (unsigned col = w * 64; col < end; col++) {
+                        unsigned sample = Pnmrdr_get(input);
+                        bool black = gray ? sample < (unsigned)threshold 
+                                          : sample == 1;
+                        word |= (uint64_t)black << (col % 64);
+                }
+                words[w] = word;
+        }
+}
+
+/**********plain_2D_array********
+ *
+ * Decodes a plain (P1 or P2) raster held in memory into a Bit2_array, on
+ * several threads
+ * Inputs:
+ *              const char *text: the raster, just after the header
+ *              size_t length: the length of text
+ *              Pnmrdr_mapdata input_data: the header of the input
+ *              Bit2_T image: set to the black pixels of the raster
+ *              struct options *opts: the -t level and -j thread count
+ *              size_t *used: set to how much of text the raster took up
+ * Return: N/A
+ * Expects:
+ *      text, image and opts to be nonnull; image to be the size of the 
+ *      raster
+ * Notes:
+ *      * Raises Pnmrdr_Badformat or Pnmrdr_Count on a bad raster, as 
+ *      Pnmrdr_get would
+ *      * Bits are decoded straight into image, each decoding thread 
+ *      writing a band of rows of its own; only with Otsu's method are the
+ *      samples decoded first and thresholded into image afterwards
+ ************************/
+void plain_2D_array(const char *text, size_t length, 
+                    Pnmrdr_mapdata input_data, Bit2_T image, 
+                    struct options *opts, size_t *used)
+{
+        Plainpnm_raster raster = { text, length, input_data.width, 
+                                   input_data.height, 
+                                   input_data.type == Pnmrdr_gray };
+
+        if (raster.gray && opts->threshold == OTSU) {
+                uint16_t *samples = Plainpnm_samples(raster, opts->threads, 
+                                                                used);
+                threshold_samples(samples, NULL, input_data, image);
+                free(samples);
+                return;
+        }
+
+        Plainpnm_bits(raster, opts->threshold, opts->threads, put_plain_row,
+                                                        image, used);
+}
+
+/**********put_plain_row********
+ *
+ * Stores a row decoded by Plainpnm_bits in the image
+ * Inputs:
+ *              unsigned row: the row
+ *              const uint64_t *words: its bits, laid out as for 
+ *                                     Bit2_put_row_words
+ *              void *cl: the Bit2_T image
+ * Return: N/A
+ * Expects:
+ *      words and cl to be nonnull
+ * Notes:
+ *      Called on the decoding threads at once. Both Bit2 implementations 
+ *      allow that, as rows in the same band of 64 come from one thread
+ ************************/
+void put_plain_row(unsigned row, const uint64_t *words, void *cl)
+{
+        Bit2_put_row_words(cl, row, words);
+}
+
+/**********read_input********
+ *
+ * Reads a stream to its end
+ * Inputs:
+ *              FILE *in: the stream to read
+ *              size_t *length: set to the number of bytes read
+ * Return: the bytes read
+ * Expects:
+ *      in and length to be nonnull
+ * Notes:
+ *      * Checked runtime error if memory cannot be allocated
+ *      * The client must free the bytes
+ ************************/
+char *read_input(FILE *in, size_t *length)
+{
+        size_t capacity = 1 << 16;
+        size_t used = 0;
+        char *buffer = malloc(capacity);
+        assert(buffer != NULL);
+
+        for (;;) {
+                used += fread(buffer + used, 1, capacity - used, in);
+                if (used < capacity) {
+                        break;
+                }
+                capacity *= 2;
+                buffer = realloc(buffer, capacity);
+                assert(buffer != NULL);
+        }
+        *length = used;
+        return buffer;
+}
+
+/**********threshold_otsu********
+ *
+ * Reads a pgm raster into image, choosing the threshold by Otsu's method
+ * Inputs:
+ *              Pnmrdr_T input: reader positioned at the start of the raster
+ *              Pnmrdr_mapdata input_data: the header of the pgm
+ *              Bit2_T image: a Bit2_array the size of the pgm
+ * Return: N/A
+ * Expects:
+ *      input and image to be nonnull
+ * Notes:
+ *      * The histogram is gathered during the one read of the raster. The
+ *      samples are kept, two bytes each, until the level is known
+ *      * Checked runtime error if memory cannot be allocated
+ ************************/
+void threshold_otsu(Pnmrdr_T input, Pnmrdr_mapdata input_data, 
+                                                        Bit2_T image)
+{
+        size_t num_samples = (size_t)input_data.width * input_data.height;
+        uint16_t *samples = malloc(num_samples * sizeof(uint16_t));
+        unsigned long *histogram = calloc(input_data.denominator + 1, 
+                                                sizeof(unsigned long));
+        assert(samples != NULL && histogram != NULL);
+
+        for (size_t i = 0; i < num_samples; i++) {
+                unsigned sample = Pnmrdr_get(input);
+                assert(sample <= input_data.denominator);
+                samples[i] = sample;
+                histogram[sample]++;
+        }
+
+        threshold_samples(samples, histogram, input_data, image);
+        free(samples);
+        free(histogram);
+}
+
+/**********threshold_samples********
+ *
+ * Thresholds the samples of a pgm into image, at the level chosen by 
+ * Otsu's method
+ * Inputs:
+ *              const uint16_t *samples: the samples, in row-major order
+ *              unsigned long *histogram: the count of each level among the
+ *                                        samples, or NULL to count them here
+ *              Pnmrdr_mapdata input_data: the header of the pgm
+ *              Bit2_T image: a Bit2_array the size of the pgm
+ * Return: N/A
+ * Expects:
+ *      samples and image to be nonnull
  * Notes:
- *      * Used as an apply function for map_row_major, so it will iterate 
- *      through and insert every value from the pbm file into the Bit2_array
+ *      Checked runtime error if a sample is over the pgm's maxval, or 
+ *      memory cannot be allocated
  ************************/
-void insert_pbm_into_array(int col, int row, Bit2_T image, int bit, 
-                                                             void *input)
+void threshold_samples(const uint16_t *samples, unsigned long *histogram, 
+                       Pnmrdr_mapdata input_data, Bit2_T image)
 {
-        (void)bit;
-        int prev_bit = Bit2_put(image, col, row, 
-                                        Pnmrdr_get(*(Pnmrdr_T *)input));
-        (void)prev_bit;
-        
+        unsigned width = input_data.width;
+        unsigned height = input_data.height;
+        unsigned long *counted = NULL;
+        if (histogram == NULL) {
+                counted = calloc(input_data.denominator + 1, 
+                                                sizeof(unsigned long));
+                assert(counted != NULL);
+                size_t num_samples = (size_t)width * height;
+                for (size_t i = 0; i < num_samples; i++) {
+                        assert(samples[i] <= input_data.denominator);
+                        counted[samples[i]]++;
+                }
+                histogram = counted;
+        }
+        unsigned level = otsu_level(histogram, input_data.denominator);
+        free(counted);
+
+        uint64_t *words = malloc((width + 63) / 64 * sizeof(uint64_t));
+        assert(words != NULL);
+        for (unsigned row = 0; row < height; row++) {
+                const uint16_t *row_samples = samples + (size_t)row * width;
+                memset(words, 0, (width + 63) / 64 * sizeof(uint64_t));
+                for (unsigned col = 0; col < width; col++) {
+                        words[col / 64] |= (uint64_t)(row_samples[col] < 
+                                                level) << (col % 64);
+                }
+                Bit2_put_row_words(image, row, words);
+        }
+        free(words);
+}
+
+/**********otsu_level********
+ *
+ * Chooses the gray level that best splits a histogram into dark and light
+ * Inputs:
+ *              const unsigned long *histogram: the count of each level 
+ *                                              from 0 to maxval
+ *              unsigned maxval: the highest level
+ * Return: the level below which pixels are black
+ * Expects:
+ *      histogram to be nonnull
+ * Notes:
+ *      * Otsu's method: the split maximizes the variance between the two
+ *      classes, weight_dark * weight_light * (mean_dark - mean_light)^2, 
+ *      which one pass over the levels with running sums finds
+ *      * A page of a single level gives 1, so only level 0 is black
+ ************************/
+unsigned otsu_level(const unsigned long *histogram, unsigned maxval)
+{
+        double total = 0;
+        double total_sum = 0;
+        for (unsigned level = 0; level <= maxval; level++) {
+                total += histogram[level];
+                total_sum += (double)level * histogram[level];
+        }
+
+        double dark = 0;
+        double dark_sum = 0;
+        double best_variance = -1;
+        unsigned best_level = 0;
+        for (unsigned level = 0; level < maxval; level++) {
+                dark += histogram[level];
+                dark_sum += (double)level * histogram[level];
+                double light = total - dark;
+                if (dark == 0 || light == 0) {
+                        continue;
+                }
+
+                double gap = dark_sum / dark - (total_sum - dark_sum) / light;
+                double variance = dark * light * gap * gap;
+                if (variance > best_variance) {
+                        best_variance = variance;
+                        best_level = level;
+                }
+        }
+        return best_level + 1;
 }
 
 /**********remove_black_edges********
@@ -173,115 +977,386 @@ void insert_pbm_into_array(int col, int row, Bit2_T image, int bit,
  * Inputs:
  *              Bit2_T image: Pointer to the Bit2_array that stores the pixels
  *                            before they have been converted
+ *              struct edge_stats *stats: the number of pixels cleared and 
+ *                                        the number of border components are
+ *                                        recorded here
  * Return: N/A
  * Expects: 
- *      image to be nonnull
+ *      image and stats to be nonnull
  * Notes:
- *      * Memory is allocated for a new stack in this function
- *      * Each element popped from the stack is freed, as well as the stack 
- *      * itself
+ *      * Every black pixel on the border seeds a scanline flood fill. Since
+ *      filled pixels are turned white straight away, the image itself serves
+ *      as the visited map and no pixel is filled twice
+ *      * The fill is run over all rows at once; clean_pipelined runs the
+ *      same fill a block of rows at a time
  ************************/
-void remove_black_edges(Bit2_T image)
+void remove_black_edges(Bit2_T image, struct edge_stats *stats)
 {
-        Stack_T black_edges = Stack_new();
-        Bit2_map_row_major(image, connected_black_edge, &black_edges);
+        struct fill fill;
+        start_fill(&fill, image, stats);
+        fill_new_rows(&fill, Bit2_height(image));
+        end_fill(&fill);
+}
 
-        while (Stack_empty(black_edges) != 1) {
-               bp popped = (bp)Stack_pop(black_edges);
-               int prev_bit = Bit2_put(image, popped->col, popped->row, WHITE);
-               (void)prev_bit;
-               free(popped);
-        }
-        Stack_free(&black_edges);
+/**********start_fill********
+ *
+ * Sets up a flood fill over image, with no rows read yet
+ * Inputs:
+ *              struct fill *fill: the fill to set up
+ *              Bit2_T image: Pointer to the Bit2_array being cleaned
+ *              struct edge_stats *stats: where the cleared pixels and border
+ *                                        components are counted
+ * Return: N/A
+ * Expects:
+ *      fill, image and stats to be nonnull
+ * Notes:
+ *      Memory is allocated for the seed and deferred stacks and the label
+ *      arrays, which the client must free with end_fill
+ ************************/
+void start_fill(struct fill *fill, Bit2_T image, struct edge_stats *stats)
+{
+        assert(fill != NULL && stats != NULL);
+        fill->image = image;
+        fill->seeds = Stack_new();
+        fill->deferred = Stack_new();
+        fill->rows_ready = 0;
+        fill->first_new = 0;
+        fill->label = -1;
+        fill->parent = NULL;
+        fill->num_labels = 0;
+        fill->capacity = 0;
+        fill->owner = malloc((Bit2_width(image) + 1) * sizeof(int));
+        assert(fill->owner != NULL);
+        fill->stats = stats;
+
+        stats->cleared = 0;
+        stats->components = 0;
 }
 
-/**********connected_black_edge********
+/**********end_fill********
  *
- * Pushes all the edge coordinates that are either a black edge themself, or 
- * are connected to a black edge onto a stack passed in as a closure
+ * Frees the stacks and label arrays of a fill
  * Inputs:
- *              int col: column value of the bit being checked
- *              int row: row value of the bit being checked
- *              Bit2_T image: Pointer to the Bit2_array that stores the pixels
- *                            before they have been converted
- *              int bit: bit value at given position (0 or 1)
- *              void *black_edges: black_edges is passed as a closure. 
- *                                 black_edges is a pointer to a stack that 
- *                                 stores the final location of all pixels that
- *                                 are connected to a black edge
+ *              struct fill *fill: the fill to clean up
  * Return: N/A
- * Expects: 
- *      * image to be nonnull
- *      * bit to be 0 or 1
+ * Expects:
+ *      fill to be nonnull, and every row of its image to have been filled
  * Notes:
- *      * To be used in Bit2_map_row_major as an apply function
- *      * Memory is allocated for a new Bit2_array, and is then freed after 
- *      * going through every pixel
- *      * Memory is allocated for a new stack, and is then freed after all of 
- *      * its elements have been popped from the stack
- *      * Memory is allocated for one struct (original_bit) outside the 
- *      * while loop, and is then freed once the while loop concludes
- *      * Memory is allocated for a new struct everytime a new valid black 
+ *      Once every row has been filled nothing is left on the stacks
  ************************/
-void connected_black_edge(int col, int row, Bit2_T image, int bit, 
-                                                            void *black_edges)
+void end_fill(struct fill *fill)
 {
-        if (bit == 0) {
+        assert(fill != NULL);
+        assert(Stack_empty(fill->deferred) == 1);
+        Stack_free(&fill->seeds);
+        Stack_free(&fill->deferred);
+        free(fill->parent);
+        free(fill->owner);
+}
+
+/**********fill_new_rows********
+ *
+ * Extends a fill over the next num_rows rows of its image, which must have
+ * been read in already
+ * Inputs:
+ *              struct fill *fill: the fill being extended
+ *              int num_rows: how many more rows are ready
+ * Return: N/A
+ * Expects:
+ *      * fill to be nonnull
+ *      * rows_ready + num_rows to be at most the height of the image
+ * Notes:
+ *      * Spans that were waiting for the first new row are carried on 
+ *      before any new border pixels are filled, so a region reaching down
+ *      from earlier rows is not counted again
+ *      * Each waiting span is filled from before the next, so spans it 
+ *      defers in turn go on a new deferred stack
+ *      * A waiting span whose pixels below were already filled by another
+ *      component's span shows the two components are one, so their labels
+ *      are joined and the count goes down by one
+ ************************/
+void fill_new_rows(struct fill *fill, int num_rows)
+{
+        Bit2_T image = fill->image;
+        int width = Bit2_width(image);
+        int height = Bit2_height(image);
+        int first = fill->rows_ready;
+
+        assert(num_rows >= 0 && first + num_rows <= height);
+        fill->rows_ready = first + num_rows;
+        if (num_rows == 0) {
                 return;
         }
-        
-        /* save the original bit for if it's a valid black edge */
-        bp original_bit = make_bp(col, row);
-        
-        Stack_T bits_to_check = Stack_new();
-        bp first_bit = make_bp(col, row);
-        Stack_push(bits_to_check, first_bit);
-
-        Bit2_T visited_bits = Bit2_new(Bit2_width(image), Bit2_height(image));
-
-        while (Stack_empty(bits_to_check) != 1) {
-                bp curr_bit = (bp)Stack_pop(bits_to_check);
-
-                /* push to stack once a black edge pixel is found */
-                if (is_black_edge(curr_bit->col, curr_bit->row, image) 
-                                                                  == true) {
-                        Stack_push(*(Stack_T *)black_edges, original_bit);
-                        free(curr_bit);
-                        free_structs_in_stack(bits_to_check);
-                        Bit2_free(&visited_bits);
-                        return;
-                }
-                /* 
-                * push all neighbouring, unvisited black bits (right, left, 
-                * above and below) onto a stack to check if they are connected
-                * to a black edge pixel
-                */
-                if (valid_black_bit(curr_bit->col + 1, curr_bit->row, 
-                                        image, visited_bits) == true) {
-                        bp pos = make_bp(curr_bit->col + 1, curr_bit->row);
-                        Stack_push(bits_to_check, pos);
+
+        fill->first_new = first;
+        for (int col = 0; col < width; col++) {
+                fill->owner[col] = -1;
+        }
+        Stack_T waiting_spans = fill->deferred;
+        fill->deferred = Stack_new();
+        while (Stack_empty(waiting_spans) != 1) {
+                struct span *waiting = Stack_pop(waiting_spans);
+                for (int col = waiting->left; col <= waiting->right; col++) {
+                        if (fill->owner[col] >= 0) {
+                                join_labels(fill, fill->owner[col], 
+                                                        waiting->label);
+                        }
                 }
-                if (valid_black_bit(curr_bit->col - 1, curr_bit->row, 
-                                        image, visited_bits) == true) {
-                        bp pos = make_bp(curr_bit->col - 1, curr_bit->row);
-                        Stack_push(bits_to_check, pos); 
+                fill->label = waiting->label;
+                push_run_seeds(fill, waiting->left, waiting->right, 
+                                                        waiting->row);
+                free(waiting);
+                fill->stats->cleared += drain_seeds(fill);
+        }
+        Stack_free(&waiting_spans);
+
+        for (int row = first; row < fill->rows_ready; row++) {
+                if (row == 0 || row == height - 1) {
+                        for (int col = 0; col < width; col++) {
+                                fill_border_component(fill, col, row);
+                        }
+                } else {
+                        fill_border_component(fill, 0, row);
+                        fill_border_component(fill, width - 1, row);
                 }
-                if (valid_black_bit(curr_bit->col, curr_bit->row + 1, 
-                                        image, visited_bits) == true) {
-                        bp pos = make_bp(curr_bit->col, curr_bit->row + 1);
-                        Stack_push(bits_to_check, pos); 
+        }
+}
+
+/**********fill_border_component********
+ *
+ * Turns white the whole black region containing the border pixel (col, row),
+ * as far as the rows read so far
+ * Inputs:
+ *              struct fill *fill: the fill, whose seed stack is empty
+ *              int col: column value of the border pixel
+ *              int row: row value of the border pixel
+ * Return: N/A
+ * Expects:
+ *      * fill to be nonnull
+ *      * (col, row) to be within the rows read so far
+ * Notes:
+ *      * Does nothing if the pixel is white, including when it belonged to
+ *      a region that was already filled from another border pixel
+ *      * The seed stack is empty again on return, with every seed freed
+ ************************/
+void fill_border_component(struct fill *fill, int col, int row)
+{
+        if (Bit2_get(fill->image, col, row) == WHITE) {
+                return;
+        }
+        fill->stats->components++;
+        fill->label = new_label(fill);
+
+        Stack_push(fill->seeds, make_bp(col, row));
+        fill->stats->cleared += drain_seeds(fill);
+}
+
+/**********drain_seeds********
+ *
+ * Fills from every seed on the seed stack until the stack is empty
+ * Inputs:
+ *              struct fill *fill: the fill whose seeds are used up
+ * Return: the number of pixels turned white
+ * Expects:
+ *      fill to be nonnull
+ * Notes:
+ *      Each seed popped from the stack is freed
+ ************************/
+long drain_seeds(struct fill *fill)
+{
+        long cleared = 0;
+        while (Stack_empty(fill->seeds) != 1) {
+                bp seed = (bp)Stack_pop(fill->seeds);
+                cleared += fill_span(fill, seed->col, seed->row);
+                free(seed);
+        }
+        return cleared;
+}
+
+/**********fill_span********
+ *
+ * Turns white the horizontal run of black pixels containing (col, row), and
+ * pushes a seed for every black run directly above or below it
+ * Inputs:
+ *              struct fill *fill: the fill the span belongs to
+ *              int col: column value of the seed pixel
+ *              int row: row value of the seed pixel
+ * Return: the number of pixels turned white
+ * Expects:
+ *      * fill to be nonnull
+ *      * (col, row) to be within the rows read so far
+ * Notes:
+ *      * Does nothing if the seed has already been filled by an earlier span
+ *      * If the row below has not been read yet, the span is put on the 
+ *      deferred stack, to be carried on by fill_new_rows
+ *      * A span in the first row of the latest block is recorded as the 
+ *      current label's in fill->owner
+ *      * Allocates memory for each pushed seed or span, which the client must
+ *      free once it is popped
+ ************************/
+long fill_span(struct fill *fill, int col, int row)
+{
+        Bit2_T image = fill->image;
+        if (Bit2_get(image, col, row) == WHITE) {
+                return 0;
+        }
+
+        int left = col;
+        int right = col;
+        while (left > 0 && Bit2_get(image, left - 1, row) == 1) {
+                left--;
+        }
+        while (right < Bit2_width(image) - 1 && 
+               Bit2_get(image, right + 1, row) == 1) {
+                right++;
+        }
+
+        for (int c = left; c <= right; c++) {
+                Bit2_put(image, c, row, WHITE);
+        }
+        if (row == fill->first_new) {
+                for (int c = left; c <= right; c++) {
+                        fill->owner[c] = fill->label;
                 }
-                if (valid_black_bit(curr_bit->col, curr_bit->row - 1, 
-                                        image, visited_bits) == true) {
-                        bp pos = make_bp(curr_bit->col, curr_bit->row - 1);
-                        Stack_push(bits_to_check, pos); 
+        }
+
+        if (row > 0) {
+                push_run_seeds(fill, left, right, row - 1);
+        }
+        if (row + 1 < fill->rows_ready) {
+                push_run_seeds(fill, left, right, row + 1);
+        } else if (row + 1 < Bit2_height(image)) {
+                Stack_push(fill->deferred, make_span(left, right, row + 1, 
+                                                     fill->label));
+        }
+        return right - left + 1;
+}
+
+/**********push_run_seeds********
+ *
+ * Pushes one seed for every run of black pixels in row between the columns
+ * left and right (inclusive)
+ * Inputs:
+ *              struct fill *fill: the fill whose seed stack is pushed onto
+ *              int left: first column of the range to be scanned
+ *              int right: last column of the range to be scanned
+ *              int row: row value of the range to be scanned
+ * Return: N/A
+ * Expects:
+ *      * fill to be nonnull
+ *      * 0 <= left, right < width of image and row to have been read
+ * Notes:
+ *      * The seed for a run is its leftmost pixel within the range; a run
+ *      that carries on past the range is found again by fill_span
+ *      * Allocates memory for each pushed seed
+ ************************/
+void push_run_seeds(struct fill *fill, int left, int right, int row)
+{
+        int prev_bit = WHITE;
+        for (int c = left; c <= right; c++) {
+                int bit = Bit2_get(fill->image, c, row);
+                if (bit == 1 && prev_bit == WHITE) {
+                        Stack_push(fill->seeds, make_bp(c, row));
                 }
-                Bit2_put(visited_bits, curr_bit->col, curr_bit->row, MARKED);
-                free(curr_bit);
+                prev_bit = bit;
         }
-        free(original_bit);
-        free_structs_in_stack(bits_to_check);
-        Bit2_free(&visited_bits);
+}
+
+/**********new_label********
+ *
+ * Gives a new border component a label of its own
+ * Inputs:
+ *              struct fill *fill: the fill the component is found by
+ * Return: the label
+ * Expects:
+ *      fill to be nonnull
+ * Notes:
+ *      * The label starts as its own root
+ *      * Checked runtime error if memory cannot be allocated
+ ************************/
+int new_label(struct fill *fill)
+{
+        if (fill->num_labels == fill->capacity) {
+                fill->capacity = fill->capacity > 0 ? 2 * fill->capacity 
+                                                    : 64;
+                fill->parent = realloc(fill->parent, 
+                                       fill->capacity * sizeof(int));
+                assert(fill->parent != NULL);
+        }
+        int label = fill->num_labels++;
+        fill->parent[label] = label;
+        return label;
+}
+
+/**********find_label********
+ *
+ * Finds the root of the labels joined with a label
+ * Inputs:
+ *              struct fill *fill: the fill holding the labels
+ *              int label: the label
+ * Return: the root label
+ * Expects:
+ *      fill to be nonnull and label to come from new_label
+ * Notes:
+ *      Halves the path it follows, so later finds are shorter
+ ************************/
+int find_label(struct fill *fill, int label)
+{
+        while (fill->parent[label] != label) {
+                fill->parent[label] = fill->parent[fill->parent[label]];
+                label = fill->parent[label];
+        }
+        return label;
+}
+
+/**********join_labels********
+ *
+ * Records that two border components are one
+ * Inputs:
+ *              struct fill *fill: the fill holding the labels
+ *              int label1: a label of one component
+ *              int label2: a label of the other
+ * Return: N/A
+ * Expects:
+ *      fill to be nonnull and both labels to come from new_label
+ * Notes:
+ *      The component count goes down by one unless the labels were joined
+ *      already
+ ************************/
+void join_labels(struct fill *fill, int label1, int label2)
+{
+        int root1 = find_label(fill, label1);
+        int root2 = find_label(fill, label2);
+        if (root1 != root2) {
+                fill->parent[root2] = root1;
+                fill->stats->components--;
+        }
+}
+
+/**********make_span********
+ *
+ * Creates and allocates memory for one span struct
+ * Inputs:
+ *              int left: first column of the span
+ *              int right: last column of the span
+ *              int row: row of the span
+ *              int label: label of the component the span belongs to
+ * Return: A pointer to a span struct with the values given as parameters
+ * Expects:
+ *      None
+ * Notes:
+ *      allocates memory for a struct that the client needs to free when they
+ *      no longer need the struct
+ ************************/
+struct span *make_span(int left, int right, int row, int label)
+{
+        struct span *waiting = malloc(sizeof(*waiting));
+        assert(waiting != NULL);
+        waiting->left = left;
+        waiting->right = right;
+        waiting->row = row;
+        waiting->label = label;
+        return waiting;
 }
 
 /**********make_bp********
@@ -307,148 +1382,296 @@ bp make_bp(int col, int row)
         return pos;
 }
 
-/**********is_black_edge********
+/**********clean_pipelined********
  *
- * Checks if a pixel in an image is black and is on the edge of the image
+ * Reads one pbm and removes its black edges, with a thread reading the pbm
+ * while this thread cleans the rows already read
  * Inputs:
- *              int col: column coordinate value to be checked
- *              int row: row coordinate value to be checked
- *              Bit2_T image: The image where the coordinates will be checked
- * Return: A bool that is true is the pixel in (col,row) is black and is on
- *         the edge of image
- * Expects: 
- *      image to be nonnull
- *      col is positive and less than the height of image
- *      row is positive and less than the width of image
+ *              Pnmrdr_T input: reader positioned at the start of the raster
+ *              struct options *opts: holds the -t level
+ *              Bit2_T image: a Bit2_array the size of the pbm
+ *              struct edge_stats *stats: set as by remove_black_edges
+ * Return: N/A
+ * Expects:
+ *      input, opts, image and stats to be nonnull
  * Notes:
- *      None
+ *      * The reader thread passes blocks of rows to this thread as soon as
+ *      they are read, and the fill is carried on over each new block
+ *      * Printing is left to the caller: a region reaching the bottom edge
+ *      can turn white pixels in any earlier row, and the header needs the 
+ *      final statistics, so no row can be printed before the fill is over
+ *      * Checked runtime error if the thread cannot be started
  ************************/
-bool is_black_edge(int col, int row, Bit2_T image)
+void clean_pipelined(Pnmrdr_T input, struct options *opts, Bit2_T image, 
+                                        struct edge_stats *stats)
 {
-        if (((col == 0) || (col == (Bit2_width(image) - 1)) || 
-             (row == 0) || (row == (Bit2_height(image) - 1))) 
-                        && (Bit2_get(image, col, row) == 1)) {
-                return true;
-        } else {
-                return false;
+        struct pipeline pipeline;
+        pipeline.input = input;
+        pipeline.image = image;
+        pipeline.decoded = Ring_new(RING_BLOCKS);
+        pipeline.opts = opts;
+
+        pthread_t reader;
+        int started = pthread_create(&reader, NULL, read_rows, &pipeline);
+        assert(started == 0);
+
+        /* fill each block of rows as it is read */
+        struct fill fill;
+        start_fill(&fill, image, stats);
+        for (;;) {
+                Ring_block block = Ring_get(pipeline.decoded);
+                if (block.num_rows == 0) {
+                        break;
+                }
+                fill_new_rows(&fill, block.num_rows);
         }
+        end_fill(&fill);
+
+        pthread_join(reader, NULL);
+        Ring_free(&pipeline.decoded);
 }
 
-/**********free_structs_in_stack********
+/**********read_rows********
  *
- * Frees up memory from all the structs in an inputted stack and then frees up
- * memory allocated by that stack
+ * Thread that reads the raster of a pbm (or thresholds that of a pgm) into 
+ * the image, a block of rows at a time
  * Inputs:
- *              Stack_T stack: stack of structs that will be freed
- * Return: N/A
- * Expects: 
- *      stack is nonnull
+ *              void *cl: the struct pipeline of the run
+ * Return: NULL
+ * Expects:
+ *      cl to be nonnull
  * Notes:
- *      None
+ *      * Each block is put on the decoded ring once all of its rows are in
+ *      the image, and a block of zero rows marks the end of the image
+ *      * Rows never share a Bit2 word, so this thread can write new rows
+ *      while the processor changes earlier ones
  ************************/
-void free_structs_in_stack(Stack_T stack) 
+void *read_rows(void *cl)
 {
-        assert(stack != NULL);
-        while (Stack_empty(stack) != 1) {
-                bp curr_struct = (bp)Stack_pop(stack);
-                free(curr_struct);
+        struct pipeline *pipeline = cl;
+        int width = Bit2_width(pipeline->image);
+        int height = Bit2_height(pipeline->image);
+
+        Pnmrdr_mapdata input_data = Pnmrdr_data(pipeline->input);
+        uint64_t *words = malloc((width + 63) / 64 * sizeof(uint64_t));
+        assert(words != NULL);
+
+        for (int row = 0; row < height; row += ROWS_PER_BLOCK) {
+                int num_rows = height - row;
+                if (num_rows > ROWS_PER_BLOCK) {
+                        num_rows = ROWS_PER_BLOCK;
+                }
+                for (int r = row; r < row + num_rows; r++) {
+                        decode_row(pipeline->input, input_data, 
+                                   pipeline->opts->threshold, words);
+                        Bit2_put_row_words(pipeline->image, r, words);
+                }
+                Ring_put(pipeline->decoded, (Ring_block){ row, num_rows });
         }
-        Stack_free(&stack);
+        Ring_put(pipeline->decoded, (Ring_block){ height, 0 });
+        free(words);
+        return NULL;
 }
 
-/**********valid_black_bit********
+/**********apply_morphology********
  *
- * Checks if the current bit being inputed at (col,row) is a black bit that is
- * within the range of the image and hasn't been visited before
+ * Runs the -m steps, in order, over a cleaned image
  * Inputs:
- *              int col: column value of the bit being checked
- *              int row: row value of the bit being checked
- *              Bit2_T image: the image being checked
- *              Bit2_T visited_bits: a representation of all the visited bits
- *                                   to be used to check if the current one
- *                                   has already been visited
- * Return: A bool that is true if the current bit is a black bit that is within
- *         the range of the image and hasn't been visited before, false if
- *         any of those predicates aren't correct
+ *              Bit2_T image: Pointer to the Bit2_array after black edges
+ *                            have been removed. Changed in place
+ *              struct options *opts: holds the steps
+ *              Pool_T pool: where the working space of each step is taken
+ *                           from
+ * Return: N/A
  * Expects:
- *      visited_bits and image to be nonnull
+ *      image, opts and pool to be nonnull
  * Notes:
- *      None
+ *      * Each step works on image in place, so image stays the one the
+ *      caller holds
+ *      * Does nothing when no -m was given
  ************************/
-bool valid_black_bit(int col, int row, Bit2_T image, Bit2_T visited_bits)
+void apply_morphology(Bit2_T image, struct options *opts, Pool_T pool)
 {
-        if ((col < 0) || (col > Bit2_width(image) - 1) ||  
-            (row < 0) || (row > Bit2_height(image) - 1)) {
-                return false;
+        for (int i = 0; i < opts->num_morph; i++) {
+                struct morph_step *step = &opts->morph[i];
+                step->op(image, step->se_width, step->se_height, pool);
         }
-        
-        if ((Bit2_get(image, col, row) == 1) && 
-            (visited(visited_bits, col, row) == false)) {
-                return true;
-        } else {
-                return false;
+}
+
+/**********content_stats********
+ *
+ * Records how much black is left in a cleaned image and where it is
+ * Inputs:
+ *              Bit2_T image: Pointer to the Bit2_array after black edges
+ *                            have been removed
+ *              struct edge_stats *stats: the remaining, has_content and
+ *                                        bounding box fields are filled in
+ * Return: N/A
+ * Expects:
+ *      image and stats to be nonnull
+ * Notes:
+ *      * Works over whole Bit2 words (popcount and leading/trailing zero 
+ *      counts), so it costs a small fraction of a pass over the pixels
+ *      * The bounding box is left as 0 0 -1 -1 when no black pixels remain
+ ************************/
+void content_stats(Bit2_T image, struct edge_stats *stats)
+{
+        assert(stats != NULL);
+        stats->remaining = Bit2_count(image);
+        stats->left = 0;
+        stats->top = 0;
+        stats->right = -1;
+        stats->bottom = -1;
+        stats->has_content = Bit2_bounding_box(image, &stats->left, 
+                                &stats->top, &stats->right, &stats->bottom);
+}
+
+/**********output_region********
+ *
+ * Picks the rectangle of a cleaned image that is written out
+ * Inputs:
+ *              Bit2_T image: Pointer to the cleaned Bit2_array
+ *              bool crop: whether to crop to the remaining black pixels
+ *              struct edge_stats *stats: statistics of image, with the 
+ *                                        content fields filled in by 
+ *                                        content_stats when crop is true
+ * Return: the whole image, or the bounding box of its black pixels when 
+ *         cropping
+ * Expects:
+ *      image and stats to be nonnull
+ * Notes:
+ *      * An image with no black pixels left is cropped to its top left 
+ *      pixel, which is white, since a pbm cannot be 0 x 0
+ ************************/
+struct region output_region(Bit2_T image, bool crop, struct edge_stats *stats)
+{
+        struct region region = { 0, 0, Bit2_width(image), 
+                                                Bit2_height(image) };
+        if (crop && stats->has_content) {
+                region.left = stats->left;
+                region.top = stats->top;
+                region.width = stats->right - stats->left + 1;
+                region.height = stats->bottom - stats->top + 1;
+        } else if (crop) {
+                region.width = 1;
+                region.height = 1;
         }
+        return region;
 }
 
-/**********visited********
+/**********print_header********
  *
- * Checks if a location in a 2D bitmap has been visited before
+ * Prints the header of the output pbm
  * Inputs:
- *              Bit2_T visited_bits: 2D bitmap that is being checked
- *              int col: column value of the location being checked
- *              int row: row value of the location being checked
- * Return: A bool that is true if the location has been visited before, false
- *         if not
+ *              FILE *out: stream to print to
+ *              struct region region: the part of the image being printed
+ *              bool raw_output: true for a raw (P4) pbm, false for a plain
+ *                               (P1) pbm
+ *              struct edge_stats *stats: statistics to print as a comment
+ *                                        line, or NULL for none
+ * Return: N/A
  * Expects:
- *      visited_bits to be nonnull
- *      The row value is positive and less than the height of visited_bits
- *      The col value is positive and less than the width of visited_bits
+ *      None
  * Notes:
- *      Within the 2D bitmap, a 1 bit means the location has been visited, and
- *      a 0 bit means that the location hasn't been visited
+ *      * The statistics line has the form
+ *        # stats cleared=C components=N remaining=R bbox=L,T,R,B
+ *      and is a pbm comment, so readers of the image skip over it
+ *      * A region that does not start at (0, 0) is noted with a comment
+ *      line of the form # crop offset=L,T
  ************************/
-bool visited(Bit2_T visited_bits, int col, int row)
+void print_header(FILE *out, struct region region, bool raw_output, 
+                                                struct edge_stats *stats)
 {
-        if (Bit2_get(visited_bits, col, row) == 1) {
-                return true;
-        } else {
-                return false;
+        fprintf(out, "%s\n# file without black edges\n", 
+                                                raw_output ? "P4" : "P1");
+        if (stats != NULL) {
+                fprintf(out, "# stats cleared=%ld components=%d "
+                        "remaining=%ld bbox=%i,%i,%i,%i\n", stats->cleared,
+                        stats->components, stats->remaining, stats->left, 
+                        stats->top, stats->right, stats->bottom);
         }
+        if (region.left != 0 || region.top != 0) {
+                fprintf(out, "# crop offset=%i,%i\n", region.left, 
+                                                                region.top);
+        }
+        fprintf(out, "%i %i\n", region.width, region.height);
 }
 
-/**********print_one_bit********
+/**********print_plain_rows********
  *
- * Prints one bit value in a 2D image array, at the location (col,row), and
- * prints a white character after it (either a space or a newline)
+ * Prints the bits of a region of image as a plain (P1) pbm raster
  * Inputs:
- *              int col: column value of the bit (not used)
- *              int row: row value of the bit (not used)
- *              Bit2_T image: Pointer to the Bit2_array that is used to find
- *                            the width of the entire image to figure out where
- *                            to put newlines
- *              int bit: integer value of bit at given position (either 1 or 0)
- *                       being printed to output
- *              void *input: a closure value (not used)
+ *              FILE *out: stream to print to
+ *              Bit2_T image: Pointer to the Bit2_array being printed
+ *              struct region region: the part of image to print
  * Return: N/A
  * Expects: 
- *      None
+ *      * image to be nonnull
+ *      * region to lie within image
  * Notes:
- *      * Used as an apply function for Bit2_map_row_major, so it will iterate 
- *      through and print out every bit in image
  *      * There is one space added between each bit, with the exception of a 
  *      newline instead after every row is completed, setting up the next row
  *      of the image on the next line
+ *      * Reads the region through a Bit2_view, a row of words at a time
  ************************/
-void print_one_bit(int col, int row, Bit2_T image, int bit, void *input)
+void print_plain_rows(FILE *out, Bit2_T image, struct region region)
 {
-        (void)col;
-        (void)row;
-        (void)input;
+        Bit2_view view = Bit2_view_of(image, region.left, region.top, 
+                                      region.width, region.height);
+        uint64_t *words = malloc(((region.width + 63) / 64 + 1) * 
+                                                        sizeof(uint64_t));
+        assert(words != NULL);
 
-        printf("%i", bit);
-        if (col == (Bit2_width(image) - 1)) {
-                printf("\n");
-        } else {
-                printf(" ");
+        int width = Bit2_view_width(view);
+        for (int row = 0; row < Bit2_view_height(view); row++) {
+                Bit2_view_get_row_words(view, row, words);
+                for (int i = 0; i < width; i++) {
+                        putc('0' + ((words[i / 64] >> (i % 64)) & 1), out);
+                        if (i == width - 1) {
+                                putc('\n', out);
+                        } else {
+                                putc(' ', out);
+                        }
+                }
+        }
+        free(words);
+}
+
+/**********print_raw_rows********
+ *
+ * Prints the bits of a region of image as a raw (P4) pbm raster, eight 
+ * pixels per byte
+ * Inputs:
+ *              FILE *out: stream to print to
+ *              Bit2_T image: Pointer to the Bit2_array being printed
+ *              struct region region: the part of image to print
+ * Return: N/A
+ * Expects:
+ *      * image to be nonnull
+ *      * region to lie within image
+ * Notes:
+ *      * The leftmost pixel of each byte is its most significant bit, and
+ *      every row is padded with zero bits to a whole byte, as P4 requires
+ *      * Reads the region through a Bit2_view, a row of words at a time, 
+ *      whose bits past the region's width are already zero
+ ************************/
+void print_raw_rows(FILE *out, Bit2_T image, struct region region)
+{
+        Bit2_view view = Bit2_view_of(image, region.left, region.top, 
+                                      region.width, region.height);
+        uint64_t *words = malloc(((region.width + 63) / 64 + 1) * 
+                                                        sizeof(uint64_t));
+        assert(words != NULL);
+
+        for (int row = 0; row < Bit2_view_height(view); row++) {
+                Bit2_view_get_row_words(view, row, words);
+                for (int i = 0; i < Bit2_view_width(view); i += 8) {
+                        unsigned bits = (words[i / 64] >> (i % 64)) & 0xff;
+                        /* reverse the byte: column i goes in the top bit */
+                        bits = ((bits * 0x0202020202ull) & 0x010884422010ull)
+                                                                        % 1023;
+                        putc(bits, out);
+                }
         }
+        free(words);
 }
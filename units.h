@@ -0,0 +1,73 @@
+/*
+ *     units.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: The units (rows, columns and boxes) of a 9 x 9 sudoku, as
+ *              constant tables the compiler fills in, so checks walk a
+ *              table instead of working out indices with / and %
+ */
+
+#ifndef UNITS_INCLUDED
+#define UNITS_INCLUDED
+
+#define UNIT_SIDE 9
+#define UNIT_CELLS_TOTAL (UNIT_SIDE * UNIT_SIDE)
+#define NUM_UNITS (3 * UNIT_SIDE)
+
+/*
+ * Cells are numbered row by row, cell i = row * 9 + col. Units 0 to 8 are
+ * the rows, 9 to 17 the columns and 18 to 26 the boxes in row-major order,
+ * and each unit lists its cells in row-major order
+ */
+#define ROW_CELLS(r) { 9 * (r), 9 * (r) + 1, 9 * (r) + 2, 9 * (r) + 3, \
+                       9 * (r) + 4, 9 * (r) + 5, 9 * (r) + 6, 9 * (r) + 7, \
+                       9 * (r) + 8 }
+#define COL_CELLS(c) { (c), (c) + 9, (c) + 18, (c) + 27, (c) + 36, \
+                       (c) + 45, (c) + 54, (c) + 63, (c) + 72 }
+#define BOX_CELLS_FROM(f) { (f), (f) + 1, (f) + 2, (f) + 9, (f) + 10, \
+                            (f) + 11, (f) + 18, (f) + 19, (f) + 20 }
+#define BOX_CELLS(b) BOX_CELLS_FROM(27 * ((b) / 3) + 3 * ((b) % 3))
+
+static const unsigned char UNIT_CELLS[NUM_UNITS][UNIT_SIDE] = {
+        ROW_CELLS(0), ROW_CELLS(1), ROW_CELLS(2),
+        ROW_CELLS(3), ROW_CELLS(4), ROW_CELLS(5),
+        ROW_CELLS(6), ROW_CELLS(7), ROW_CELLS(8),
+        COL_CELLS(0), COL_CELLS(1), COL_CELLS(2),
+        COL_CELLS(3), COL_CELLS(4), COL_CELLS(5),
+        COL_CELLS(6), COL_CELLS(7), COL_CELLS(8),
+        BOX_CELLS(0), BOX_CELLS(1), BOX_CELLS(2),
+        BOX_CELLS(3), BOX_CELLS(4), BOX_CELLS(5),
+        BOX_CELLS(6), BOX_CELLS(7), BOX_CELLS(8)
+};
+
+/* The row, column and box units of each cell */
+#define CELL_UNITS_OF(i) { (i) / 9, 9 + (i) % 9, \
+                           18 + 3 * ((i) / 27) + (i) % 9 / 3 }
+#define ROW_CELL_UNITS(r) \
+        CELL_UNITS_OF(9 * (r)), CELL_UNITS_OF(9 * (r) + 1), \
+        CELL_UNITS_OF(9 * (r) + 2), CELL_UNITS_OF(9 * (r) + 3), \
+        CELL_UNITS_OF(9 * (r) + 4), CELL_UNITS_OF(9 * (r) + 5), \
+        CELL_UNITS_OF(9 * (r) + 6), CELL_UNITS_OF(9 * (r) + 7), \
+        CELL_UNITS_OF(9 * (r) + 8)
+
+static const unsigned char CELL_UNITS[UNIT_CELLS_TOTAL][3] = {
+        ROW_CELL_UNITS(0), ROW_CELL_UNITS(1), ROW_CELL_UNITS(2),
+        ROW_CELL_UNITS(3), ROW_CELL_UNITS(4), ROW_CELL_UNITS(5),
+        ROW_CELL_UNITS(6), ROW_CELL_UNITS(7), ROW_CELL_UNITS(8)
+};
+
+/*
+ * Whether unit u of cells (an array of one value from 0 to 15 per cell)
+ * holds each digit 1 to 9 once, with the nine lookups written out. u must
+ * be a constant, so the cell indices are too
+ */
+#define UNIT_DIGIT(cells, u, k) (1u << (cells)[UNIT_CELLS[u][k]])
+#define UNIT_COMPLETE(cells, u) \
+        ((UNIT_DIGIT(cells, u, 0) | UNIT_DIGIT(cells, u, 1) | \
+          UNIT_DIGIT(cells, u, 2) | UNIT_DIGIT(cells, u, 3) | \
+          UNIT_DIGIT(cells, u, 4) | UNIT_DIGIT(cells, u, 5) | \
+          UNIT_DIGIT(cells, u, 6) | UNIT_DIGIT(cells, u, 7) | \
+          UNIT_DIGIT(cells, u, 8)) == 0x3feu)
+
+#endif
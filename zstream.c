@@ -0,0 +1,410 @@
+/*
+ *     zstream.c
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Implementation of compressed streams. Input is recognized by
+ *              its first byte: gzip data starts with 0x1f and zstd data 
+ *              with 0x28, while every pnm starts with 'P'. gzip is read and
+ *              written with zlib; zstd input is read when the program is 
+ *              built with -DZSTREAM_ZSTD and linked with -lzstd.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef ZSTREAM_ZSTD
+#include <zstd.h>
+#endif
+
+#include "zstream.h"
+
+#define T Zstream_T
+
+#define BUFFER_SIZE (64 * 1024)
+#define GZIP_MAGIC 0x1f
+#define ZSTD_MAGIC 0x28
+
+/* gzip framing for deflateInit2 and inflateInit2 */
+#define GZIP_WINDOW (15 + 16)
+
+/*
+ * The client's end of the pipe is file. The thread owns the other end, 
+ * fd, and the compressed stream on the far side of it
+ */
+struct T {
+        FILE *file;             /* what the client reads or writes */
+        int fd;                 /* the thread's end of the pipe */
+        FILE *compressed;       /* the stream the thread reads or writes */
+        pthread_t thread;
+};
+
+static T start(FILE *compressed, bool reading, void *(*run)(void *));
+static void *inflate_gzip(void *cl);
+#ifdef ZSTREAM_ZSTD
+static void *decompress_zstd(void *cl);
+#endif
+static void *deflate_gzip(void *cl);
+static bool write_all(int fd, const unsigned char *bytes, size_t length);
+
+/**********Zstream_decompress********
+ *
+ * Checks whether a stream is compressed, and if it is starts a thread to 
+ * decompress it
+ * Inputs:
+ *              FILE *in: the stream, not yet read from
+ * Return: a stream whose Zstream_file gives the decompressed bytes, or 
+ *         NULL if in is not compressed
+ * Expects:
+ *      in to be nonnull
+ * Notes:
+ *      * Only the first byte of in is looked at, and it is put back, so in 
+ *      can be read as usual when NULL is returned
+ *      * zstd input is only recognized when built with ZSTREAM_ZSTD
+ *      * Checked runtime error if the pipe or thread cannot be made
+ *      * The client must use Zstream_close once done reading, and closes
+ *      in itself afterwards
+ ************************/
+T Zstream_decompress(FILE *in)
+{
+        assert(in != NULL);
+        int first = getc(in);
+        if (first == EOF) {
+                return NULL;
+        }
+        ungetc(first, in);
+
+        if (first == GZIP_MAGIC) {
+                return start(in, true, inflate_gzip);
+        }
+#ifdef ZSTREAM_ZSTD
+        if (first == ZSTD_MAGIC) {
+                return start(in, true, decompress_zstd);
+        }
+#endif
+        return NULL;
+}
+
+/**********Zstream_compress********
+ *
+ * Starts a thread that gzips everything written to the stream onto out
+ * Inputs:
+ *              FILE *out: where the compressed bytes go
+ * Return: a stream whose Zstream_file takes the uncompressed bytes
+ * Expects:
+ *      out to be nonnull
+ * Notes:
+ *      * The compressed data is only complete once Zstream_close returns
+ *      * Checked runtime error if the pipe or thread cannot be made
+ *      * The client must use Zstream_close once done writing, and closes
+ *      out itself afterwards
+ ************************/
+T Zstream_compress(FILE *out)
+{
+        assert(out != NULL);
+        return start(out, false, deflate_gzip);
+}
+
+/**********Zstream_file********
+ *
+ * Gives the client's end of a stream
+ * Inputs:
+ *              T stream: the stream
+ * Return: the FILE * to read decompressed bytes from, or write bytes to be 
+ *         compressed to
+ * Expects:
+ *      stream to be nonnull
+ * Notes:
+ *      The FILE * is closed by Zstream_close, not by the client
+ ************************/
+FILE *Zstream_file(T stream)
+{
+        assert(stream != NULL);
+        return stream->file;
+}
+
+/**********Zstream_close********
+ *
+ * Closes the client's end of a stream and waits for its thread
+ * Inputs:
+ *              T *stream: the stream to close, or a pointer to NULL
+ * Return: N/A
+ * Expects:
+ *      stream to be nonnull
+ * Notes:
+ *      * For an output stream this flushes the last of the compressed data
+ *      to the underlying FILE *
+ *      * An input stream may be closed before it is read to the end; the 
+ *      thread then stops at its next write
+ *      * *stream is freed and set to NULL. Does nothing if it is NULL
+ ************************/
+void Zstream_close(T *stream)
+{
+        assert(stream != NULL);
+        if (*stream == NULL) {
+                return;
+        }
+        fclose((*stream)->file);
+        pthread_join((*stream)->thread, NULL);
+        free(*stream);
+        *stream = NULL;
+}
+
+/**********start********
+ *
+ * Makes the pipe of a stream and starts its thread
+ * Inputs:
+ *              FILE *compressed: the compressed side of the stream
+ *              bool reading: whether the client reads (decompression) or 
+ *                            writes (compression)
+ *              void *(*run)(void *): the thread, given the stream
+ * Return: the new stream
+ * Expects:
+ *      compressed and run to be nonnull
+ * Notes:
+ *      Checked runtime error if memory, the pipe or the thread cannot be 
+ *      had
+ ************************/
+static T start(FILE *compressed, bool reading, void *(*run)(void *))
+{
+        T stream = malloc(sizeof(*stream));
+        assert(stream != NULL);
+
+        int ends[2];
+        int made = pipe(ends);
+        assert(made == 0);
+        if (reading) {
+                stream->file = fdopen(ends[0], "r");
+                stream->fd = ends[1];
+        } else {
+                stream->file = fdopen(ends[1], "w");
+                stream->fd = ends[0];
+        }
+        assert(stream->file != NULL);
+        stream->compressed = compressed;
+
+        int started = pthread_create(&stream->thread, NULL, run, stream);
+        assert(started == 0);
+        return stream;
+}
+
+/**********inflate_gzip********
+ *
+ * Thread that decompresses gzip data into the pipe of a stream
+ * Inputs:
+ *              void *cl: the stream
+ * Return: NULL
+ * Expects:
+ *      cl to be nonnull
+ * Notes:
+ *      * Several gzip members one after another are read as one stream, 
+ *      as gunzip does
+ *      * On corrupt data the pipe is closed where the good data ends, so
+ *      the reader sees a truncated file
+ *      * SIGPIPE is blocked on this thread, so a client that closes early
+ *      ends the thread through EPIPE instead of ending the process
+ ************************/
+static void *inflate_gzip(void *cl)
+{
+        T stream = cl;
+        sigset_t pipe_signal;
+        sigemptyset(&pipe_signal);
+        sigaddset(&pipe_signal, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipe_signal, NULL);
+
+        unsigned char *in = malloc(2 * BUFFER_SIZE);
+        assert(in != NULL);
+        unsigned char *out = in + BUFFER_SIZE;
+
+        z_stream z = { 0 };
+        int status = inflateInit2(&z, GZIP_WINDOW);
+        assert(status == Z_OK);
+
+        bool ok = true;
+        bool end_of_input = false;
+        while (ok) {
+                if (z.avail_in == 0 && end_of_input == false) {
+                        z.avail_in = fread(in, 1, BUFFER_SIZE, 
+                                                        stream->compressed);
+                        z.next_in = in;
+                        end_of_input = z.avail_in == 0;
+                }
+
+                z.next_out = out;
+                z.avail_out = BUFFER_SIZE;
+                status = inflate(&z, Z_NO_FLUSH);
+                size_t produced = BUFFER_SIZE - z.avail_out;
+                ok = write_all(stream->fd, out, produced);
+
+                if (status == Z_STREAM_END) {
+                        inflateReset(&z);
+                } else if (status == Z_BUF_ERROR && produced == 0) {
+                        /* zlib wants more input: stop if there is none */
+                        if (end_of_input) {
+                                break;
+                        }
+                } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                        ok = false;
+                }
+        }
+
+        inflateEnd(&z);
+        free(in);
+        close(stream->fd);
+        return NULL;
+}
+
+#ifdef ZSTREAM_ZSTD
+/**********decompress_zstd********
+ *
+ * Thread that decompresses zstd data into the pipe of a stream
+ * Inputs:
+ *              void *cl: the stream
+ * Return: NULL
+ * Expects:
+ *      cl to be nonnull
+ * Notes:
+ *      * Several frames one after another are read as one stream
+ *      * Handles errors and SIGPIPE as inflate_gzip does; a frame cut off
+ *      by the end of the input is treated as corrupt data
+ ************************/
+static void *decompress_zstd(void *cl)
+{
+        T stream = cl;
+        sigset_t pipe_signal;
+        sigemptyset(&pipe_signal);
+        sigaddset(&pipe_signal, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipe_signal, NULL);
+
+        unsigned char *in_bytes = malloc(2 * BUFFER_SIZE);
+        assert(in_bytes != NULL);
+        unsigned char *out_bytes = in_bytes + BUFFER_SIZE;
+
+        ZSTD_DStream *z = ZSTD_createDStream();
+        assert(z != NULL);
+        ZSTD_initDStream(z);
+
+        ZSTD_inBuffer in = { in_bytes, 0, 0 };
+        bool ok = true;
+        bool end_of_input = false;
+        while (ok) {
+                if (in.pos == in.size && end_of_input == false) {
+                        in.size = fread(in_bytes, 1, BUFFER_SIZE, 
+                                                        stream->compressed);
+                        in.pos = 0;
+                        end_of_input = in.size == 0;
+                }
+
+                ZSTD_outBuffer out = { out_bytes, BUFFER_SIZE, 0 };
+                size_t status = ZSTD_decompressStream(z, &out, &in);
+                ok = ZSTD_isError(status) == 0 && 
+                     write_all(stream->fd, out_bytes, out.pos);
+
+                /*
+                 * With no input left, zstd may still hold decoded bytes: 
+                 * it is drained once it returns 0 (the frame is done) or
+                 * leaves out with room (it has nothing more to give, so a
+                 * frame still open there is truncated)
+                 */
+                if (end_of_input && (status == 0 || out.pos < out.size)) {
+                        break;
+                }
+        }
+
+        ZSTD_freeDStream(z);
+        free(in_bytes);
+        close(stream->fd);
+        return NULL;
+}
+#endif
+
+/**********deflate_gzip********
+ *
+ * Thread that gzips what comes down the pipe of a stream
+ * Inputs:
+ *              void *cl: the stream
+ * Return: NULL
+ * Expects:
+ *      cl to be nonnull
+ * Notes:
+ *      * Runs until the client closes its end of the pipe, then finishes
+ *      the gzip member and flushes the compressed stream
+ *      * Uses a low compression level: the point is less I/O, and the 
+ *      compressor must keep up with the writer
+ ************************/
+static void *deflate_gzip(void *cl)
+{
+        T stream = cl;
+        unsigned char *in = malloc(2 * BUFFER_SIZE);
+        assert(in != NULL);
+        unsigned char *out = in + BUFFER_SIZE;
+
+        z_stream z = { 0 };
+        int status = deflateInit2(&z, 1, Z_DEFLATED, GZIP_WINDOW, 8, 
+                                                Z_DEFAULT_STRATEGY);
+        assert(status == Z_OK);
+
+        int flush = Z_NO_FLUSH;
+        while (flush != Z_FINISH) {
+                ssize_t got = read(stream->fd, in, BUFFER_SIZE);
+                if (got < 0 && errno == EINTR) {
+                        continue;
+                }
+                if (got <= 0) {
+                        flush = Z_FINISH;
+                        got = 0;
+                }
+                z.next_in = in;
+                z.avail_in = got;
+
+                do {
+                        z.next_out = out;
+                        z.avail_out = BUFFER_SIZE;
+                        deflate(&z, flush);
+                        fwrite(out, 1, BUFFER_SIZE - z.avail_out, 
+                                                        stream->compressed);
+                } while (z.avail_out == 0);
+        }
+
+        deflateEnd(&z);
+        fflush(stream->compressed);
+        free(in);
+        close(stream->fd);
+        return NULL;
+}
+
+/**********write_all********
+ *
+ * Writes bytes to a file descriptor, however many calls it takes
+ * Inputs:
+ *              int fd: where to write
+ *              const unsigned char *bytes: what to write
+ *              size_t length: how many bytes
+ * Return: true if every byte was written, false if the reader has gone
+ * Expects:
+ *      bytes to be nonnull
+ * Notes:
+ *      None
+ ************************/
+static bool write_all(int fd, const unsigned char *bytes, size_t length)
+{
+        while (length > 0) {
+                ssize_t written = write(fd, bytes, length);
+                if (written < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return false;
+                }
+                bytes += written;
+                length -= written;
+        }
+        return true;
+}
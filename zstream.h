@@ -0,0 +1,25 @@
+/*
+ *     zstream.h
+ *     by Kabir Pamnani and Isaac Monheit, 02/06/2023
+ *     HW2: Interfaces, Implementations and Images (iii)
+ *
+ *     Summary: Interface for compressed streams. Each stream is a pipe with
+ *              a thread at the other end that compresses or decompresses,
+ *              so the client reads and writes an ordinary FILE *
+ */
+
+#ifndef ZSTREAM_INCLUDED
+#define ZSTREAM_INCLUDED
+
+#include <stdio.h>
+
+#define T Zstream_T
+typedef struct T *T;
+
+extern T Zstream_decompress(FILE *in);
+extern T Zstream_compress(FILE *out);
+extern FILE *Zstream_file(T stream);
+extern void Zstream_close(T *stream);
+
+#undef T
+#endif